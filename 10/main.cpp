@@ -1,13 +1,29 @@
 ﻿#include <mpi.h>
 #include <opencv2/opencv.hpp>
 #include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <functional>
+#include <cstdint>
+#include <cmath>
+#include <cstdio>
+#include <map>
+#include <list>
+#include <memory>
+#include <tuple>
+#include "../common/perf_counters.h"
+#include "../common/roofline.h"
+#include "../common/dispatch.h"
 
 const int WIDTH = 1920;
 const int HEIGHT = 1080;
 const int MAX_ITER = 1000;
 
-// Функция проверки принадлежности к множеству Мандельброта
-int mandelbrot(double x0, double y0) {
+// Функция проверки принадлежности к множеству Мандельброта. Это эталон для
+// быстрых вариантов, поэтому умножения и сложения не сливаются в FMA (см. dispatch.h)
+SIMD_TARGET_SCALAR int mandelbrot(double x0, double y0) {
     double x = 0.0, y = 0.0;
     int iter = 0;
     while (x * x + y * y <= 4.0 && iter < MAX_ITER) {
@@ -19,11 +35,238 @@ int mandelbrot(double x0, double y0) {
     return iter;
 }
 
+// Проверка попадания в главную кардиоиду или круг периода 2:
+// такие точки заведомо принадлежат множеству и не требуют итераций
+SIMD_TARGET_SCALAR inline bool inMainBulbs(double x, double y) {
+    double xq = x - 0.25;
+    double q = xq * xq + y * y;
+    if (q * (q + xq) <= 0.25 * y * y) return true;
+    return (x + 1.0) * (x + 1.0) + y * y <= 0.0625;
+}
+
+// Быстрая скалярная версия: отсечение кардиоиды и круга, а также поиск цикла
+// по Бренту - точка z запоминается на шагах 1, 2, 4, 8, ..., и точное
+// повторение орбиты означает, что точка никогда не уйдёт на бесконечность
+SIMD_TARGET_SCALAR int mandelbrotFast(double x0, double y0) {
+    if (inMainBulbs(x0, y0)) return MAX_ITER;
+
+    double x = 0.0, y = 0.0;
+    double saved_x = 0.0, saved_y = 0.0;
+    int period_limit = 1, period = 0;
+    for (int iter = 0; iter < MAX_ITER; ++iter) {
+        double x2 = x * x, y2 = y * y;
+        if (x2 + y2 > 4.0) return iter;
+
+        y = 2 * x * y + y0;
+        x = x2 - y2 + x0;
+
+        if (x == saved_x && y == saved_y) return MAX_ITER;
+        if (++period == period_limit) {
+            saved_x = x;
+            saved_y = y;
+            period = 0;
+            period_limit *= 2;
+        }
+    }
+    return MAX_ITER;
+}
+
+// Расчёт count произвольных точек (xs[i], ys[i]) в вариантах для разных наборов
+// команд (см. common/dispatch.h): по 1, 2, 4 или 8 точек в регистре, завершившиеся
+// дорожки исключаются маской. Арифметика дорожки повторяет mandelbrotFast, поэтому
+// все варианты дают те же счётчики итераций
+using MandelbrotFn = void (*)(const double* xs, const double* ys, int* iters, int count);
+
+// Число точек в регистре у варианта каждого уровня
+const int SIMD_LANES[SIMD_LEVEL_COUNT] = { 1, 2, 4, 8 };
+
+SIMD_TARGET_SCALAR void mandelbrotPointsScalar(const double* xs, const double* ys, int* iters, int count) {
+    for (int col = 0; col < count; ++col) {
+        iters[col] = mandelbrotFast(xs[col], ys[col]);
+    }
+}
+
+SIMD_TARGET_SSE42 void mandelbrotPointsSse42(const double* xs, const double* ys, int* iters, int count) {
+    const int lanes = 2;
+    const __m128d four = _mm_set1_pd(4.0);
+    int col = 0;
+    for (; col + lanes <= count; col += lanes) {
+        alignas(16) long long lane_mask[lanes];
+        for (int lane = 0; lane < lanes; ++lane) {
+            lane_mask[lane] = inMainBulbs(xs[col + lane], ys[col + lane]) ? 0 : -1;
+        }
+
+        __m128d active = _mm_castsi128_pd(_mm_load_si128(reinterpret_cast<const __m128i*>(lane_mask)));
+        __m128d escaped = _mm_setzero_pd();
+        __m128d cx = _mm_loadu_pd(xs + col);
+        __m128d cy = _mm_loadu_pd(ys + col);
+        __m128d x = _mm_setzero_pd(), y = _mm_setzero_pd();
+        __m128d saved_x = x, saved_y = y;
+        __m128i counts = _mm_setzero_si128();
+        int period_limit = 1, period = 0;
+
+        for (int iter = 0; iter < MAX_ITER && _mm_movemask_pd(active); ++iter) {
+            __m128d x2 = _mm_mul_pd(x, x);
+            __m128d y2 = _mm_mul_pd(y, y);
+            __m128d outside = _mm_and_pd(active, _mm_cmpgt_pd(_mm_add_pd(x2, y2), four));
+            escaped = _mm_or_pd(escaped, outside);
+            active = _mm_andnot_pd(outside, active);
+
+            counts = _mm_sub_epi64(counts, _mm_castpd_si128(active));
+            __m128d xy = _mm_mul_pd(x, y);
+            y = _mm_add_pd(_mm_add_pd(xy, xy), cy);
+            x = _mm_add_pd(_mm_sub_pd(x2, y2), cx);
+
+            __m128d cycle = _mm_and_pd(active, _mm_and_pd(_mm_cmpeq_pd(x, saved_x), _mm_cmpeq_pd(y, saved_y)));
+            active = _mm_andnot_pd(cycle, active);
+            if (++period == period_limit) {
+                saved_x = x;
+                saved_y = y;
+                period = 0;
+                period_limit *= 2;
+            }
+        }
+
+        alignas(16) long long lane_counts[lanes];
+        _mm_store_si128(reinterpret_cast<__m128i*>(lane_counts), counts);
+        int escaped_bits = _mm_movemask_pd(escaped);
+        for (int lane = 0; lane < lanes; ++lane) {
+            iters[col + lane] = (escaped_bits >> lane & 1) ? static_cast<int>(lane_counts[lane]) : MAX_ITER;
+        }
+    }
+    for (; col < count; ++col) {
+        iters[col] = mandelbrotFast(xs[col], ys[col]);
+    }
+}
+
+SIMD_TARGET_AVX2 void mandelbrotPointsAvx2(const double* xs, const double* ys, int* iters, int count) {
+    const int lanes = 4;
+    const __m256d four = _mm256_set1_pd(4.0);
+    int col = 0;
+    for (; col + lanes <= count; col += lanes) {
+        alignas(32) long long lane_mask[lanes];
+        for (int lane = 0; lane < lanes; ++lane) {
+            lane_mask[lane] = inMainBulbs(xs[col + lane], ys[col + lane]) ? 0 : -1;
+        }
+
+        __m256d active = _mm256_castsi256_pd(_mm256_load_si256(reinterpret_cast<const __m256i*>(lane_mask)));
+        __m256d escaped = _mm256_setzero_pd();
+        __m256d cx = _mm256_loadu_pd(xs + col);
+        __m256d cy = _mm256_loadu_pd(ys + col);
+        __m256d x = _mm256_setzero_pd(), y = _mm256_setzero_pd();
+        __m256d saved_x = x, saved_y = y;
+        __m256i counts = _mm256_setzero_si256();
+        int period_limit = 1, period = 0;
+
+        for (int iter = 0; iter < MAX_ITER && _mm256_movemask_pd(active); ++iter) {
+            __m256d x2 = _mm256_mul_pd(x, x);
+            __m256d y2 = _mm256_mul_pd(y, y);
+            __m256d outside = _mm256_and_pd(active, _mm256_cmp_pd(_mm256_add_pd(x2, y2), four, _CMP_GT_OQ));
+            escaped = _mm256_or_pd(escaped, outside);
+            active = _mm256_andnot_pd(outside, active);
+
+            // Маска активной дорожки равна -1, поэтому вычитание увеличивает счётчик
+            counts = _mm256_sub_epi64(counts, _mm256_castpd_si256(active));
+            __m256d xy = _mm256_mul_pd(x, y);
+            y = _mm256_add_pd(_mm256_add_pd(xy, xy), cy);
+            x = _mm256_add_pd(_mm256_sub_pd(x2, y2), cx);
+
+            __m256d cycle = _mm256_and_pd(active, _mm256_and_pd(
+                _mm256_cmp_pd(x, saved_x, _CMP_EQ_OQ), _mm256_cmp_pd(y, saved_y, _CMP_EQ_OQ)));
+            active = _mm256_andnot_pd(cycle, active);
+            if (++period == period_limit) {
+                saved_x = x;
+                saved_y = y;
+                period = 0;
+                period_limit *= 2;
+            }
+        }
+
+        alignas(32) long long lane_counts[lanes];
+        _mm256_store_si256(reinterpret_cast<__m256i*>(lane_counts), counts);
+        int escaped_bits = _mm256_movemask_pd(escaped);
+        for (int lane = 0; lane < lanes; ++lane) {
+            iters[col + lane] = (escaped_bits >> lane & 1) ? static_cast<int>(lane_counts[lane]) : MAX_ITER;
+        }
+    }
+    for (; col < count; ++col) {
+        iters[col] = mandelbrotFast(xs[col], ys[col]);
+    }
+}
+
+SIMD_TARGET_AVX512 void mandelbrotPointsAvx512(const double* xs, const double* ys, int* iters, int count) {
+    const int lanes = 8;
+    const __m512d four = _mm512_set1_pd(4.0);
+    int col = 0;
+    for (; col + lanes <= count; col += lanes) {
+        __mmask8 active = 0;
+        for (int lane = 0; lane < lanes; ++lane) {
+            if (!inMainBulbs(xs[col + lane], ys[col + lane])) active |= 1 << lane;
+        }
+
+        __m512d cx = _mm512_loadu_pd(xs + col);
+        __m512d cy = _mm512_loadu_pd(ys + col);
+        __m512d x = _mm512_setzero_pd(), y = _mm512_setzero_pd();
+        __m512d saved_x = x, saved_y = y;
+        __m512i counts = _mm512_setzero_si512();
+        __mmask8 escaped = 0;
+        int period_limit = 1, period = 0;
+
+        for (int iter = 0; iter < MAX_ITER && active; ++iter) {
+            __m512d x2 = _mm512_mul_pd(x, x);
+            __m512d y2 = _mm512_mul_pd(y, y);
+            __mmask8 outside = _mm512_mask_cmp_pd_mask(active, _mm512_add_pd(x2, y2), four, _CMP_GT_OQ);
+            escaped |= outside;
+            active &= ~outside;
+
+            counts = _mm512_mask_add_epi64(counts, active, counts, _mm512_set1_epi64(1));
+            __m512d xy = _mm512_mul_pd(x, y);
+            y = _mm512_add_pd(_mm512_add_pd(xy, xy), cy);
+            x = _mm512_add_pd(_mm512_sub_pd(x2, y2), cx);
+
+            __mmask8 cycle = _mm512_mask_cmp_pd_mask(active, x, saved_x, _CMP_EQ_OQ)
+                & _mm512_cmp_pd_mask(y, saved_y, _CMP_EQ_OQ);
+            active &= ~cycle;
+            if (++period == period_limit) {
+                saved_x = x;
+                saved_y = y;
+                period = 0;
+                period_limit *= 2;
+            }
+        }
+
+        alignas(64) long long lane_counts[lanes];
+        _mm512_store_si512(lane_counts, counts);
+        for (int lane = 0; lane < lanes; ++lane) {
+            iters[col + lane] = (escaped >> lane & 1) ? static_cast<int>(lane_counts[lane]) : MAX_ITER;
+        }
+    }
+    for (; col < count; ++col) {
+        iters[col] = mandelbrotFast(xs[col], ys[col]);
+    }
+}
+
+const SimdKernel<MandelbrotFn> mandelbrotKernel(mandelbrotPointsScalar, mandelbrotPointsSse42,
+    mandelbrotPointsAvx2, mandelbrotPointsAvx512);
+
+// Расчёт count произвольных точек вариантом, выбранным при запуске
+void mandelbrotPoints(const double* xs, const double* ys, int* iters, int count) {
+    mandelbrotKernel.get()(xs, ys, iters, count);
+}
+
+// Расчёт count пикселей строки с общей координатой y0. Буфер ys принадлежит
+// вызывающему и переиспользуется от строки к строке, чтобы не выделять память на
+// каждую строку
+void mandelbrotRow(const double* xs, double y0, int* iters, int count, std::vector<double>& ys) {
+    ys.assign(count, y0);
+    mandelbrotPoints(xs, ys.data(), iters, count);
+}
+
 // Преобразование итераций в красивый цвет
-cv::Vec3b getColor(int iter) {
-    if (iter == MAX_ITER) return cv::Vec3b(0, 0, 0);  // Чёрный для точек внутри множества
+cv::Vec3b getColor(int iter, int max_iter = MAX_ITER) {
+    if (iter == max_iter) return cv::Vec3b(0, 0, 0);  // Чёрный для точек внутри множества
 
-    double t = (double)iter / MAX_ITER;
+    double t = (double)iter / max_iter;
     int r = static_cast<int>(9 * (1 - t) * t * t * t * 255);
     int g = static_cast<int>(15 * (1 - t) * (1 - t) * t * t * 255);
     int b = static_cast<int>(8.5 * (1 - t) * (1 - t) * (1 - t) * t * 255);
@@ -31,38 +274,1181 @@ cv::Vec3b getColor(int iter) {
     return cv::Vec3b(b, g, r);
 }
 
-int main(int argc, char** argv) {
-    MPI_Init(&argc, &argv);
+// Таблица цветов для всех значений 0..MAX_ITER, строится один раз
+const std::vector<cv::Vec3b>& colorTable() {
+    static const std::vector<cv::Vec3b> table = [] {
+        std::vector<cv::Vec3b> colors(MAX_ITER + 1);
+        for (int iter = 0; iter <= MAX_ITER; ++iter) {
+            colors[iter] = getColor(iter);
+        }
+        return colors;
+    }();
+    return table;
+}
 
-    int rank, size;
-    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
-    MPI_Comm_size(MPI_COMM_WORLD, &size);
+// Координаты x0 для всех столбцов кадра
+const std::vector<double>& columnCoords() {
+    static const std::vector<double> xs = [] {
+        std::vector<double> coords(WIDTH);
+        for (int col = 0; col < WIDTH; col++) {
+            coords[col] = (col - WIDTH / 2.0) * 4.0 / WIDTH;
+        }
+        return coords;
+    }();
+    return xs;
+}
+
+// Расчёт строк [start_row, end_row) кадра в буфер rows (WIDTH пикселей BGR на строку)
+void renderRows(cv::Vec3b* rows, int start_row, int end_row) {
+    const std::vector<cv::Vec3b>& colors = colorTable();
+    const std::vector<double>& xs = columnCoords();
+    std::vector<int> iters(WIDTH);
+    std::vector<double> ys(WIDTH);
+
+    PerfRegion region("renderRows");
+    for (int row = start_row; row < end_row; row++) {
+        double y0 = (row - HEIGHT / 2.0) * 4.0 / WIDTH;
+        mandelbrotRow(xs.data(), y0, iters.data(), WIDTH, ys);
+
+        cv::Vec3b* pixels = rows + static_cast<size_t>(row - start_row) * WIDTH;
+        for (int col = 0; col < WIDTH; col++) {
+            pixels[col] = colors[iters[col]];
+        }
+    }
+}
+
+// Сравнение вариантов быстрого ядра с исходным скалярным на одном ядре процессора
+void kernelBenchmark() {
+    const std::vector<double>& xs = columnCoords();
+    std::vector<int> reference(static_cast<size_t>(WIDTH) * HEIGHT);
+    std::vector<int> fast(reference.size());
+
+    double start = MPI_Wtime();
+    for (int row = 0; row < HEIGHT; row++) {
+        double y0 = (row - HEIGHT / 2.0) * 4.0 / WIDTH;
+        for (int col = 0; col < WIDTH; col++) {
+            reference[static_cast<size_t>(row) * WIDTH + col] = mandelbrot(xs[col], y0);
+        }
+    }
+    double reference_time = MPI_Wtime() - start;
+
+    std::cout << "Kernel benchmark " << WIDTH << "x" << HEIGHT << ", selected "
+        << simdLevelName(mandelbrotKernel.level()) << " (CPU " << simdLevelName(simdDetect())
+        << ", override with SIMD_LEVEL):\n";
+    std::cout << "  scalar reference: " << std::fixed << std::setprecision(4) << reference_time << " s\n";
+
+    // Каждый вариант быстрого ядра, доступный процессору
+    std::vector<double> ys(WIDTH);
+    for (SimdLevel level : mandelbrotKernel.levels()) {
+        MandelbrotFn kernel = mandelbrotKernel.at(level);
+        start = MPI_Wtime();
+        for (int row = 0; row < HEIGHT; row++) {
+            std::fill(ys.begin(), ys.end(), (row - HEIGHT / 2.0) * 4.0 / WIDTH);
+            kernel(xs.data(), ys.data(), &fast[static_cast<size_t>(row) * WIDTH], WIDTH);
+        }
+        double fast_time = MPI_Wtime() - start;
+
+        long long mismatches = 0;
+        for (size_t i = 0; i < reference.size(); ++i) {
+            if (reference[i] != fast[i]) mismatches++;
+        }
+
+        std::cout << "  " << std::left << std::setw(7) << simdLevelName(level) << std::right
+            << SIMD_LANES[static_cast<int>(level)] << " lane(s): " << std::setprecision(4) << fast_time
+            << " s, speedup " << std::setprecision(2) << reference_time / fast_time
+            << "x, mismatched pixels " << mismatches << "\n";
+    }
+}
+
+// Положение ядра на модели roofline (один поток процесса 0, лучший из трёх кадров).
+// Операции считаются по определению: 8 на итерацию (x*x, y*y, 2*x*y и сложения);
+// точки главных областей, которые ядро отсекает без итераций, не учитываются,
+// а точки с найденным циклом считаются до MAX_ITER - это эффективная производительность.
+// Обязательный трафик - только запись счётчиков итераций
+void rooflineReport(const RooflineOptions& options) {
+    const std::vector<double>& xs = columnCoords();
+    std::vector<int> iters(static_cast<size_t>(WIDTH) * HEIGHT);
+    std::vector<double> ys(WIDTH);
 
+    double best = 0.0;
+    for (int r = 0; r < 3; ++r) {
+        double start = MPI_Wtime();
+        for (int row = 0; row < HEIGHT; row++) {
+            double y0 = (row - HEIGHT / 2.0) * 4.0 / WIDTH;
+            mandelbrotRow(xs.data(), y0, &iters[static_cast<size_t>(row) * WIDTH], WIDTH, ys);
+        }
+        double time = MPI_Wtime() - start;
+        best = (r == 0) ? time : std::min(best, time);
+    }
+
+    long long iterations = 0;
+    for (int row = 0; row < HEIGHT; row++) {
+        double y0 = (row - HEIGHT / 2.0) * 4.0 / WIDTH;
+        for (int col = 0; col < WIDTH; col++) {
+            if (!inMainBulbs(xs[col], y0)) iterations += iters[static_cast<size_t>(row) * WIDTH + col];
+        }
+    }
+
+    Roofline model("10");
+    model.add("mandelbrot/escape_time", "fp64", 1, 8.0 * iterations, 4.0 * WIDTH * HEIGHT, best);
+    model.report(std::cout);
+    if (!options.csv.empty()) model.appendCsv(options.csv);
+}
+
+// Функция расчёта строк [start_row, end_row) кадра в буфер
+using RowRenderer = std::function<void(cv::Vec3b* rows, int start_row, int end_row)>;
+
+// Статическое разбиение: каждый процесс считает непрерывную полосу строк,
+// полосы собираются через MPI_Gatherv (HEIGHT может не делиться на size)
+double renderStatic(const RowRenderer& render, cv::Mat& final_image, int rank, int size, int& tiles_done) {
     int rows_per_proc = HEIGHT / size;
-    int start_row = rank * rows_per_proc;
-    int end_row = (rank == size - 1) ? HEIGHT : start_row + rows_per_proc;
+    int remainder = HEIGHT % size;
+    int start_row = rank * rows_per_proc + std::min(rank, remainder);
+    int end_row = start_row + rows_per_proc + (rank < remainder ? 1 : 0);
 
     cv::Mat local_image(end_row - start_row, WIDTH, CV_8UC3);
 
+    double busy_start = MPI_Wtime();
+    render(local_image.ptr<cv::Vec3b>(), start_row, end_row);
+    double busy = MPI_Wtime() - busy_start;
+    tiles_done = 1;
+
+    std::vector<int> counts(size), displs(size);
+    for (int i = 0; i < size; ++i) {
+        counts[i] = (rows_per_proc + (i < remainder ? 1 : 0)) * WIDTH * 3;
+        displs[i] = (i == 0) ? 0 : displs[i - 1] + counts[i - 1];
+    }
+
+    MPI_Gatherv(local_image.data, static_cast<int>(local_image.total() * local_image.elemSize()),
+        MPI_UNSIGNED_CHAR, rank == 0 ? final_image.data : nullptr,
+        counts.data(), displs.data(), MPI_UNSIGNED_CHAR, 0, MPI_COMM_WORLD);
+
+    return busy;
+}
+
+// Динамическое распределение: процессы забирают полосы по tile_rows строк
+// из общей очереди - атомарного счётчика в окне MPI на процессе 0 - и
+// записывают готовые полосы прямо в итоговое изображение процесса 0 (MPI_Put)
+double renderDynamic(const RowRenderer& render, cv::Mat& final_image, int rank, int tile_rows, int& tiles_done) {
+    int tile_count = (HEIGHT + tile_rows - 1) / tile_rows;
+    int row_bytes = WIDTH * 3;
+
+    int* counter = nullptr;
+    MPI_Win counter_win;
+    MPI_Win_allocate(rank == 0 ? sizeof(int) : 0, sizeof(int), MPI_INFO_NULL, MPI_COMM_WORLD,
+        &counter, &counter_win);
+    if (rank == 0) {
+        *counter = 0;
+    }
+
+    MPI_Win image_win;
+    MPI_Win_create(rank == 0 ? final_image.data : nullptr,
+        rank == 0 ? static_cast<MPI_Aint>(HEIGHT) * row_bytes : 0, 1,
+        MPI_INFO_NULL, MPI_COMM_WORLD, &image_win);
+
+    MPI_Barrier(MPI_COMM_WORLD);
+    MPI_Win_lock_all(0, counter_win);
+    MPI_Win_lock_all(0, image_win);
+
+    std::vector<cv::Vec3b> tile(static_cast<size_t>(tile_rows) * WIDTH);
+    double busy = 0.0;
+    tiles_done = 0;
+    const int one = 1;
+
+    while (true) {
+        int next = 0;
+        MPI_Fetch_and_op(&one, &next, MPI_INT, 0, 0, MPI_SUM, counter_win);
+        MPI_Win_flush(0, counter_win);
+        if (next >= tile_count) {
+            break;
+        }
+
+        int start_row = next * tile_rows;
+        int end_row = std::min(HEIGHT, start_row + tile_rows);
+
+        double busy_start = MPI_Wtime();
+        render(tile.data(), start_row, end_row);
+        busy += MPI_Wtime() - busy_start;
+        tiles_done++;
+
+        MPI_Put(tile.data(), (end_row - start_row) * row_bytes, MPI_UNSIGNED_CHAR, 0,
+            static_cast<MPI_Aint>(start_row) * row_bytes, (end_row - start_row) * row_bytes,
+            MPI_UNSIGNED_CHAR, image_win);
+        // Буфер полосы можно использовать снова только после локального завершения
+        MPI_Win_flush_local(0, image_win);
+    }
+
+    MPI_Win_unlock_all(image_win);
+    MPI_Win_unlock_all(counter_win);
+    MPI_Barrier(MPI_COMM_WORLD);
+
+    MPI_Win_free(&image_win);
+    MPI_Win_free(&counter_win);
+    return busy;
+}
+
+// ==================== Глубокое увеличение ====================
+
+// Число с фиксированной точкой произвольной точности: знак и модуль,
+// digits[0] - целая часть, digits[1..] - дробные 32-битные разряды
+class BigFixed {
+public:
+    explicit BigFixed(int limbs = 2) : negative(false), digits(limbs, 0) {}
+
+    // Разбор десятичной записи вида "-0.743643887037158704752191506114774"
+    static BigFixed fromString(const std::string& text, int limbs) {
+        BigFixed value(limbs);
+        size_t pos = 0;
+        bool negative = false;
+        if (pos < text.size() && (text[pos] == '-' || text[pos] == '+')) {
+            negative = text[pos] == '-';
+            pos++;
+        }
+        size_t point = text.find('.', pos);
+        std::string integer = text.substr(pos, point == std::string::npos ? std::string::npos : point - pos);
+        std::string fraction = point == std::string::npos ? "" : text.substr(point + 1);
+
+        // Дробная часть по схеме Горнера справа налево: f = (d + f) / 10
+        for (auto it = fraction.rbegin(); it != fraction.rend(); ++it) {
+            value.digits[0] = static_cast<uint32_t>(*it - '0');
+            value.divideSmall(10);
+        }
+        value.digits[0] = integer.empty() ? 0 : static_cast<uint32_t>(std::stoul(integer));
+        value.negative = negative && !value.isZero();
+        return value;
+    }
+
+    double toDouble() const {
+        double result = 0.0;
+        double weight = 1.0;
+        for (size_t i = 0; i < digits.size() && i < 4; ++i) {
+            result += digits[i] * weight;
+            weight /= 4294967296.0;
+        }
+        return negative ? -result : result;
+    }
+
+    BigFixed operator+(const BigFixed& other) const {
+        if (negative == other.negative) {
+            BigFixed result = *this;
+            result.addMagnitude(other);
+            return result;
+        }
+        // Разные знаки: из большего модуля вычитается меньший
+        bool this_larger = compareMagnitude(other) >= 0;
+        BigFixed result = this_larger ? *this : other;
+        result.subtractMagnitude(this_larger ? other : *this);
+        result.negative = result.isZero() ? false : (this_larger ? negative : other.negative);
+        return result;
+    }
+
+    BigFixed operator-(const BigFixed& other) const {
+        BigFixed negated = other;
+        negated.negative = !other.negative && !other.isZero();
+        return *this + negated;
+    }
+
+    // Умножение с отбрасыванием разрядов младше последнего
+    BigFixed operator*(const BigFixed& other) const {
+        int limbs = static_cast<int>(digits.size());
+        std::vector<uint64_t> acc(2 * limbs, 0);
+        for (int i = 0; i < limbs; ++i) {
+            if (digits[i] == 0) continue;
+            for (int j = 0; j < limbs; ++j) {
+                uint64_t product = static_cast<uint64_t>(digits[i]) * other.digits[j];
+                acc[i + j] += product & 0xFFFFFFFFu;
+                if (i + j > 0) acc[i + j - 1] += product >> 32;
+            }
+        }
+        for (int k = 2 * limbs - 1; k > 0; --k) {
+            acc[k - 1] += acc[k] >> 32;
+            acc[k] &= 0xFFFFFFFFu;
+        }
+
+        BigFixed result(limbs);
+        for (int k = 0; k < limbs; ++k) {
+            result.digits[k] = static_cast<uint32_t>(acc[k]);
+        }
+        result.negative = (negative != other.negative) && !result.isZero();
+        return result;
+    }
+
+private:
+    bool negative;
+    std::vector<uint32_t> digits;
+
+    bool isZero() const {
+        for (uint32_t d : digits) if (d) return false;
+        return true;
+    }
+
+    int compareMagnitude(const BigFixed& other) const {
+        for (size_t i = 0; i < digits.size(); ++i) {
+            if (digits[i] != other.digits[i]) return digits[i] < other.digits[i] ? -1 : 1;
+        }
+        return 0;
+    }
+
+    void addMagnitude(const BigFixed& other) {
+        uint64_t carry = 0;
+        for (size_t i = digits.size(); i-- > 0; ) {
+            uint64_t sum = static_cast<uint64_t>(digits[i]) + other.digits[i] + carry;
+            digits[i] = static_cast<uint32_t>(sum);
+            carry = sum >> 32;
+        }
+    }
+
+    // Вычитание меньшего модуля
+    void subtractMagnitude(const BigFixed& other) {
+        int64_t borrow = 0;
+        for (size_t i = digits.size(); i-- > 0; ) {
+            int64_t diff = static_cast<int64_t>(digits[i]) - other.digits[i] - borrow;
+            borrow = diff < 0 ? 1 : 0;
+            digits[i] = static_cast<uint32_t>(diff + (borrow << 32));
+        }
+    }
+
+    void divideSmall(uint32_t divisor) {
+        uint64_t remainder = 0;
+        for (size_t i = 0; i < digits.size(); ++i) {
+            uint64_t current = (remainder << 32) | digits[i];
+            digits[i] = static_cast<uint32_t>(current / divisor);
+            remainder = current % divisor;
+        }
+    }
+};
+
+// Кадр глубокого увеличения: эталонная орбита Z_n в центре кадра, посчитанная
+// с высокой точностью, и коэффициенты ряда для пропуска первых итераций.
+// Остальные пиксели считаются как возмущение delta_n = z_n - Z_n в double:
+//   delta_{n+1} = (2 Z_n + delta_n) delta_n + delta_c
+struct DeepView {
+    std::vector<double> zr, zi;  // эталонная орбита, округлённая до double
+    int max_iter = 0;
+    double spacing = 0.0;        // шаг пикселя в комплексной плоскости
+    int skip = 0;                // итерации, заменяемые рядом
+    double ar = 0, ai = 0, br = 0, bi = 0, cr = 0, ci = 0;  // коэффициенты ряда на шаге skip
+};
+
+// Расчёт эталонной орбиты точки (re, im) числами BigFixed.
+// Точность выбирается по масштабу: разрядов на 64 бита больше, чем -log2(scale)
+void computeReferenceOrbit(const std::string& re, const std::string& im, double scale, int max_iter,
+    std::vector<double>& zr, std::vector<double>& zi) {
+    int bits = static_cast<int>(std::ceil(-std::log2(scale))) + 64;
+    int limbs = std::max(2, bits / 32 + 2);
+
+    BigFixed cx = BigFixed::fromString(re, limbs);
+    BigFixed cy = BigFixed::fromString(im, limbs);
+    BigFixed x(limbs), y(limbs);
+
+    zr.assign(1, 0.0);
+    zi.assign(1, 0.0);
+    for (int n = 0; n < max_iter; ++n) {
+        BigFixed x2 = x * x;
+        BigFixed y2 = y * y;
+        BigFixed xy = x * y;
+        y = xy + xy + cy;
+        x = x2 - y2 + cx;
+
+        double dx = x.toDouble(), dy = y.toDouble();
+        zr.push_back(dx);
+        zi.push_back(dy);
+        if (dx * dx + dy * dy > 4.0) break;
+    }
+}
+
+// Аппроксимация рядом: delta_n = A_n dc + B_n dc^2 + C_n dc^3, где
+//   A_{n+1} = 2 Z_n A_n + 1,  B_{n+1} = 2 Z_n B_n + A_n^2,  C_{n+1} = 2 Z_n C_n + 2 A_n B_n.
+// Ряд используется, пока член третьего порядка пренебрежимо мал по сравнению
+// с линейным для самого дальнего от центра пикселя (радиус radius) и пока
+// ни один пиксель кадра не мог уйти на бесконечность
+void setupSeries(DeepView& view, double radius) {
+    double ar = 0, ai = 0, br = 0, bi = 0, cr = 0, ci = 0;
+    int limit = static_cast<int>(view.zr.size()) - 1;
+
+    view.skip = 0;
+    view.ar = view.ai = view.br = view.bi = view.cr = view.ci = 0.0;
+    for (int n = 0; n < limit; ++n) {
+        double zr2 = 2 * view.zr[n], zi2 = 2 * view.zi[n];
+        double nar = zr2 * ar - zi2 * ai + 1;
+        double nai = zr2 * ai + zi2 * ar;
+        double nbr = zr2 * br - zi2 * bi + (ar * ar - ai * ai);
+        double nbi = zr2 * bi + zi2 * br + 2 * ar * ai;
+        double ncr = zr2 * cr - zi2 * ci + 2 * (ar * br - ai * bi);
+        double nci = zr2 * ci + zi2 * cr + 2 * (ar * bi + ai * br);
+
+        double linear = std::hypot(nar, nai) * radius;
+        double cubic = std::hypot(ncr, nci) * radius * radius * radius;
+        if (!std::isfinite(cubic) || cubic > 1e-13 * linear) break;
+
+        double reach = std::hypot(view.zr[n + 1], view.zi[n + 1]) + linear
+            + std::hypot(nbr, nbi) * radius * radius + cubic;
+        if (reach > 2.0) break;
+
+        ar = nar; ai = nai; br = nbr; bi = nbi; cr = ncr; ci = nci;
+        view.skip = n + 1;
+        view.ar = ar; view.ai = ai; view.br = br; view.bi = bi; view.cr = cr; view.ci = ci;
+    }
+}
+
+// Число итераций пикселя со смещением (dcr, dci) от центра кадра.
+// Глитчи устраняются ребазированием: если |z| < |delta| или эталонная
+// орбита закончилась, отсчёт продолжается от её начала с delta = z
+int deepPixel(const DeepView& view, double dcr, double dci, long long& rebases) {
+    // Начальное возмущение по ряду
+    double dc2r = dcr * dcr - dci * dci, dc2i = 2 * dcr * dci;
+    double dc3r = dc2r * dcr - dc2i * dci, dc3i = dc2r * dci + dc2i * dcr;
+    double dr = view.ar * dcr - view.ai * dci + view.br * dc2r - view.bi * dc2i + view.cr * dc3r - view.ci * dc3i;
+    double di = view.ar * dci + view.ai * dcr + view.br * dc2i + view.bi * dc2r + view.cr * dc3i + view.ci * dc3r;
+
+    int last = static_cast<int>(view.zr.size()) - 1;
+    int n = view.skip;
+    for (int iter = view.skip; iter < view.max_iter; ++iter) {
+        double zr = view.zr[n] + dr, zi = view.zi[n] + di;
+        double magnitude = zr * zr + zi * zi;
+        if (magnitude > 4.0) return iter;
+
+        if (magnitude < dr * dr + di * di || n == last) {
+            dr = zr;
+            di = zi;
+            n = 0;
+            rebases++;
+        }
+
+        double tr = 2 * view.zr[n] + dr, ti = 2 * view.zi[n] + di;
+        double nr = tr * dr - ti * di + dcr;
+        double ni = tr * di + ti * dr + dci;
+        dr = nr;
+        di = ni;
+        n++;
+    }
+    return view.max_iter;
+}
+
+// Расчёт строк кадра глубокого увеличения; палитра повторяется каждые MAX_ITER итераций
+void renderDeepRows(const DeepView& view, cv::Vec3b* rows, int start_row, int end_row, long long& rebases) {
+    const std::vector<cv::Vec3b>& colors = colorTable();
+    PerfRegion region("renderDeepRows");
     for (int row = start_row; row < end_row; row++) {
+        double dci = (row - HEIGHT / 2.0) * view.spacing;
+        cv::Vec3b* pixels = rows + static_cast<size_t>(row - start_row) * WIDTH;
         for (int col = 0; col < WIDTH; col++) {
-            double x0 = (col - WIDTH / 2.0) * 4.0 / WIDTH;
+            double dcr = (col - WIDTH / 2.0) * view.spacing;
+            int iter = deepPixel(view, dcr, dci, rebases);
+            pixels[col] = (iter >= view.max_iter) ? cv::Vec3b(0, 0, 0) : colors[iter % MAX_ITER];
+        }
+    }
+}
+
+// Расчёт кадра выбранным способом распределения работы с отчётом о загрузке процессов
+void renderFrame(const RowRenderer& render, bool use_static, int tile_rows, cv::Mat& final_image,
+    int rank, int size) {
+    // Одному процессу очередь не нужна
+    if (size == 1) {
+        use_static = true;
+    }
+
+    MPI_Barrier(MPI_COMM_WORLD);
+    double start_time = MPI_Wtime();
+
+    int tiles_done = 0;
+    double busy = use_static
+        ? renderStatic(render, final_image, rank, size, tiles_done)
+        : renderDynamic(render, final_image, rank, tile_rows, tiles_done);
+
+    double total_time = MPI_Wtime() - start_time;
+
+    // Время занятости каждого процесса
+    std::vector<double> all_busy(size);
+    std::vector<int> all_tiles(size);
+    MPI_Gather(&busy, 1, MPI_DOUBLE, all_busy.data(), 1, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+    MPI_Gather(&tiles_done, 1, MPI_INT, all_tiles.data(), 1, MPI_INT, 0, MPI_COMM_WORLD);
+
+    if (rank == 0) {
+        double max_busy = *std::max_element(all_busy.begin(), all_busy.end());
+        double sum_busy = 0.0;
+        for (double b : all_busy) sum_busy += b;
+
+        std::cout << "Schedule: " << (use_static ? "static bands" : "dynamic, " + std::to_string(tile_rows) + " rows per tile")
+            << ", " << size << " process(es)\n";
+        for (int r = 0; r < size; ++r) {
+            std::cout << "  rank " << r << ": busy " << std::fixed << std::setprecision(4) << all_busy[r]
+                << " s, tiles " << all_tiles[r] << "\n";
+        }
+        std::cout << "Total time: " << total_time << " s\n";
+        std::cout << "Load imbalance (max / mean busy): " << std::setprecision(2)
+            << max_busy / (sum_busy / size) << "\n";
+        std::cout << "Speedup over serial busy time: " << sum_busy / total_time << "x\n";
+    }
+}
+
+// Серия кадров глубокого увеличения в точку (re, im) от полного вида до масштаба scale
+// (полуширина кадра). Эталонная орбита считается один раз на процессе 0 с точностью
+// последнего кадра и рассылается остальным
+void renderDeepZoom(const std::string& re, const std::string& im, double scale, int max_iter, int frames,
+    bool use_static, int tile_rows, cv::Mat& final_image, int rank, int size) {
+    DeepView view;
+    view.max_iter = max_iter;
+
+    double orbit_start = MPI_Wtime();
+    int orbit_length = 0;
+    if (rank == 0) {
+        computeReferenceOrbit(re, im, scale, max_iter, view.zr, view.zi);
+        orbit_length = static_cast<int>(view.zr.size());
+    }
+    MPI_Bcast(&orbit_length, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    view.zr.resize(orbit_length);
+    view.zi.resize(orbit_length);
+    MPI_Bcast(view.zr.data(), orbit_length, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+    MPI_Bcast(view.zi.data(), orbit_length, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+
+    if (rank == 0) {
+        std::cout << "Reference orbit: " << orbit_length - 1 << " iterations in "
+            << std::fixed << std::setprecision(4) << MPI_Wtime() - orbit_start << " s\n";
+    }
+
+    const double start_scale = 2.0;
+    for (int frame = 0; frame < frames; ++frame) {
+        double t = (frames > 1) ? static_cast<double>(frame) / (frames - 1) : 1.0;
+        double frame_scale = start_scale * std::pow(scale / start_scale, t);
+        view.spacing = 2.0 * frame_scale / WIDTH;
+        setupSeries(view, std::hypot(WIDTH / 2.0, HEIGHT / 2.0) * view.spacing);
+
+        long long rebases = 0;
+        renderFrame([&](cv::Vec3b* rows, int start_row, int end_row) {
+            renderDeepRows(view, rows, start_row, end_row, rebases);
+            }, use_static, tile_rows, final_image, rank, size);
+
+        long long total_rebases = 0;
+        MPI_Reduce(&rebases, &total_rebases, 1, MPI_LONG_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
+
+        if (rank == 0) {
+            char name[64];
+            std::snprintf(name, sizeof(name), frames > 1 ? "mandelbrot_deep_%04d.png" : "mandelbrot_deep.png", frame);
+            std::cout << "Frame " << frame << ": scale " << std::scientific << std::setprecision(3) << frame_scale
+                << std::fixed << ", series skipped " << view.skip << " iterations, "
+                << total_rebases << " glitch rebases -> " << name << "\n\n";
+            cv::imwrite(name, final_image);
+        }
+    }
+}
+
+// ==================== Сглаживание границ ====================
+
+// Детерминированный псевдослучайный сдвиг в [0, 1) для подвыборки пикселя:
+// результат не зависит от числа процессов и порядка расчёта
+double jitter(uint64_t pixel, int sample) {
+    uint64_t z = pixel * 0x9E3779B97F4A7C15ULL + static_cast<uint64_t>(sample) * 0xD1B54A32D192ED03ULL + 1;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    z ^= z >> 31;
+    return (z >> 11) * (1.0 / 9007199254740992.0);
+}
+
+// Средний цвет пикселя по n x n подвыборкам: по одной случайной точке
+// в каждой клетке сетки n x n (jittered sampling)
+cv::Vec3b supersample(int col, int row, int n) {
+    const std::vector<cv::Vec3b>& colors = colorTable();
+    uint64_t pixel = static_cast<uint64_t>(row) * WIDTH + col;
+    int count = n * n;
+    std::vector<double> xs(count), ys(count);
+    std::vector<int> iters(count);
+    for (int sy = 0; sy < n; ++sy) {
+        for (int sx = 0; sx < n; ++sx) {
+            int sample = sy * n + sx;
+            xs[sample] = (col - 0.5 + (sx + jitter(pixel, 2 * sample)) / n - WIDTH / 2.0) * 4.0 / WIDTH;
+            ys[sample] = (row - 0.5 + (sy + jitter(pixel, 2 * sample + 1)) / n - HEIGHT / 2.0) * 4.0 / WIDTH;
+        }
+    }
+    mandelbrotPoints(xs.data(), ys.data(), iters.data(), count);
+
+    int sum[3] = { 0, 0, 0 };
+    for (int sample = 0; sample < count; ++sample) {
+        const cv::Vec3b& color = colors[iters[sample]];
+        for (int c = 0; c < 3; ++c) sum[c] += color[c];
+    }
+    return cv::Vec3b((sum[0] + count / 2) / count, (sum[1] + count / 2) / count, (sum[2] + count / 2) / count);
+}
+
+// Пиксель на границе: цвет хотя бы одного из 8 соседей отличается больше чем на threshold
+bool isEdge(const std::vector<int>& iters, int col, int row, int threshold) {
+    const std::vector<cv::Vec3b>& colors = colorTable();
+    const cv::Vec3b& center = colors[iters[static_cast<size_t>(row) * WIDTH + col]];
+    for (int dy = -1; dy <= 1; ++dy) {
+        int y = row + dy;
+        if (y < 0 || y >= HEIGHT) continue;
+        for (int dx = -1; dx <= 1; ++dx) {
+            int x = col + dx;
+            if (x < 0 || x >= WIDTH || (dx == 0 && dy == 0)) continue;
+            const cv::Vec3b& other = colors[iters[static_cast<size_t>(y) * WIDTH + x]];
+            for (int c = 0; c < 3; ++c) {
+                if (std::abs(center[c] - other[c]) > threshold) return true;
+            }
+        }
+    }
+    return false;
+}
+
+// Сглаженный кадр: базовая сетка считается один раз полосами, затем n x n подвыборок
+// получают только граничные пиксели, распределённые по процессам через один
+void renderAntialiased(int n, int threshold, bool check, cv::Mat& final_image, int rank, int size) {
+    MPI_Barrier(MPI_COMM_WORLD);
+    double start_time = MPI_Wtime();
+
+    // Базовая сетка: каждому процессу нужны итерации всего кадра для поиска границ
+    int rows_per_proc = HEIGHT / size;
+    int remainder = HEIGHT % size;
+    std::vector<int> counts(size), displs(size);
+    for (int i = 0; i < size; ++i) {
+        counts[i] = (rows_per_proc + (i < remainder ? 1 : 0)) * WIDTH;
+        displs[i] = (i == 0) ? 0 : displs[i - 1] + counts[i - 1];
+    }
+    int start_row = displs[rank] / WIDTH;
+    int end_row = start_row + counts[rank] / WIDTH;
+
+    const std::vector<double>& xs = columnCoords();
+    std::vector<int> iters(static_cast<size_t>(WIDTH) * HEIGHT);
+    std::vector<int> local_iters(counts[rank]);
+    std::vector<double> ys(WIDTH);
+    {
+        PerfRegion region("antialias base grid");
+        for (int row = start_row; row < end_row; ++row) {
             double y0 = (row - HEIGHT / 2.0) * 4.0 / WIDTH;
+            mandelbrotRow(xs.data(), y0, &local_iters[static_cast<size_t>(row - start_row) * WIDTH], WIDTH, ys);
+        }
+    }
+    MPI_Allgatherv(local_iters.data(), counts[rank], MPI_INT, iters.data(), counts.data(), displs.data(),
+        MPI_INT, MPI_COMM_WORLD);
+    double base_time = MPI_Wtime() - start_time;
+
+    // Список граничных пикселей одинаков на всех процессах
+    std::vector<int> edges;
+    for (int row = 0; row < HEIGHT; ++row) {
+        for (int col = 0; col < WIDTH; ++col) {
+            if (isEdge(iters, col, row, threshold)) edges.push_back(row * WIDTH + col);
+        }
+    }
+
+    // Процесс rank берёт граничные пиксели rank, rank + size, ... - так соседние
+    // (и одинаково дорогие) пиксели расходятся по разным процессам
+    std::vector<cv::Vec3b> local_colors;
+    {
+        PerfRegion region("antialias edge samples");
+        for (size_t e = rank; e < edges.size(); e += size) {
+            local_colors.push_back(supersample(edges[e] % WIDTH, edges[e] / WIDTH, n));
+        }
+    }
+
+    std::vector<int> edge_counts(size), edge_displs(size);
+    for (int i = 0; i < size; ++i) {
+        edge_counts[i] = static_cast<int>((edges.size() + size - 1 - i) / size) * 3;
+        edge_displs[i] = (i == 0) ? 0 : edge_displs[i - 1] + edge_counts[i - 1];
+    }
+    std::vector<cv::Vec3b> edge_colors(rank == 0 ? edges.size() : 0);
+    MPI_Gatherv(local_colors.data(), static_cast<int>(local_colors.size()) * 3, MPI_UNSIGNED_CHAR,
+        edge_colors.data(), edge_counts.data(), edge_displs.data(), MPI_UNSIGNED_CHAR, 0, MPI_COMM_WORLD);
+    double total_time = MPI_Wtime() - start_time;
+
+    if (rank == 0) {
+        const std::vector<cv::Vec3b>& colors = colorTable();
+        for (int row = 0; row < HEIGHT; ++row) {
+            cv::Vec3b* pixels = final_image.ptr<cv::Vec3b>(row);
+            for (int col = 0; col < WIDTH; ++col) {
+                pixels[col] = colors[iters[static_cast<size_t>(row) * WIDTH + col]];
+            }
+        }
+        // Цвета процесса r лежат подряд начиная с edge_displs[r] / 3
+        for (int r = 0; r < size; ++r) {
+            size_t next = edge_displs[r] / 3;
+            for (size_t e = r; e < edges.size(); e += size) {
+                final_image.ptr<cv::Vec3b>(edges[e] / WIDTH)[edges[e] % WIDTH] = edge_colors[next++];
+            }
+        }
+
+        long long full_samples = static_cast<long long>(WIDTH) * HEIGHT * n * n;
+        long long samples = static_cast<long long>(WIDTH) * HEIGHT + static_cast<long long>(edges.size()) * n * n;
+        std::cout << "Antialiasing " << n << "x" << n << " on edges, " << size << " process(es)\n";
+        std::cout << "  edge pixels: " << edges.size() << " (" << std::fixed << std::setprecision(2)
+            << 100.0 * edges.size() / (static_cast<double>(WIDTH) * HEIGHT) << "%)\n";
+        std::cout << "  samples: " << samples << " vs " << full_samples << " for full supersampling ("
+            << 100.0 * samples / full_samples << "%)\n";
+        std::cout << "  base grid: " << std::setprecision(4) << base_time << " s, total: " << total_time << " s\n";
+        cv::imwrite("mandelbrot_aa.png", final_image);
+    }
+
+    if (!check) return;
+
+    // Проверка качества: полное n x n сглаживание тем же узором подвыборок
+    cv::Mat full_image;
+    if (rank == 0) {
+        full_image.create(HEIGHT, WIDTH, CV_8UC3);
+    }
+    MPI_Barrier(MPI_COMM_WORLD);
+    double full_start = MPI_Wtime();
+    int tiles_done = 0;
+    renderStatic([n](cv::Vec3b* rows, int first_row, int last_row) {
+        for (int row = first_row; row < last_row; ++row) {
+            for (int col = 0; col < WIDTH; ++col) {
+                rows[static_cast<size_t>(row - first_row) * WIDTH + col] = supersample(col, row, n);
+            }
+        }
+        }, full_image, rank, size, tiles_done);
+    double full_time = MPI_Wtime() - full_start;
+
+    if (rank == 0) {
+        long long mismatches = 0;
+        int max_diff = 0;
+        double sum_diff = 0.0;
+        for (int row = 0; row < HEIGHT; ++row) {
+            const cv::Vec3b* a = final_image.ptr<cv::Vec3b>(row);
+            const cv::Vec3b* b = full_image.ptr<cv::Vec3b>(row);
+            for (int col = 0; col < WIDTH; ++col) {
+                if (a[col] != b[col]) mismatches++;
+                for (int c = 0; c < 3; ++c) {
+                    int diff = std::abs(a[col][c] - b[col][c]);
+                    max_diff = std::max(max_diff, diff);
+                    sum_diff += diff;
+                }
+            }
+        }
+        std::cout << "Full supersampling: " << std::setprecision(4) << full_time << " s ("
+            << std::setprecision(1) << full_time / total_time << "x slower)\n";
+        std::cout << "  differing pixels: " << mismatches << ", max channel difference: " << max_diff
+            << ", mean: " << std::setprecision(4) << sum_diff / (3.0 * WIDTH * HEIGHT) << "\n";
+    }
+}
+
+// ==================== Просмотр с кэшем плиток ====================
+
+// Окно просмотра: центр и полуширина по оси x
+struct Viewport {
+    double center_x;
+    double center_y;
+    double scale;
+};
+
+const int TILE_SIZE = 128;   // сторона плитки в пикселях
+const int MAX_ZOOM = 40;     // глубже не хватает точности double в координатах пикселей
+const int INTERIOR = -1;     // точка доказанно принадлежит множеству (найден цикл)
+
+// Ключ плитки квадродерева: уровень zoom делит квадрат [-2, 2]^2 на 2^zoom x 2^zoom плиток
+struct TileKey {
+    int zoom;
+    long long tx, ty;
+    int max_iter;
+
+    bool operator<(const TileKey& other) const {
+        return std::tie(zoom, tx, ty, max_iter) < std::tie(other.zoom, other.tx, other.ty, other.max_iter);
+    }
+    bool samePlace(const TileKey& other) const {
+        return zoom == other.zoom && tx == other.tx && ty == other.ty;
+    }
+};
+
+// Плитка хранит числа итераций, а не цвета: её можно показать с любым max_iter не больше
+// своего, а точки, не ушедшие за max_iter, сохраняют z для продолжения счёта
+struct Tile {
+    int max_iter = 0;
+    std::vector<int> iters;          // итерации до ухода, INTERIOR или max_iter
+    std::vector<int> pending;        // пиксели, не ушедшие за max_iter итераций
+    std::vector<double> pending_z;   // их z = (re, im) после max_iter итераций
+
+    size_t bytes() const {
+        return sizeof(Tile) + iters.capacity() * sizeof(int) + pending.capacity() * sizeof(int)
+            + pending_z.capacity() * sizeof(double);
+    }
+};
+
+// Шаг пикселя плитки на уровне zoom
+double tileSpacing(int zoom) {
+    return std::ldexp(4.0 / TILE_SIZE, -zoom);
+}
 
-            int iter = mandelbrot(x0, y0);
-            local_image.at<cv::Vec3b>(row - start_row, col) = getColor(iter);
+// Деление с округлением вниз для отрицательных номеров пикселей
+long long floorDiv(long long a, long long b) {
+    return a >= 0 ? a / b : -((-a + b - 1) / b);
+}
+
+// Продолжение орбиты точки (x0, y0) из состояния z = (x, y) после iter итераций до max_iter.
+// Возвращает число итераций до ухода, INTERIOR при найденном цикле или max_iter;
+// для z = 0, iter = 0 результат совпадает с mandelbrotFast
+int continueOrbit(double x0, double y0, double& x, double& y, int iter, int max_iter) {
+    double saved_x = x, saved_y = y;
+    int period_limit = 1, period = 0;
+    for (; iter < max_iter; ++iter) {
+        double x2 = x * x, y2 = y * y;
+        if (x2 + y2 > 4.0) return iter;
+
+        y = 2 * x * y + y0;
+        x = x2 - y2 + x0;
+
+        if (x == saved_x && y == saved_y) return INTERIOR;
+        if (++period == period_limit) {
+            saved_x = x;
+            saved_y = y;
+            period = 0;
+            period_limit *= 2;
+        }
+    }
+    return max_iter;
+}
+
+// Расчёт плитки key; если есть та же плитка с меньшим max_iter, досчитываются
+// только её неушедшие точки
+std::shared_ptr<Tile> computeTile(const TileKey& key, const Tile* previous) {
+    PerfRegion region("computeTile");
+    auto tile = std::make_shared<Tile>();
+    tile->max_iter = key.max_iter;
+    double spacing = tileSpacing(key.zoom);
+    long long gx0 = key.tx * TILE_SIZE;
+    long long gy0 = key.ty * TILE_SIZE;
+
+    auto finish = [&](int index, int iter, double x, double y) {
+        tile->iters[index] = iter;
+        if (iter == key.max_iter) {
+            tile->pending.push_back(index);
+            tile->pending_z.push_back(x);
+            tile->pending_z.push_back(y);
+        }
+    };
+
+    if (previous) {
+        tile->iters = previous->iters;
+        for (size_t p = 0; p < previous->pending.size(); ++p) {
+            int index = previous->pending[p];
+            double x0 = (gx0 + index % TILE_SIZE) * spacing - 2.0;
+            double y0 = (gy0 + index / TILE_SIZE) * spacing - 2.0;
+            double x = previous->pending_z[2 * p], y = previous->pending_z[2 * p + 1];
+            int iter = continueOrbit(x0, y0, x, y, previous->max_iter, key.max_iter);
+            finish(index, iter, x, y);
+        }
+    }
+    else {
+        tile->iters.resize(TILE_SIZE * TILE_SIZE);
+        for (int row = 0; row < TILE_SIZE; ++row) {
+            double y0 = (gy0 + row) * spacing - 2.0;
+            for (int col = 0; col < TILE_SIZE; ++col) {
+                double x0 = (gx0 + col) * spacing - 2.0;
+                int index = row * TILE_SIZE + col;
+                if (inMainBulbs(x0, y0)) {
+                    tile->iters[index] = INTERIOR;
+                    continue;
+                }
+                double x = 0.0, y = 0.0;
+                int iter = continueOrbit(x0, y0, x, y, 0, key.max_iter);
+                finish(index, iter, x, y);
+            }
+        }
+    }
+
+    tile->pending.shrink_to_fit();
+    tile->pending_z.shrink_to_fit();
+    return tile;
+}
+
+// Отрисовка произвольного окна просмотра из плиток квадродерева с LRU-кэшем
+// ограниченного объёма: при сдвиге и масштабировании считаются только новые плитки
+class TileRenderer {
+public:
+    struct Stats {
+        int tiles = 0;      // плиток в кадре
+        int reused = 0;     // взято из кэша
+        int resumed = 0;    // досчитано после увеличения max_iter
+        int computed = 0;   // посчитано заново
+        int evicted = 0;    // вытеснено из кэша
+    };
+
+    explicit TileRenderer(size_t budget_bytes) : budget(budget_bytes) {}
+
+    cv::Mat render(const Viewport& view, int width, int height, int max_iter) {
+        stats = Stats();
+
+        // Самый крупный уровень, плитки которого не грубее пикселей экрана
+        double pixel = 2.0 * view.scale / width;
+        int zoom = static_cast<int>(std::ceil(std::log2(tileSpacing(0) / pixel) - 1e-9));
+        zoom = std::max(0, std::min(MAX_ZOOM, zoom));
+        double spacing = tileSpacing(zoom);
+        double ratio = pixel / spacing;
+
+        // Номер пикселя плитки под центром каждого столбца и строки экрана
+        double u0 = (view.center_x + 2.0) / spacing - width / 2.0 * ratio;
+        double v0 = (view.center_y + 2.0) / spacing - height / 2.0 * ratio;
+        std::vector<long long> gx(width), gy(height);
+        for (int col = 0; col < width; ++col) gx[col] = static_cast<long long>(std::floor(u0 + (col + 0.5) * ratio));
+        for (int row = 0; row < height; ++row) gy[row] = static_cast<long long>(std::floor(v0 + (row + 0.5) * ratio));
+
+        long long tx0 = floorDiv(gx.front(), TILE_SIZE), tx1 = floorDiv(gx.back(), TILE_SIZE);
+        long long ty0 = floorDiv(gy.front(), TILE_SIZE), ty1 = floorDiv(gy.back(), TILE_SIZE);
+        long long tiles_x = tx1 - tx0 + 1;
+
+        std::vector<std::shared_ptr<const Tile>> grid;
+        for (long long ty = ty0; ty <= ty1; ++ty) {
+            for (long long tx = tx0; tx <= tx1; ++tx) {
+                grid.push_back(acquire({ zoom, tx, ty, max_iter }));
+            }
+        }
+        stats.tiles = static_cast<int>(grid.size());
+
+        std::vector<cv::Vec3b> colors(max_iter + 1);
+        for (int iter = 0; iter <= max_iter; ++iter) {
+            colors[iter] = getColor(iter, max_iter);
+        }
+
+        std::vector<int> tile_col(width), pixel_col(width);
+        for (int col = 0; col < width; ++col) {
+            long long tx = floorDiv(gx[col], TILE_SIZE);
+            tile_col[col] = static_cast<int>(tx - tx0);
+            pixel_col[col] = static_cast<int>(gx[col] - tx * TILE_SIZE);
+        }
+
+        cv::Mat image(height, width, CV_8UC3);
+        for (int row = 0; row < height; ++row) {
+            long long ty = floorDiv(gy[row], TILE_SIZE);
+            const std::shared_ptr<const Tile>* tile_row = &grid[(ty - ty0) * tiles_x];
+            int offset = static_cast<int>(gy[row] - ty * TILE_SIZE) * TILE_SIZE;
+
+            cv::Vec3b* pixels = image.ptr<cv::Vec3b>(row);
+            for (int col = 0; col < width; ++col) {
+                int iter = tile_row[tile_col[col]]->iters[offset + pixel_col[col]];
+                pixels[col] = colors[(iter == INTERIOR) ? max_iter : std::min(iter, max_iter)];
+            }
+        }
+        return image;
+    }
+
+    const Stats& lastStats() const { return stats; }
+    size_t cachedBytes() const { return used; }
+    size_t cachedTiles() const { return tiles.size(); }
+
+private:
+    struct Entry {
+        std::shared_ptr<const Tile> tile;
+        std::list<TileKey>::iterator position;
+    };
+
+    // Плитка с тем же местом и max_iter не меньше нужного подходит как есть,
+    // с меньшим - служит началом счёта и заменяется новой
+    std::shared_ptr<const Tile> acquire(const TileKey& key) {
+        auto it = tiles.lower_bound(key);
+        if (it != tiles.end() && it->first.samePlace(key)) {
+            lru.splice(lru.begin(), lru, it->second.position);
+            stats.reused++;
+            return it->second.tile;
+        }
+
+        std::shared_ptr<const Tile> previous;
+        if (it != tiles.begin() && std::prev(it)->first.samePlace(key)) {
+            auto prev = std::prev(it);
+            previous = prev->second.tile;
+            remove(prev);
+        }
+
+        std::shared_ptr<const Tile> tile = computeTile(key, previous.get());
+        if (previous) stats.resumed++;
+        else stats.computed++;
+
+        lru.push_front(key);
+        tiles[key] = { tile, lru.begin() };
+        used += tile->bytes();
+
+        // Вытеснение самых давно использованных плиток; плитки текущего кадра
+        // остаются живы через shared_ptr до конца отрисовки
+        while (used > budget && lru.size() > 1) {
+            remove(tiles.find(lru.back()));
+            stats.evicted++;
+        }
+        return tile;
+    }
+
+    void remove(std::map<TileKey, Entry>::iterator it) {
+        used -= it->second.tile->bytes();
+        lru.erase(it->second.position);
+        tiles.erase(it);
+    }
+
+    std::map<TileKey, Entry> tiles;
+    std::list<TileKey> lru;   // в начале - последние использованные
+    size_t budget;
+    size_t used = 0;
+    Stats stats;
+};
+
+// Сценарий исследования: сдвиги, увеличение и рост max_iter с отчётом о повторном
+// использовании плиток; последний кадр сверяется с расчётом без кэша
+void exploreDemo(size_t budget_bytes) {
+    struct Step {
+        std::string name;
+        Viewport view;
+        int max_iter;
+    };
+
+    // Начальный вид выбран так, чтобы пиксель экрана совпадал с пикселем плитки
+    const double scale = WIDTH / 2.0 * tileSpacing(4);
+    const double shift = scale / 2.0;
+    std::vector<Step> steps = {
+        { "initial view", { -0.5, 0.0, scale }, MAX_ITER },
+        { "pan right", { -0.5 + shift, 0.0, scale }, MAX_ITER },
+        { "pan down", { -0.5 + shift, shift, scale }, MAX_ITER },
+        { "zoom in x2", { -0.5 + shift, shift, scale / 2 }, MAX_ITER },
+        { "zoom in x2", { -0.5 + shift, shift, scale / 4 }, MAX_ITER },
+        { "zoom out x2", { -0.5 + shift, shift, scale / 2 }, MAX_ITER },
+        { "max_iter x2", { -0.5 + shift, shift, scale / 2 }, 2 * MAX_ITER },
+        { "max_iter x4", { -0.5 + shift, shift, scale / 2 }, 4 * MAX_ITER },
+        { "pan back", { -0.5, 0.0, scale / 2 }, 4 * MAX_ITER },
+    };
+
+    TileRenderer renderer(budget_bytes);
+    cv::Mat image;
+    std::cout << "Tile cache explorer, " << TILE_SIZE << "x" << TILE_SIZE << " tiles, budget "
+        << budget_bytes / (1024 * 1024) << " MB\n";
+    for (const Step& step : steps) {
+        double start = MPI_Wtime();
+        image = renderer.render(step.view, WIDTH, HEIGHT, step.max_iter);
+        double elapsed = MPI_Wtime() - start;
+
+        const TileRenderer::Stats& stats = renderer.lastStats();
+        std::cout << "  " << std::left << std::setw(13) << step.name << std::right
+            << " max_iter " << std::setw(4) << step.max_iter
+            << ": " << std::setw(3) << stats.tiles << " tiles, reused " << std::setw(3) << stats.reused
+            << ", resumed " << std::setw(3) << stats.resumed << ", computed " << std::setw(3) << stats.computed
+            << ", evicted " << std::setw(3) << stats.evicted
+            << ", " << std::fixed << std::setprecision(4) << elapsed << " s, cache "
+            << std::setprecision(1) << renderer.cachedBytes() / (1024.0 * 1024.0) << " MB\n";
+    }
+
+    // Проверка корректности: тот же кадр без кэша
+    const Step& last = steps.back();
+    TileRenderer fresh(budget_bytes);
+    double start = MPI_Wtime();
+    cv::Mat reference = fresh.render(last.view, WIDTH, HEIGHT, last.max_iter);
+    double elapsed = MPI_Wtime() - start;
+
+    long long mismatches = 0;
+    for (int row = 0; row < HEIGHT; ++row) {
+        const cv::Vec3b* a = image.ptr<cv::Vec3b>(row);
+        const cv::Vec3b* b = reference.ptr<cv::Vec3b>(row);
+        for (int col = 0; col < WIDTH; ++col) {
+            if (a[col] != b[col]) mismatches++;
+        }
+    }
+    std::cout << "Last view without cache: " << std::setprecision(4) << elapsed << " s, mismatched pixels: "
+        << mismatches << "\n";
+    cv::imwrite("mandelbrot_explore.png", image);
+}
+
+int main(int argc, char** argv) {
+    MPI_Init(&argc, &argv);
+
+    int rank, size;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+    perfRegionsLabel("rank " + std::to_string(rank));
+
+    // Аргументы:
+    //   --static          статическое разбиение на полосы (для сравнения)
+    //   --tile-rows <n>   высота полосы в динамической очереди
+    //   --kernel-bench    сравнить быстрое ядро с исходным на одном ядре и выйти
+    //   --roofline        положение ядра на модели roofline (--roofline-csv <f> - точки в CSV)
+    //   --deep <re> <im> <scale>  глубокое увеличение в точку (re, im) до полуширины scale
+    //   --deep-iter <n>   максимум итераций глубокого увеличения
+    //   --frames <n>      число кадров серии увеличения
+    //   --antialias <n>   сглаживание n x n подвыборками только граничных пикселей
+    //   --aa-threshold <t> порог разницы цвета соседей для границы
+    //   --aa-check        сравнить с полным сглаживанием всех пикселей
+    //   --explore         сценарий просмотра с кэшем плиток на процессе 0
+    //   --cache-mb <n>    объём кэша плиток в мегабайтах
+    bool use_static = false;
+    int tile_rows = 8;
+    std::string deep_re, deep_im;
+    double deep_scale = 0.0;
+    int deep_iter = 10000;
+    int frames = 1;
+    int antialias = 0;
+    int aa_threshold = 0;
+    bool aa_check = false;
+    bool explore = false;
+    size_t cache_mb = 256;
+    RooflineOptions roofline;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--static") {
+            use_static = true;
+        }
+        else if (arg == "--tile-rows" && i + 1 < argc) {
+            tile_rows = std::max(1, std::stoi(argv[++i]));
+        }
+        else if (arg == "--deep" && i + 3 < argc) {
+            deep_re = argv[++i];
+            deep_im = argv[++i];
+            deep_scale = std::stod(argv[++i]);
+        }
+        else if (arg == "--deep-iter" && i + 1 < argc) {
+            deep_iter = std::max(1, std::stoi(argv[++i]));
+        }
+        else if (arg == "--frames" && i + 1 < argc) {
+            frames = std::max(1, std::stoi(argv[++i]));
+        }
+        else if (arg == "--antialias" && i + 1 < argc) {
+            antialias = std::max(1, std::stoi(argv[++i]));
+        }
+        else if (arg == "--aa-threshold" && i + 1 < argc) {
+            aa_threshold = std::max(0, std::stoi(argv[++i]));
+        }
+        else if (arg == "--aa-check") {
+            aa_check = true;
+        }
+        else if (arg == "--explore") {
+            explore = true;
+        }
+        else if (arg == "--cache-mb" && i + 1 < argc) {
+            cache_mb = std::max(1, std::stoi(argv[++i]));
+        }
+        else if (arg == "--kernel-bench") {
+            if (rank == 0) {
+                kernelBenchmark();
+            }
+            MPI_Finalize();
+            return 0;
+        }
+        else {
+            roofline.parse(i, argc, argv);
         }
     }
 
+    if (roofline.enabled) {
+        if (rank == 0) {
+            rooflineReport(roofline);
+        }
+        MPI_Finalize();
+        return 0;
+    }
+
+    if (explore) {
+        if (rank == 0) {
+            exploreDemo(cache_mb * 1024 * 1024);
+        }
+        MPI_Finalize();
+        return 0;
+    }
+
     cv::Mat final_image;
     if (rank == 0) {
         final_image.create(HEIGHT, WIDTH, CV_8UC3);
     }
 
-    MPI_Gather(local_image.data, local_image.total() * local_image.elemSize(),
-        MPI_UNSIGNED_CHAR, rank == 0 ? final_image.data : nullptr,
-        local_image.total() * local_image.elemSize(), MPI_UNSIGNED_CHAR,
-        0, MPI_COMM_WORLD);
+    if (!deep_re.empty()) {
+        renderDeepZoom(deep_re, deep_im, deep_scale, deep_iter, frames, use_static, tile_rows, final_image, rank, size);
+        MPI_Finalize();
+        return 0;
+    }
+
+    if (antialias > 0) {
+        renderAntialiased(antialias, aa_threshold, aa_check, final_image, rank, size);
+        MPI_Finalize();
+        return 0;
+    }
+
+    renderFrame(renderRows, use_static, tile_rows, final_image, rank, size);
 
     if (rank == 0) {
         cv::imshow("Mandelbrot Set — Colorful", final_image);
@@ -3,73 +3,1595 @@
 #include <vector>
 #include <thread>
 #include <mutex>
+#include <condition_variable>
+#include <future>
+#include <deque>
+#include <string>
+#include <stdexcept>
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <memory>
+#include <cctype>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <filesystem>
+#include <functional>
+#include <exception>
+#include "../common/lock_stats.h"
+#include "../common/bench.h"
+#include "../common/text.h"
 #include <chrono>
 #include <iomanip>
 
-// ==================== Глобальные переменные ====================
-std::mutex frame_mutex;
+// ==================== Результат обработки лица ====================
+// Найденные глаза и улыбки хранятся в координатах области лица
+struct FaceResult {
+    cv::Rect face;
+    std::vector<cv::Rect> eyes;
+    std::vector<cv::Rect> smiles;
+};
 
 // ==================== Функция обработки лица ====================
-void process_face(const cv::Mat& gray, cv::Mat& frame, const cv::Rect& face,
+// Только детекция: кадр не изменяется, поэтому блокировка не нужна
+FaceResult process_face(const cv::Mat& gray, const cv::Rect& face,
     cv::CascadeClassifier& eyes_cascade, cv::CascadeClassifier& smile_cascade) {
-    try {
-        // Проверка границ лица
-        if (face.x >= 0 && face.y >= 0 &&
-            face.x + face.width <= gray.cols &&
-            face.y + face.height <= gray.rows) {
-
-            // Выделение области лица
-            cv::Mat faceROI_gray = gray(face).clone();
-            cv::Mat faceROI_color = frame(face).clone();
-
-            // Детекция глаз
-            std::vector<cv::Rect> eyes;
-            eyes_cascade.detectMultiScale(faceROI_gray, eyes, 1.1, 10, 0, cv::Size(50, 50));
-
-            // Детекция улыбок
-            std::vector<cv::Rect> smiles;
-            smile_cascade.detectMultiScale(faceROI_gray, smiles, 1.24, 15, 0, cv::Size(40, 40));
-
-            // Блокировка доступа к кадру
-            std::lock_guard<std::mutex> lock(frame_mutex);
-
-            // Отрисовка прямоугольников
-            if (face.x >= 0 && face.y >= 0 &&
-                face.x + face.width <= frame.cols &&
-                face.y + face.height <= frame.rows) {
-
-                // Прямоугольник вокруг лица (синий)
-                cv::rectangle(frame, face, cv::Scalar(255, 0, 0), 2);
-
-                // Прямоугольники вокруг глаз (зеленые)
-                for (const auto& eye : eyes) {
-                    if (eye.x >= 0 && eye.y >= 0 &&
-                        eye.x + eye.width <= faceROI_color.cols &&
-                        eye.y + eye.height <= faceROI_color.rows) {
-                        cv::rectangle(faceROI_color, eye, cv::Scalar(0, 255, 0), 2);
-                    }
+    FaceResult result;
+    result.face = face;
+
+    // Проверка границ лица
+    if (face.x >= 0 && face.y >= 0 &&
+        face.x + face.width <= gray.cols &&
+        face.y + face.height <= gray.rows) {
+
+        // Область лица - вид на серый кадр без копирования
+        cv::Mat faceROI_gray = gray(face);
+
+        // Детекция глаз
+        eyes_cascade.detectMultiScale(faceROI_gray, result.eyes, 1.1, 10, 0, cv::Size(50, 50));
+
+        // Детекция улыбок
+        smile_cascade.detectMultiScale(faceROI_gray, result.smiles, 1.24, 15, 0, cv::Size(40, 40));
+    }
+    return result;
+}
+
+// ==================== Отрисовка результата ====================
+void draw_face(cv::Mat& frame, const FaceResult& result) {
+    const cv::Rect& face = result.face;
+    if (face.x < 0 || face.y < 0 ||
+        face.x + face.width > frame.cols ||
+        face.y + face.height > frame.rows) {
+        return;
+    }
+
+    // Прямоугольник вокруг лица (синий)
+    cv::rectangle(frame, face, cv::Scalar(255, 0, 0), 2);
+
+    // Прямоугольники вокруг глаз (зеленые) и улыбок (красные) - рисуются прямо
+    // в области лица кадра, а не в её копии
+    cv::Mat faceROI_color = frame(face);
+    for (const auto& eye : result.eyes) {
+        if (eye.x >= 0 && eye.y >= 0 &&
+            eye.x + eye.width <= faceROI_color.cols &&
+            eye.y + eye.height <= faceROI_color.rows) {
+            cv::rectangle(faceROI_color, eye, cv::Scalar(0, 255, 0), 2);
+        }
+    }
+    for (const auto& smile : result.smiles) {
+        if (smile.x >= 0 && smile.y >= 0 &&
+            smile.x + smile.width <= faceROI_color.cols &&
+            smile.y + smile.height <= faceROI_color.rows) {
+            cv::rectangle(faceROI_color, smile, cv::Scalar(0, 0, 255), 2);
+        }
+    }
+}
+
+// ==================== Пул потоков ====================
+// Долгоживущие потоки, у каждого свои каскады глаз и улыбок: CascadeClassifier
+// не гарантирует потокобезопасность detectMultiScale на одном объекте.
+// Лица отправляются задачами, результат возвращается через future
+class FaceWorkerPool {
+public:
+    FaceWorkerPool(int threads, const std::string& eyes_path, const std::string& smile_path) {
+        // Каждый поток загружает свою копию каскадов до начала работы
+        std::vector<std::promise<bool>> loaded(threads);
+        for (int i = 0; i < threads; ++i) {
+            std::future<bool> ready = loaded[i].get_future();
+            workers.emplace_back(&FaceWorkerPool::worker_loop, this, eyes_path, smile_path, std::move(loaded[i]));
+            if (!ready.get()) {
+                shutdown();
+                throw std::runtime_error("Ошибка загрузки каскадов Хаара в потоке пула");
+            }
+        }
+    }
+
+    ~FaceWorkerPool() {
+        shutdown();
+    }
+
+    int size() const {
+        return static_cast<int>(workers.size());
+    }
+
+    // gray должен оставаться живым, пока не получен результат
+    std::future<FaceResult> submit(const cv::Mat& gray, const cv::Rect& face) {
+        std::packaged_task<FaceResult(cv::CascadeClassifier&, cv::CascadeClassifier&)> task(
+            [&gray, face](cv::CascadeClassifier& eyes, cv::CascadeClassifier& smile) {
+                return process_face(gray, face, eyes, smile);
+            });
+        std::future<FaceResult> result = task.get_future();
+        {
+            InstrumentedLock lock(queue_mutex);
+            tasks.push_back(std::move(task));
+        }
+        queue_ready.notify_one();
+        return result;
+    }
+
+private:
+    using Task = std::packaged_task<FaceResult(cv::CascadeClassifier&, cv::CascadeClassifier&)>;
+
+    void worker_loop(std::string eyes_path, std::string smile_path, std::promise<bool> loaded) {
+        cv::CascadeClassifier eyes_cascade, smile_cascade;
+        bool ok = eyes_cascade.load(eyes_path) && smile_cascade.load(smile_path);
+        loaded.set_value(ok);
+        if (!ok) return;
+
+        while (true) {
+            Task task;
+            {
+                // Захват в этой строке, чтобы статистика отнесла его сюда, а не в unique_lock;
+                // повторные захваты после пробуждения учитываются в месте внутри condition_variable_any
+                queue_mutex.lock();
+                std::unique_lock<InstrumentedMutex> lock(queue_mutex, std::adopt_lock);
+                queue_ready.wait(lock, [this] { return stopping || !tasks.empty(); });
+                if (tasks.empty()) return;
+                task = std::move(tasks.front());
+                tasks.pop_front();
+            }
+            // Исключение внутри задачи попадает в future
+            task(eyes_cascade, smile_cascade);
+        }
+    }
+
+    void shutdown() {
+        {
+            InstrumentedLock lock(queue_mutex);
+            stopping = true;
+        }
+        queue_ready.notify_all();
+        for (auto& t : workers) {
+            if (t.joinable()) {
+                t.join();
+            }
+        }
+        workers.clear();
+    }
+
+    std::vector<std::thread> workers;
+    std::deque<Task> tasks;
+    InstrumentedMutex queue_mutex{ "face pool queue" };
+    std::condition_variable_any queue_ready;
+    bool stopping = false;
+};
+
+// ==================== Общие шаги обработки кадра ====================
+// Предварительная обработка изображения
+void preprocess_frame(const cv::Mat& frame, cv::Mat& gray) {
+    cv::cvtColor(frame, gray, cv::COLOR_BGR2GRAY);
+    cv::equalizeHist(gray, gray);
+    cv::GaussianBlur(gray, gray, cv::Size(5, 5), 0);
+}
+
+// Детекция лиц
+void detect_faces(cv::CascadeClassifier& face_cascade, const cv::Mat& gray, std::vector<cv::Rect>& faces) {
+    face_cascade.detectMultiScale(gray, faces, 1.1, 5, 0, cv::Size(150, 150));
+}
+
+// ==================== Сопровождение лиц ====================
+// Лицо с постоянным номером между кадрами
+struct TrackedFace {
+    int id = 0;
+    cv::Rect rect;
+    int misses = 0;   // кадров подряд без подтверждения в окне поиска
+};
+
+// Доля пересечения прямоугольников (intersection over union)
+double overlap(const cv::Rect& a, const cv::Rect& b) {
+    double inter = (a & b).area();
+    double uni = a.area() + b.area() - inter;
+    return uni > 0 ? inter / uni : 0.0;
+}
+
+// Полная детекция раз в interval кадров и при смене сцены; между ними
+// detectMultiScale запускается только в расширенных окнах вокруг известных лиц
+// и только на масштабах, близких к размеру лица
+class FaceTracker {
+public:
+    struct Stats {
+        long long frames = 0;
+        long long full_scans = 0;
+        long long window_scans = 0;
+        double detect_time = 0.0;
+    };
+
+    explicit FaceTracker(int interval) : interval(std::max(1, interval)) {}
+
+    const std::vector<TrackedFace>& update(cv::CascadeClassifier& face_cascade, const cv::Mat& gray) {
+        auto start = std::chrono::high_resolution_clock::now();
+
+        bool changed = scene_changed(gray);
+        bool full = changed || tracks.empty() || force_full || stats.frames % interval == 0;
+        force_full = false;
+        if (full) {
+            std::vector<cv::Rect> faces;
+            detect_faces(face_cascade, gray, faces);
+            assign(faces);
+            stats.full_scans++;
+        }
+        else {
+            search_windows(face_cascade, gray);
+        }
+
+        auto end = std::chrono::high_resolution_clock::now();
+        stats.detect_time += std::chrono::duration<double>(end - start).count();
+        stats.frames++;
+        return tracks;
+    }
+
+    const Stats& statistics() const { return stats; }
+
+private:
+    // Смена сцены: средняя разница уменьшенных кадров больше порога
+    bool scene_changed(const cv::Mat& gray) {
+        cv::Mat thumb;
+        cv::resize(gray, thumb, cv::Size(64, 36), 0, 0, cv::INTER_AREA);
+        bool changed = false;
+        if (!previous_thumb.empty()) {
+            cv::Mat diff;
+            cv::absdiff(thumb, previous_thumb, diff);
+            changed = cv::mean(diff)[0] > 30.0;
+        }
+        previous_thumb = thumb;
+        return changed;
+    }
+
+    // Сопоставление полной детекции с треками по перекрытию: совпавшие лица
+    // сохраняют номер, остальные получают новый
+    void assign(const std::vector<cv::Rect>& faces) {
+        std::vector<TrackedFace> updated;
+        std::vector<bool> used(tracks.size(), false);
+        for (const auto& face : faces) {
+            int best = -1;
+            double best_overlap = 0.3;
+            for (size_t t = 0; t < tracks.size(); ++t) {
+                double o = overlap(face, tracks[t].rect);
+                if (!used[t] && o > best_overlap) {
+                    best = static_cast<int>(t);
+                    best_overlap = o;
                 }
+            }
+            TrackedFace track;
+            track.id = best >= 0 ? tracks[best].id : next_id++;
+            track.rect = face;
+            if (best >= 0) used[best] = true;
+            updated.push_back(track);
+        }
+        tracks = std::move(updated);
+    }
+
+    // Поиск каждого лица в окне вокруг прежнего положения
+    void search_windows(cv::CascadeClassifier& face_cascade, const cv::Mat& gray) {
+        cv::Rect image(0, 0, gray.cols, gray.rows);
+        std::vector<TrackedFace> kept;
+        for (TrackedFace track : tracks) {
+            const cv::Rect& r = track.rect;
+            int margin_x = r.width / 2, margin_y = r.height / 2;
+            cv::Rect window = cv::Rect(r.x - margin_x, r.y - margin_y, r.width + 2 * margin_x, r.height + 2 * margin_y) & image;
+
+            std::vector<cv::Rect> found;
+            if (!window.empty()) {
+                cv::Size min_size(std::max(150, r.width * 3 / 4), std::max(150, r.height * 3 / 4));
+                cv::Size max_size(r.width * 3 / 2, r.height * 3 / 2);
+                if (min_size.width <= window.width && min_size.height <= window.height) {
+                    face_cascade.detectMultiScale(gray(window), found, 1.1, 5, 0, min_size, max_size);
+                }
+                stats.window_scans++;
+            }
+
+            // Из найденного берётся прямоугольник с наибольшим перекрытием
+            double best_overlap = 0.0;
+            cv::Rect best;
+            for (cv::Rect f : found) {
+                f.x += window.x;
+                f.y += window.y;
+                double o = overlap(f, r);
+                if (o > best_overlap) {
+                    best_overlap = o;
+                    best = f;
+                }
+            }
+
+            if (best_overlap > 0.0) {
+                track.rect = best;
+                track.misses = 0;
+                kept.push_back(track);
+            }
+            else {
+                // Потерянное лицо держится ещё пару кадров, а следующий кадр
+                // сканируется полностью - лицо могло уйти за пределы окна
+                force_full = true;
+                if (++track.misses < 3) kept.push_back(track);
+            }
+        }
+        tracks = std::move(kept);
+    }
+
+    int interval;
+    int next_id = 1;
+    bool force_full = false;
+    std::vector<TrackedFace> tracks;
+    cv::Mat previous_thumb;
+    Stats stats;
+};
+
+// ==================== Ограниченная очередь без блокировок ====================
+// Кольцевой буфер Вьюкова для нескольких производителей и потребителей:
+// у каждой ячейки свой номер последовательности, позиции занимаются через CAS.
+// Блокирующие push/pop сначала недолго крутятся с уступкой процессора, затем
+// засыпают на условной переменной; будят их успешные try_push/try_pop и close()
+template <typename T>
+class BoundedQueue {
+public:
+    explicit BoundedQueue(size_t capacity) {
+        size_t size = 1;
+        while (size < capacity) size *= 2;
+        mask = size - 1;
+        cells.reset(new Cell[size]);
+        for (size_t i = 0; i < size; ++i) {
+            cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    bool try_push(T& value) {
+        if (!enqueue(value)) return false;
+        wake(not_empty, pop_waiters);
+        return true;
+    }
+
+    bool try_pop(T& value) {
+        if (!dequeue(value)) return false;
+        wake(not_full, push_waiters);
+        return true;
+    }
+
+    void push(T value) {
+        // Глубина очереди замеряется перед каждой постановкой
+        size_t current = depth();
+        depth_sum.fetch_add(current, std::memory_order_relaxed);
+        depth_samples.fetch_add(1, std::memory_order_relaxed);
+        size_t seen = depth_max.load(std::memory_order_relaxed);
+        while (current > seen && !depth_max.compare_exchange_weak(seen, current, std::memory_order_relaxed)) {}
+
+        for (int spin = 0; spin < SPIN_LIMIT; ++spin) {
+            if (try_push(value)) return;
+            std::this_thread::yield();
+        }
+        // Очередь долго заполнена: поток спит, пока потребитель не освободит ячейку
+        {
+            std::unique_lock<std::mutex> lock(park_mutex);
+            push_waiters.fetch_add(1);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            not_full.wait(lock, [&] { return enqueue(value); });
+            push_waiters.fetch_sub(1);
+        }
+        wake(not_empty, pop_waiters);
+    }
+
+    // false - очередь закрыта и пуста
+    bool pop(T& value) {
+        for (int spin = 0; spin < SPIN_LIMIT; ++spin) {
+            if (try_pop(value)) return true;
+            if (closed.load(std::memory_order_acquire)) return try_pop(value);
+            std::this_thread::yield();
+        }
+        bool got = false;
+        {
+            std::unique_lock<std::mutex> lock(park_mutex);
+            pop_waiters.fetch_add(1);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            not_empty.wait(lock, [&] {
+                got = dequeue(value);
+                return got || closed.load(std::memory_order_acquire);
+            });
+            pop_waiters.fetch_sub(1);
+        }
+        // После close() в очереди ещё могли остаться элементы
+        if (!got) got = dequeue(value);
+        if (got) wake(not_full, push_waiters);
+        return got;
+    }
+
+    void close() {
+        closed.store(true, std::memory_order_release);
+        std::lock_guard<std::mutex> lock(park_mutex);
+        not_empty.notify_all();
+        not_full.notify_all();
+    }
+
+    size_t depth() const {
+        size_t t = tail.load(std::memory_order_relaxed);
+        size_t h = head.load(std::memory_order_relaxed);
+        return t > h ? t - h : 0;
+    }
+
+    size_t capacity() const { return mask + 1; }
+    double average_depth() const {
+        size_t samples = depth_samples.load();
+        return samples ? static_cast<double>(depth_sum.load()) / samples : 0.0;
+    }
+    size_t max_depth() const { return depth_max.load(); }
+
+private:
+    // Сколько раз пытаться без сна, прежде чем уснуть
+    static const int SPIN_LIMIT = 64;
+
+    struct Cell {
+        std::atomic<size_t> sequence;
+        T value;
+    };
+
+    bool enqueue(T& value) {
+        Cell* cell;
+        size_t pos = tail.load(std::memory_order_relaxed);
+        while (true) {
+            cell = &cells[pos & mask];
+            size_t seq = cell->sequence.load(std::memory_order_acquire);
+            long long diff = static_cast<long long>(seq) - static_cast<long long>(pos);
+            if (diff == 0) {
+                if (tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+            }
+            else if (diff < 0) {
+                return false;  // очередь заполнена
+            }
+            else {
+                pos = tail.load(std::memory_order_relaxed);
+            }
+        }
+        cell->value = std::move(value);
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool dequeue(T& value) {
+        Cell* cell;
+        size_t pos = head.load(std::memory_order_relaxed);
+        while (true) {
+            cell = &cells[pos & mask];
+            size_t seq = cell->sequence.load(std::memory_order_acquire);
+            long long diff = static_cast<long long>(seq) - static_cast<long long>(pos + 1);
+            if (diff == 0) {
+                if (head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+            }
+            else if (diff < 0) {
+                return false;  // очередь пуста
+            }
+            else {
+                pos = head.load(std::memory_order_relaxed);
+            }
+        }
+        value = std::move(cell->value);
+        cell->sequence.store(pos + mask + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Барьер упорядочивает изменение ячейки и чтение счётчика спящих: спящий
+    // увеличивает счётчик до проверки очереди, поэтому пробуждение не теряется
+    void wake(std::condition_variable& cv, std::atomic<int>& waiters) {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (waiters.load(std::memory_order_relaxed) > 0) {
+            std::lock_guard<std::mutex> lock(park_mutex);
+            cv.notify_one();
+        }
+    }
+
+    std::unique_ptr<Cell[]> cells;
+    size_t mask = 0;
+    alignas(64) std::atomic<size_t> tail{ 0 };
+    alignas(64) std::atomic<size_t> head{ 0 };
+    alignas(64) std::atomic<bool> closed{ false };
+    std::atomic<int> push_waiters{ 0 }, pop_waiters{ 0 };
+    std::mutex park_mutex;
+    std::condition_variable not_empty, not_full;
+    std::atomic<size_t> depth_sum{ 0 }, depth_samples{ 0 }, depth_max{ 0 };
+};
+
+// ==================== Конвейер ====================
+using Clock = std::chrono::steady_clock;
+
+// Кадр, проходящий по стадиям конвейера
+struct FrameItem {
+    int index = 0;
+    cv::Mat frame;
+    cv::Mat gray;
+    std::vector<cv::Rect> faces;
+    std::vector<FaceResult> results;
+    Clock::time_point decoded;   // момент чтения кадра
+    Clock::time_point queued;    // момент постановки в очередь текущей стадии
+};
+
+using FrameQueue = BoundedQueue<std::unique_ptr<FrameItem>>;
+
+// Статистика стадии: время обработки и время ожидания кадра во входной очереди
+struct StageStats {
+    std::string name;
+    int workers = 0;
+    long long items = 0;
+    double service = 0.0;
+    double wait = 0.0;
+    std::mutex mutex;
+
+    void add(long long n, double service_time, double wait_time) {
+        std::lock_guard<std::mutex> lock(mutex);
+        items += n;
+        service += service_time;
+        wait += wait_time;
+    }
+};
+
+double seconds_between(Clock::time_point from, Clock::time_point to) {
+    return std::chrono::duration<double>(to - from).count();
+}
+
+// Запуск стадии из states.size() потоков: каждый поток берёт кадры из in, обрабатывает
+// work(state, item) и передаёт в out; последний завершившийся поток закрывает out
+template <typename State, typename Work>
+void start_stage(std::vector<std::thread>& threads, StageStats& stats, std::vector<State>& states,
+    FrameQueue& in, FrameQueue& out, Work work) {
+    stats.workers = static_cast<int>(states.size());
+    auto alive = std::make_shared<std::atomic<int>>(stats.workers);
+    for (auto& state : states) {
+        threads.emplace_back([&stats, &state, &in, &out, work, alive] {
+            long long items = 0;
+            double service = 0.0, wait = 0.0;
+            std::unique_ptr<FrameItem> item;
+            while (in.pop(item)) {
+                Clock::time_point start = Clock::now();
+                wait += seconds_between(item->queued, start);
+                work(state, *item);
+                item->queued = Clock::now();
+                service += seconds_between(start, item->queued);
+                items++;
+                out.push(std::move(item));
+            }
+            stats.add(items, service, wait);
+            if (alive->fetch_sub(1) == 1) {
+                out.close();
+            }
+        });
+    }
+}
+
+// Конвейерная обработка видео: чтение -> предобработка -> лица -> глаза и улыбки ->
+// отрисовка и запись. Между стадиями ограниченные очереди, одновременно в работе
+// несколько кадров; последняя стадия восстанавливает порядок кадров по номеру
+int run_pipeline(const std::string& video_path, int queue_capacity, int workers, bool show) {
+    cv::VideoCapture cap(video_path);
+    if (!cap.isOpened()) {
+        std::cerr << "Ошибка открытия видео!" << std::endl;
+        return -1;
+    }
+
+    // По умолчанию ядра делятся поровну между детекцией лиц и глаз
+    if (workers <= 0) {
+        workers = std::max(1, static_cast<int>(std::thread::hardware_concurrency()) / 2);
+    }
+    int detect_workers = workers;
+    int feature_workers = workers;
+
+    // Каскады загружаются заранее, у каждого потока свои
+    std::vector<cv::CascadeClassifier> face_cascades(detect_workers);
+    for (auto& c : face_cascades) {
+        if (!c.load("haarcascade_frontalface_default.xml")) {
+            std::cerr << "Ошибка загрузки каскадов Хаара!" << std::endl;
+            return -1;
+        }
+    }
+    struct FeatureCascades {
+        cv::CascadeClassifier eyes, smile;
+    };
+    std::vector<FeatureCascades> feature_cascades(feature_workers);
+    for (auto& c : feature_cascades) {
+        if (!c.eyes.load("haarcascade_eye.xml") || !c.smile.load("haarcascade_smile.xml")) {
+            std::cerr << "Ошибка загрузки каскадов Хаара!" << std::endl;
+            return -1;
+        }
+    }
+    std::vector<int> preprocess_state(1);
+
+    FrameQueue decoded(queue_capacity), gray_ready(queue_capacity),
+        faces_ready(queue_capacity), features_ready(queue_capacity);
+    StageStats decode_stats, preprocess_stats, detect_stats, feature_stats, annotate_stats;
+    decode_stats.name = "чтение";
+    preprocess_stats.name = "предобработка";
+    detect_stats.name = "лица";
+    feature_stats.name = "глаза, улыбки";
+    annotate_stats.name = "отрисовка";
+
+    Clock::time_point start_time = Clock::now();
+    std::vector<std::thread> threads;
+
+    // Чтение кадров - строго последовательно; cancel останавливает чтение при выходе из окна
+    std::atomic<bool> cancel{ false };
+    decode_stats.workers = 1;
+    threads.emplace_back([&] {
+        long long items = 0;
+        double service = 0.0;
+        while (!cancel.load(std::memory_order_relaxed)) {
+            Clock::time_point start = Clock::now();
+            auto item = std::make_unique<FrameItem>();
+            if (!cap.read(item->frame) || item->frame.empty()) break;
+            item->index = static_cast<int>(items++);
+            item->decoded = start;
+            item->queued = Clock::now();
+            service += seconds_between(start, item->queued);
+            decoded.push(std::move(item));
+        }
+        decode_stats.add(items, service, 0.0);
+        decoded.close();
+    });
+
+    start_stage(threads, preprocess_stats, preprocess_state, decoded, gray_ready,
+        [](int&, FrameItem& item) { preprocess_frame(item.frame, item.gray); });
+    start_stage(threads, detect_stats, face_cascades, gray_ready, faces_ready,
+        [](cv::CascadeClassifier& cascade, FrameItem& item) { detect_faces(cascade, item.gray, item.faces); });
+    start_stage(threads, feature_stats, feature_cascades, faces_ready, features_ready,
+        [](FeatureCascades& c, FrameItem& item) {
+            for (const auto& face : item.faces) {
+                item.results.push_back(process_face(item.gray, face, c.eyes, c.smile));
+            }
+        });
+
+    // Отрисовка и запись в главном потоке (imshow работает только из него);
+    // кадры, пришедшие раньше своей очереди, ждут в reorder
+    std::map<int, std::unique_ptr<FrameItem>> reorder;
+    int next_index = 0;
+    long long annotated = 0;
+    double annotate_service = 0.0, annotate_wait = 0.0;
+    double latency_sum = 0.0, latency_max = 0.0;
+    size_t reorder_max = 0;
+    std::unique_ptr<FrameItem> item;
+    bool stopped = false;
+    while (!stopped && features_ready.pop(item)) {
+        annotate_wait += seconds_between(item->queued, Clock::now());
+        int index = item->index;
+        reorder[index] = std::move(item);
+        reorder_max = std::max(reorder_max, reorder.size());
+
+        while (!reorder.empty() && reorder.begin()->first == next_index) {
+            Clock::time_point start = Clock::now();
+            std::unique_ptr<FrameItem> ready = std::move(reorder.begin()->second);
+            reorder.erase(reorder.begin());
+            for (const auto& result : ready->results) {
+                draw_face(ready->frame, result);
+            }
+            if (show) {
+                cv::imshow("Детекция лиц", ready->frame);
+                if (cv::waitKey(1) >= 0) stopped = true;
+            }
+            Clock::time_point end = Clock::now();
+            annotate_service += seconds_between(start, end);
+            double latency = seconds_between(ready->decoded, end);
+            latency_sum += latency;
+            latency_max = std::max(latency_max, latency);
+            annotated++;
+            next_index++;
+        }
+    }
+
+    // При досрочной остановке стадии дорабатывают уже прочитанные кадры
+    cancel.store(true, std::memory_order_relaxed);
+    while (features_ready.pop(item)) {}
+    for (auto& t : threads) {
+        t.join();
+    }
+    annotate_stats.workers = 1;
+    annotate_stats.add(annotated, annotate_service, annotate_wait);
+    double total_time = seconds_between(start_time, Clock::now());
+
+    // Отчёт: стадия с наибольшим временем обработки на поток - узкое место
+    std::cout << "\n=== КОНВЕЙЕР ===" << std::endl;
+    std::cout << "Кадров: " << annotated << ", время: " << std::fixed << std::setprecision(2) << total_time
+        << " сек, " << annotated / std::max(total_time, 1e-9) << " кадр/с" << std::endl;
+    std::cout << "Задержка кадра: средняя " << std::setprecision(1) << 1000.0 * latency_sum / std::max(1LL, annotated)
+        << " мс, максимальная " << 1000.0 * latency_max << " мс" << std::endl;
+    std::cout << padRight("Стадия", 16) << padRight("Потоков", 9) << padRight("Обработка, мс", 15)
+        << padRight("Ожидание, мс", 15) << "Загрузка, %" << std::endl;
+    for (StageStats* s : { &decode_stats, &preprocess_stats, &detect_stats, &feature_stats, &annotate_stats }) {
+        double per_item = s->items ? 1000.0 * s->service / s->items : 0.0;
+        double per_wait = s->items ? 1000.0 * s->wait / s->items : 0.0;
+        double load = 100.0 * s->service / (s->workers * std::max(total_time, 1e-9));
+        std::cout << padRight(s->name, 16) << std::left << std::setw(9) << s->workers
+            << std::setw(15) << per_item << std::setw(15) << per_wait << load << std::right << std::endl;
+    }
+    std::cout << "Глубина очередей (средняя / максимальная из " << decoded.capacity() << "):" << std::endl;
+    const std::pair<const char*, const FrameQueue*> queues[] = {
+        { "чтение -> предобработка", &decoded }, { "предобработка -> лица", &gray_ready },
+        { "лица -> глаза", &faces_ready }, { "глаза -> отрисовка", &features_ready } };
+    for (const auto& q : queues) {
+        std::cout << "  " << padRight(q.first, 24) << std::setprecision(2)
+            << q.second->average_depth() << " / " << q.second->max_depth() << std::endl;
+    }
+    std::cout << "Кадров в буфере переупорядочивания (макс.): " << reorder_max << std::endl;
+    std::cout << "=========================" << std::endl;
+
+    cap.release();
+    cv::destroyAllWindows();
+    return 0;
+}
+
+// ==================== Пакетная обработка ====================
+// Настройки пакетного режима без окна
+struct BatchOptions {
+    std::vector<std::string> inputs;
+    std::string output = "detections.jsonl";
+    bool binary = false;          // компактный двоичный формат вместо JSON Lines
+    std::string annotate_dir;     // каталог для видео с разметкой (пусто - не писать)
+    int jobs = 0;                 // файлов одновременно (0 - по числу ядер)
+    int track_interval = 0;       // сопровождение лиц, как в покадровом режиме
+};
+
+// Итог пакетной обработки
+struct BatchSummary {
+    long long frames = 0;
+    int files_ok = 0;
+    int files_failed = 0;
+    double seconds = 0.0;
+};
+
+// Запись результатов нескольких потоков в один файл: кадр записывается целиком
+// под мьютексом, строки разных файлов перемежаются, но каждая самодостаточна.
+// Двоичный формат: "FDB1", число файлов, имена (u16 длина + байты), затем записи кадров:
+// u32 номер файла, u32 номер кадра, u16 лиц, на лицо i32 id, i16 x y w h,
+// u8 глаз, u8 улыбок и их прямоугольники i16 x y w h (относительно лица)
+class DetectionWriter {
+public:
+    DetectionWriter(const std::string& path, bool binary, const std::vector<std::string>& inputs)
+        : out(path, binary ? std::ios::binary : std::ios::out), binary(binary) {
+        if (binary && out) {
+            out.write("FDB1", 4);
+            put<uint32_t>(static_cast<uint32_t>(inputs.size()));
+            for (const auto& name : inputs) {
+                put<uint16_t>(static_cast<uint16_t>(name.size()));
+                out.write(name.data(), name.size());
+            }
+        }
+    }
+
+    bool ok() const {
+        return static_cast<bool>(out);
+    }
+
+    void write(int file_id, const std::string& file, int frame, const std::vector<FaceResult>& results,
+        const std::vector<int>& ids) {
+        std::string record = binary ? binary_record(file_id, frame, results, ids) : json_record(file, frame, results, ids);
+        InstrumentedLock lock(mutex);
+        out.write(record.data(), record.size());
+    }
+
+private:
+    template <typename T>
+    void put(T value) {
+        out.write(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+
+    template <typename T>
+    static void append(std::string& record, T value) {
+        record.append(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+
+    static void append_rect(std::string& record, const cv::Rect& r) {
+        for (int v : { r.x, r.y, r.width, r.height }) {
+            append<int16_t>(record, static_cast<int16_t>(v));
+        }
+    }
+
+    static std::string binary_record(int file_id, int frame, const std::vector<FaceResult>& results,
+        const std::vector<int>& ids) {
+        std::string record;
+        append<uint32_t>(record, static_cast<uint32_t>(file_id));
+        append<uint32_t>(record, static_cast<uint32_t>(frame));
+        append<uint16_t>(record, static_cast<uint16_t>(results.size()));
+        for (size_t f = 0; f < results.size(); ++f) {
+            append<int32_t>(record, f < ids.size() ? ids[f] : -1);
+            append_rect(record, results[f].face);
+            append<uint8_t>(record, static_cast<uint8_t>(std::min<size_t>(results[f].eyes.size(), 255)));
+            append<uint8_t>(record, static_cast<uint8_t>(std::min<size_t>(results[f].smiles.size(), 255)));
+            for (size_t e = 0; e < results[f].eyes.size() && e < 255; ++e) append_rect(record, results[f].eyes[e]);
+            for (size_t s = 0; s < results[f].smiles.size() && s < 255; ++s) append_rect(record, results[f].smiles[s]);
+        }
+        return record;
+    }
+
+    static std::string json_rect(const cv::Rect& r) {
+        return "[" + std::to_string(r.x) + "," + std::to_string(r.y) + ","
+            + std::to_string(r.width) + "," + std::to_string(r.height) + "]";
+    }
+
+    static std::string json_rects(const std::vector<cv::Rect>& rects) {
+        std::string text = "[";
+        for (size_t i = 0; i < rects.size(); ++i) {
+            text += (i ? "," : "") + json_rect(rects[i]);
+        }
+        return text + "]";
+    }
+
+    static std::string json_record(const std::string& file, int frame, const std::vector<FaceResult>& results,
+        const std::vector<int>& ids) {
+        // Управляющие символы в JSON-строке допустимы только как \u00XX
+        static const char hex[] = "0123456789abcdef";
+        std::string escaped;
+        for (char c : file) {
+            unsigned char code = static_cast<unsigned char>(c);
+            if (code < 0x20) {
+                escaped += "\\u00";
+                escaped += hex[code >> 4];
+                escaped += hex[code & 0xF];
+                continue;
+            }
+            if (c == '"' || c == '\\') escaped += '\\';
+            escaped += c;
+        }
+        std::string record = "{\"file\":\"" + escaped + "\",\"frame\":" + std::to_string(frame) + ",\"faces\":[";
+        for (size_t f = 0; f < results.size(); ++f) {
+            if (f) record += ",";
+            record += "{";
+            if (f < ids.size()) record += "\"id\":" + std::to_string(ids[f]) + ",";
+            record += "\"rect\":" + json_rect(results[f].face);
+            record += ",\"eyes\":" + json_rects(results[f].eyes) + ",\"smiles\":" + json_rects(results[f].smiles) + "}";
+        }
+        return record + "]}\n";
+    }
+
+    std::ofstream out;
+    bool binary;
+    InstrumentedMutex mutex{ "detection writer" };
+};
+
+// Обработка одного файла целиком в текущем потоке; возвращает число кадров или -1
+long long process_file(int file_id, const std::string& path, cv::CascadeClassifier& face_cascade,
+    cv::CascadeClassifier& eyes_cascade, cv::CascadeClassifier& smile_cascade,
+    DetectionWriter& writer, const BatchOptions& options) {
+    cv::VideoCapture cap(path);
+    if (!cap.isOpened()) {
+        return -1;
+    }
+
+    cv::VideoWriter annotated;
+    if (!options.annotate_dir.empty()) {
+        double fps = cap.get(cv::CAP_PROP_FPS);
+        std::filesystem::path out_path = std::filesystem::path(options.annotate_dir)
+            / (std::filesystem::path(path).stem().string() + "_" + std::to_string(file_id) + ".avi");
+        annotated.open(out_path.string(), cv::VideoWriter::fourcc('M', 'J', 'P', 'G'), fps > 0 ? fps : 25.0,
+            cv::Size(static_cast<int>(cap.get(cv::CAP_PROP_FRAME_WIDTH)), static_cast<int>(cap.get(cv::CAP_PROP_FRAME_HEIGHT))));
+    }
 
-                // Прямоугольники вокруг улыбок (красные)
-                for (const auto& smile : smiles) {
-                    if (smile.x >= 0 && smile.y >= 0 &&
-                        smile.x + smile.width <= faceROI_color.cols &&
-                        smile.y + smile.height <= faceROI_color.rows) {
-                        cv::rectangle(faceROI_color, smile, cv::Scalar(0, 0, 255), 2);
+    FaceTracker tracker(options.track_interval);
+    cv::Mat frame, gray;
+    long long frames = 0;
+    while (cap.read(frame) && !frame.empty()) {
+        preprocess_frame(frame, gray);
+
+        std::vector<cv::Rect> faces;
+        std::vector<int> ids;
+        if (options.track_interval > 0) {
+            for (const auto& track : tracker.update(face_cascade, gray)) {
+                faces.push_back(track.rect);
+                ids.push_back(track.id);
+            }
+        }
+        else {
+            detect_faces(face_cascade, gray, faces);
+        }
+
+        std::vector<FaceResult> results;
+        for (const auto& face : faces) {
+            results.push_back(process_face(gray, face, eyes_cascade, smile_cascade));
+        }
+        writer.write(file_id, path, static_cast<int>(frames), results, ids);
+
+        if (annotated.isOpened()) {
+            for (const auto& result : results) {
+                draw_face(frame, result);
+            }
+            annotated.write(frame);
+        }
+        frames++;
+    }
+    return frames;
+}
+
+// Пакетная обработка: options.jobs потоков берут файлы из общего списка,
+// у каждого потока свои каскады
+BatchSummary run_batch(const BatchOptions& options) {
+    BatchSummary summary;
+    DetectionWriter writer(options.output, options.binary, options.inputs);
+    if (!writer.ok()) {
+        std::cerr << "Ошибка открытия файла результатов: " << options.output << std::endl;
+        summary.files_failed = static_cast<int>(options.inputs.size());
+        return summary;
+    }
+    if (!options.annotate_dir.empty()) {
+        std::filesystem::create_directories(options.annotate_dir);
+    }
+
+    int jobs = options.jobs > 0 ? options.jobs : std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+    jobs = std::min(jobs, std::max(1, static_cast<int>(options.inputs.size())));
+
+    std::atomic<int> next_file{ 0 };
+    std::mutex report_mutex;
+    auto start = std::chrono::high_resolution_clock::now();
+    std::vector<std::thread> threads;
+    for (int j = 0; j < jobs; ++j) {
+        threads.emplace_back([&] {
+            cv::CascadeClassifier face_cascade, eyes_cascade, smile_cascade;
+            bool loaded = face_cascade.load("haarcascade_frontalface_default.xml") &&
+                eyes_cascade.load("haarcascade_eye.xml") && smile_cascade.load("haarcascade_smile.xml");
+
+            int file_id;
+            while ((file_id = next_file.fetch_add(1)) < static_cast<int>(options.inputs.size())) {
+                const std::string& path = options.inputs[file_id];
+                auto file_start = std::chrono::high_resolution_clock::now();
+                long long frames = -1;
+                try {
+                    if (loaded) {
+                        frames = process_file(file_id, path, face_cascade, eyes_cascade, smile_cascade, writer, options);
                     }
                 }
+                catch (const std::exception& e) {
+                    std::lock_guard<std::mutex> lock(report_mutex);
+                    std::cerr << "Ошибка обработки " << path << ": " << e.what() << std::endl;
+                }
+                double seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - file_start).count();
+
+                std::lock_guard<std::mutex> lock(report_mutex);
+                if (frames < 0) {
+                    summary.files_failed++;
+                    std::cerr << "Не удалось обработать: " << path << std::endl;
+                    continue;
+                }
+                summary.files_ok++;
+                summary.frames += frames;
+                std::cout << path << ": " << frames << " кадров, " << std::fixed << std::setprecision(1)
+                    << frames / std::max(seconds, 1e-9) << " кадр/с" << std::endl;
+            }
+        });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+    summary.seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+
+    std::cout << "\n=== ПАКЕТНАЯ ОБРАБОТКА ===" << std::endl;
+    std::cout << "Файлов: " << summary.files_ok << " обработано, " << summary.files_failed << " с ошибкой, потоков: "
+        << jobs << std::endl;
+    std::cout << "Кадров: " << summary.frames << " за " << std::setprecision(2) << summary.seconds << " сек, "
+        << std::setprecision(1) << summary.frames / std::max(summary.seconds, 1e-9) << " кадр/с" << std::endl;
+    std::cout << "Результаты: " << options.output << (options.binary ? " (двоичный формат)" : " (JSON Lines)") << std::endl;
+    std::cout << "=========================" << std::endl;
+    return summary;
+}
+
+// Синтетический ролик: движущийся фон и нарисованное лицо (или лицо из face_image),
+// перемещающееся по кадру
+bool make_synthetic_clip(const std::string& path, int frames, const std::string& face_image) {
+    const cv::Size size(640, 480);
+    cv::VideoWriter writer(path, cv::VideoWriter::fourcc('M', 'J', 'P', 'G'), 25.0, size);
+    if (!writer.isOpened()) {
+        return false;
+    }
+
+    cv::Mat face;
+    if (!face_image.empty()) {
+        cv::Mat loaded = cv::imread(face_image, cv::IMREAD_COLOR);
+        if (!loaded.empty()) cv::resize(loaded, face, cv::Size(200, 200));
+    }
+
+    cv::Mat frame(size, CV_8UC3);
+    for (int i = 0; i < frames; ++i) {
+        for (int row = 0; row < size.height; ++row) {
+            cv::Vec3b* pixels = frame.ptr<cv::Vec3b>(row);
+            for (int col = 0; col < size.width; ++col) {
+                unsigned char v = static_cast<unsigned char>((row + col + 3 * i) & 0x7F);
+                pixels[col] = cv::Vec3b(v, static_cast<unsigned char>(v / 2 + 40), static_cast<unsigned char>(v / 3 + 60));
             }
         }
+
+        // Лицо ходит по эллипсу, не выходя за край кадра
+        double t = 2.0 * 3.14159265358979 * i / frames;
+        cv::Point center(320 + static_cast<int>(180 * std::cos(t)), 240 + static_cast<int>(100 * std::sin(t)));
+        if (!face.empty()) {
+            face.copyTo(frame(cv::Rect(center.x - 100, center.y - 100, 200, 200)));
+        }
+        else {
+            cv::ellipse(frame, center, cv::Size(80, 100), 0, 0, 360, cv::Scalar(150, 180, 230), cv::FILLED);
+            cv::circle(frame, center + cv::Point(-30, -25), 12, cv::Scalar(40, 40, 40), cv::FILLED);
+            cv::circle(frame, center + cv::Point(30, -25), 12, cv::Scalar(40, 40, 40), cv::FILLED);
+            cv::ellipse(frame, center + cv::Point(0, 35), cv::Size(35, 15), 0, 0, 180, cv::Scalar(40, 40, 160), 4);
+        }
+        writer.write(frame);
     }
-    catch (const std::exception& e) {
-        std::lock_guard<std::mutex> lock(frame_mutex);
-        std::cerr << "Ошибка в потоке: " << e.what() << std::endl;
+    writer.release();
+    return true;
+}
+
+// Самопроверка пакетного режима на синтетическом ролике: два экземпляра
+// в двух потоках, в результатах должна быть ровно одна строка на кадр
+int run_self_test() {
+    const int frames = 90;
+    std::filesystem::path dir = std::filesystem::temp_directory_path();
+    std::string clip = (dir / "face_batch_selftest.avi").string();
+    if (!make_synthetic_clip(clip, frames, "")) {
+        std::cerr << "Не удалось записать синтетический ролик" << std::endl;
+        return 1;
     }
+
+    BatchOptions options;
+    options.inputs = { clip, clip };
+    options.output = (dir / "face_batch_selftest.jsonl").string();
+    options.jobs = 2;
+    BatchSummary summary = run_batch(options);
+
+    std::ifstream in(options.output);
+    std::string line;
+    long long lines = 0, well_formed = 0;
+    while (std::getline(in, line)) {
+        lines++;
+        if (line.rfind("{\"file\":", 0) == 0 && line.back() == '}') well_formed++;
+    }
+
+    bool passed = summary.files_ok == 2 && summary.frames == 2LL * frames && lines == summary.frames && well_formed == lines;
+    std::cout << "Самопроверка: кадров " << summary.frames << " из " << 2 * frames << ", строк " << lines
+        << ", корректных " << well_formed << " - " << (passed ? "пройдена" : "НЕ ПРОЙДЕНА") << std::endl;
+    return passed ? 0 : 1;
+}
+
+// ==================== Общая пирамида изображений ====================
+// Уровень k - серый кадр, уменьшенный в 1.1^k раз. Строится один раз на кадр
+// и используется всеми тремя каскадами: детекция на уровне k окном исходного
+// размера каскада эквивалентна поиску объектов размером окно * 1.1^k
+struct ImagePyramid {
+    static constexpr double factor = 1.1;
+    std::vector<double> scales;
+    std::vector<cv::Mat> levels;
+};
+
+// Каскады одного потока
+struct DetectorSet {
+    cv::CascadeClassifier face, eyes, smile;
+};
+
+// Параметры поиска одного каскада, как в detectMultiScale
+struct SearchParams {
+    double scale_factor;
+    int min_neighbors;
+    int min_size;
+};
+
+const SearchParams FACE_SEARCH = { 1.1, 5, 150 };
+const SearchParams EYES_SEARCH = { 1.1, 10, 50 };
+const SearchParams SMILE_SEARCH = { 1.24, 15, 40 };
+
+// Уровни пирамиды для каскада с окном window: масштабы scale_factor^j, начиная
+// с минимального размера объекта. Для шага 1.24 берутся ближайшие уровни сетки 1.1
+std::vector<int> search_levels(const cv::Size& window, const SearchParams& params, const cv::Size& area, int level_count) {
+    std::vector<int> result;
+    for (double f = 1.0; window.width * f <= area.width && window.height * f <= area.height; f *= params.scale_factor) {
+        if (window.width * f < params.min_size || window.height * f < params.min_size) continue;
+        int level = static_cast<int>(std::lround(std::log(f) / std::log(ImagePyramid::factor)));
+        if (level >= level_count) break;
+        if (result.empty() || result.back() != level) result.push_back(level);
+    }
+    return result;
+}
+
+// Детекция лиц, глаз и улыбок по общей пирамиде: построение уровней, поиск лиц
+// по уровням и поиск черт лица по парам (лицо, уровень) распределяются между
+// потоками; кандидаты всех уровней объединяются через groupRectangles
+class PyramidDetector {
+public:
+    explicit PyramidDetector(int threads) : sets(std::max(1, threads)) {
+        for (auto& set : sets) {
+            if (!set.face.load("haarcascade_frontalface_default.xml") ||
+                !set.eyes.load("haarcascade_eye.xml") ||
+                !set.smile.load("haarcascade_smile.xml")) {
+                throw std::runtime_error("Ошибка загрузки каскадов Хаара!");
+            }
+        }
+        face_window = sets[0].face.getOriginalWindowSize();
+        eyes_window = sets[0].eyes.getOriginalWindowSize();
+        smile_window = sets[0].smile.getOriginalWindowSize();
+        for (auto& set : sets) {
+            workers.emplace_back(&PyramidDetector::worker_loop, this, std::ref(set));
+        }
+    }
+
+    ~PyramidDetector() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        job_ready.notify_all();
+        for (auto& t : workers) {
+            t.join();
+        }
+    }
+
+    int size() const {
+        return static_cast<int>(sets.size());
+    }
+
+    std::vector<FaceResult> detect(const cv::Mat& gray) {
+        // Уровни нужны от самого мелкого масштаба черт лица до уровня,
+        // на котором кадр меньше окна детектора лиц
+        int first_level = static_cast<int>(std::floor(std::log(std::min(
+            EYES_SEARCH.min_size / static_cast<double>(std::max(eyes_window.width, eyes_window.height)),
+            SMILE_SEARCH.min_size / static_cast<double>(std::max(smile_window.width, smile_window.height))))
+            / std::log(ImagePyramid::factor)));
+        first_level = std::max(0, first_level);
+        int level_count = 0;
+        while (gray.cols / std::pow(ImagePyramid::factor, level_count) >= face_window.width &&
+            gray.rows / std::pow(ImagePyramid::factor, level_count) >= face_window.height) {
+            level_count++;
+        }
+
+        pyramid.scales.assign(level_count, 0.0);
+        pyramid.levels.assign(level_count, cv::Mat());
+        parallel_for(level_count - first_level, [&](int i, DetectorSet&) {
+            int k = first_level + i;
+            double f = std::pow(ImagePyramid::factor, k);
+            pyramid.scales[k] = f;
+            cv::resize(gray, pyramid.levels[k], cv::Size(cvRound(gray.cols / f), cvRound(gray.rows / f)), 0, 0, cv::INTER_LINEAR);
+        });
+
+        // Лица: каждый уровень - отдельная задача, самые крупные уровни первыми
+        std::vector<int> face_levels = search_levels(face_window, FACE_SEARCH, gray.size(), level_count);
+        std::vector<std::vector<cv::Rect>> level_faces(face_levels.size());
+        parallel_for(static_cast<int>(face_levels.size()), [&](int i, DetectorSet& set) {
+            level_faces[i] = detect_level(set.face, face_levels[i], cv::Rect(0, 0, gray.cols, gray.rows), face_window);
+        });
+        std::vector<cv::Rect> faces;
+        for (const auto& rects : level_faces) {
+            faces.insert(faces.end(), rects.begin(), rects.end());
+        }
+        cv::groupRectangles(faces, FACE_SEARCH.min_neighbors, 0.2);
+
+        // Глаза и улыбки: задачи по парам (лицо, уровень); область лица на уровне -
+        // вид на общий уровень пирамиды без копирования
+        struct FeatureTask {
+            int face;
+            bool smile;
+            int level;
+        };
+        std::vector<FeatureTask> tasks;
+        for (size_t f = 0; f < faces.size(); ++f) {
+            for (int level : search_levels(eyes_window, EYES_SEARCH, faces[f].size(), level_count)) {
+                tasks.push_back({ static_cast<int>(f), false, level });
+            }
+            for (int level : search_levels(smile_window, SMILE_SEARCH, faces[f].size(), level_count)) {
+                tasks.push_back({ static_cast<int>(f), true, level });
+            }
+        }
+        std::vector<std::vector<cv::Rect>> task_rects(tasks.size());
+        parallel_for(static_cast<int>(tasks.size()), [&](int i, DetectorSet& set) {
+            const FeatureTask& task = tasks[i];
+            task_rects[i] = task.smile
+                ? detect_level(set.smile, task.level, faces[task.face], smile_window)
+                : detect_level(set.eyes, task.level, faces[task.face], eyes_window);
+        });
+
+        std::vector<FaceResult> results(faces.size());
+        for (size_t f = 0; f < faces.size(); ++f) {
+            results[f].face = faces[f];
+        }
+        for (size_t i = 0; i < tasks.size(); ++i) {
+            FaceResult& result = results[tasks[i].face];
+            for (cv::Rect r : task_rects[i]) {
+                r.x -= result.face.x;
+                r.y -= result.face.y;
+                (tasks[i].smile ? result.smiles : result.eyes).push_back(r);
+            }
+        }
+        for (auto& result : results) {
+            cv::groupRectangles(result.eyes, EYES_SEARCH.min_neighbors, 0.2);
+            cv::groupRectangles(result.smiles, SMILE_SEARCH.min_neighbors, 0.2);
+        }
+        return results;
+    }
+
+private:
+    // Кандидаты одного уровня в области area кадра (без группировки), в координатах кадра
+    std::vector<cv::Rect> detect_level(cv::CascadeClassifier& cascade, int level, const cv::Rect& area,
+        const cv::Size& window) {
+        const cv::Mat& image = pyramid.levels[level];
+        double f = pyramid.scales[level];
+        cv::Rect roi = cv::Rect(cvRound(area.x / f), cvRound(area.y / f), cvRound(area.width / f), cvRound(area.height / f))
+            & cv::Rect(0, 0, image.cols, image.rows);
+
+        std::vector<cv::Rect> found;
+        if (roi.width >= window.width && roi.height >= window.height) {
+            // Один масштаб: минимальный и максимальный размер равны окну, группировки нет
+            cascade.detectMultiScale(image(roi), found, 2.0, 0, 0, window, window);
+        }
+        for (auto& r : found) {
+            r = cv::Rect(cvRound((roi.x + r.x) * f), cvRound((roi.y + r.y) * f), cvRound(r.width * f), cvRound(r.height * f));
+        }
+        return found;
+    }
+
+    // Выполнение fn(0..count-1) потоками пула; вызывающий поток ждёт завершения
+    void parallel_for(int count, const std::function<void(int, DetectorSet&)>& fn) {
+        if (count <= 0) return;
+        std::unique_lock<std::mutex> lock(mutex);
+        job = &fn;
+        job_count = count;
+        next_index.store(0);
+        busy_workers = static_cast<int>(workers.size());
+        generation++;
+        job_ready.notify_all();
+        job_done.wait(lock, [this] { return busy_workers == 0; });
+        job = nullptr;
+        if (error) {
+            std::exception_ptr e = error;
+            error = nullptr;
+            std::rethrow_exception(e);
+        }
+    }
+
+    void worker_loop(DetectorSet& set) {
+        long long seen = 0;
+        while (true) {
+            const std::function<void(int, DetectorSet&)>* fn;
+            int count;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                job_ready.wait(lock, [&] { return stopping || generation != seen; });
+                if (stopping) return;
+                seen = generation;
+                fn = job;
+                count = job_count;
+            }
+
+            int i;
+            while ((i = next_index.fetch_add(1)) < count) {
+                try {
+                    (*fn)(i, set);
+                }
+                catch (...) {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    if (!error) error = std::current_exception();
+                }
+            }
+
+            std::lock_guard<std::mutex> lock(mutex);
+            if (--busy_workers == 0) job_done.notify_one();
+        }
+    }
+
+    std::vector<DetectorSet> sets;
+    std::vector<std::thread> workers;
+    cv::Size face_window, eyes_window, smile_window;
+    ImagePyramid pyramid;
+
+    std::mutex mutex;
+    std::condition_variable job_ready, job_done;
+    const std::function<void(int, DetectorSet&)>* job = nullptr;
+    int job_count = 0;
+    std::atomic<int> next_index{ 0 };
+    int busy_workers = 0;
+    long long generation = 0;
+    bool stopping = false;
+    std::exception_ptr error;
+};
+
+// Сравнение задержки кадра: три каскада со своими пирамидами в одном потоке
+// против общей пирамиды с детекцией по уровням в threads потоках
+int run_pyramid(const std::string& video_path, int threads, bool show) {
+    cv::CascadeClassifier face_cascade, eyes_cascade, smile_cascade;
+    if (!face_cascade.load("haarcascade_frontalface_default.xml") ||
+        !eyes_cascade.load("haarcascade_eye.xml") ||
+        !smile_cascade.load("haarcascade_smile.xml")) {
+        std::cerr << "Ошибка загрузки каскадов Хаара!" << std::endl;
+        return -1;
+    }
+    PyramidDetector detector(threads > 0 ? threads : std::max(1, static_cast<int>(std::thread::hardware_concurrency())));
+    std::cout << "Потоков детекции по пирамиде: " << detector.size() << std::endl;
+
+    cv::VideoCapture cap(video_path);
+    if (!cap.isOpened()) {
+        std::cerr << "Ошибка открытия видео!" << std::endl;
+        return -1;
+    }
+
+    cv::Mat frame, gray;
+    int frame_count = 0;
+    double total_separate = 0, total_shared = 0;
+    long long separate_faces = 0, shared_faces = 0, matched_faces = 0;
+    while (cap.read(frame) && !frame.empty()) {
+        preprocess_frame(frame, gray);
+
+        auto start_separate = std::chrono::high_resolution_clock::now();
+        std::vector<cv::Rect> faces;
+        detect_faces(face_cascade, gray, faces);
+        std::vector<FaceResult> reference;
+        for (const auto& face : faces) {
+            reference.push_back(process_face(gray, face, eyes_cascade, smile_cascade));
+        }
+        auto start_shared = std::chrono::high_resolution_clock::now();
+        std::vector<FaceResult> results = detector.detect(gray);
+        auto end_shared = std::chrono::high_resolution_clock::now();
+        total_separate += std::chrono::duration<double>(start_shared - start_separate).count();
+        total_shared += std::chrono::duration<double>(end_shared - start_shared).count();
+
+        // Согласие с обычной детекцией по лицам
+        separate_faces += reference.size();
+        shared_faces += results.size();
+        for (const auto& r : reference) {
+            for (const auto& s : results) {
+                if (overlap(r.face, s.face) > 0.5) {
+                    matched_faces++;
+                    break;
+                }
+            }
+        }
+
+        for (const auto& result : results) {
+            draw_face(frame, result);
+        }
+        frame_count++;
+        if (show) {
+            cv::imshow("Детекция лиц", frame);
+            if (cv::waitKey(30) >= 0) break;
+        }
+    }
+
+    if (frame_count > 0) {
+        std::cout << "\n=== ОБЩАЯ ПИРАМИДА ===" << std::endl;
+        std::cout << "Всего обработано кадров: " << frame_count << std::endl;
+        std::cout << "Задержка кадра (отдельные пирамиды, 1 поток): " << std::fixed << std::setprecision(1)
+            << 1000.0 * total_separate / frame_count << " мс" << std::endl;
+        std::cout << "Задержка кадра (общая пирамида, потоков: " << detector.size() << "): "
+            << 1000.0 * total_shared / frame_count << " мс" << std::endl;
+        std::cout << "Ускорение: " << std::setprecision(2) << total_separate / (total_shared + 1e-10) << "x" << std::endl;
+        std::cout << "Лиц: " << separate_faces << " обычной детекцией, " << shared_faces << " по пирамиде, совпало "
+            << matched_faces << std::endl;
+        std::cout << "=========================" << std::endl;
+    }
+
+    cap.release();
+    cv::destroyAllWindows();
+    return 0;
+}
+
+// ==================== Замеры ядер ====================
+// Ядра детектора на первых кадрах ролика, кадры загружаются в память заранее
+int run_benchmarks(const std::string& video_path, int workers, const BenchOptions& options) {
+    const int bench_frames = 16;
+    cv::VideoCapture cap(video_path);
+    if (!cap.isOpened()) {
+        std::cerr << "Ошибка открытия видео!" << std::endl;
+        return -1;
+    }
+    std::vector<cv::Mat> frames, grays;
+    cv::Mat frame;
+    while (static_cast<int>(frames.size()) < bench_frames && cap.read(frame) && !frame.empty()) {
+        frames.push_back(frame.clone());
+        grays.emplace_back();
+        preprocess_frame(frames.back(), grays.back());
+    }
+    if (frames.empty()) {
+        std::cerr << "В видео нет кадров" << std::endl;
+        return -1;
+    }
+
+    cv::CascadeClassifier face_cascade, eyes_cascade, smile_cascade;
+    if (!face_cascade.load("haarcascade_frontalface_default.xml") ||
+        !eyes_cascade.load("haarcascade_eye.xml") ||
+        !smile_cascade.load("haarcascade_smile.xml")) {
+        std::cerr << "Ошибка загрузки каскадов Хаара!" << std::endl;
+        return -1;
+    }
+    int threads = workers > 0 ? workers : std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+    FaceWorkerPool pool(threads, "haarcascade_eye.xml", "haarcascade_smile.xml");
+    PyramidDetector detector(threads);
+
+    // Лица всех кадров находятся один раз, чтобы ядра обработки лиц получали одинаковый вход
+    std::vector<std::vector<cv::Rect>> faces(frames.size());
+    for (size_t f = 0; f < frames.size(); ++f) {
+        detect_faces(face_cascade, grays[f], faces[f]);
+    }
+
+    const double count = static_cast<double>(frames.size());
+    std::unique_ptr<FaceTracker> tracker;
+    BenchSuite suite("11");
+    suite.add("frame/preprocess", [&] {
+        cv::Mat gray;
+        for (const auto& f : frames) {
+            preprocess_frame(f, gray);
+        }
+        DoNotOptimize(gray);
+    }).items(count, "frame");
+    suite.add("faces/detect", [&] {
+        std::vector<cv::Rect> found;
+        for (const auto& gray : grays) {
+            detect_faces(face_cascade, gray, found);
+        }
+        DoNotOptimize(found);
+    }).items(count, "frame");
+    suite.add("faces/track10", [&] {
+        for (const auto& gray : grays) {
+            DoNotOptimize(tracker->update(face_cascade, gray));
+        }
+    }).setup([&] { tracker.reset(new FaceTracker(10)); }).items(count, "frame");
+    suite.add("features/single_thread", [&] {
+        for (size_t f = 0; f < grays.size(); ++f) {
+            for (const auto& face : faces[f]) {
+                FaceResult result = process_face(grays[f], face, eyes_cascade, smile_cascade);
+                DoNotOptimize(result);
+            }
+        }
+    }).items(count, "frame");
+    suite.add("features/worker_pool", [&] {
+        for (size_t f = 0; f < grays.size(); ++f) {
+            std::vector<std::future<FaceResult>> pending;
+            for (const auto& face : faces[f]) {
+                pending.push_back(pool.submit(grays[f], face));
+            }
+            for (auto& p : pending) {
+                FaceResult result = p.get();
+                DoNotOptimize(result);
+            }
+        }
+    }).items(count, "frame");
+    suite.add("pyramid/detect_all", [&] {
+        for (const auto& gray : grays) {
+            std::vector<FaceResult> results = detector.detect(gray);
+            DoNotOptimize(results);
+        }
+    }).items(count, "frame");
+
+    suite.report(suite.run(options), options);
+    return 0;
 }
 
 // ==================== Главная функция ====================
-int main() {
+int main(int argc, char** argv) {
+    // Аргументы:
+    //   --pipeline      конвейерная обработка вместо покадровой
+    //   --queue <n>     ёмкость очередей между стадиями конвейера
+    //   --workers <n>   потоков на стадиях детекции лиц и глаз (и в режиме --pyramid)
+    //   --pyramid       общая пирамида изображений для всех каскадов
+    //   --track [n]     сопровождение лиц, полная детекция раз в n кадров
+    //   --track-verify  проверять сопровождение полной детекцией каждого кадра
+    //   --no-display    не показывать кадры в окне
+    //   <файл>...       видеофайлы (по умолчанию ZUA.mp4; в покадровом режиме - первый)
+    // Пакетный режим без окна:
+    //   --batch               обработать все файлы, по несколько одновременно
+    //   --list <файл>         добавить пути из файла (по одному в строке)
+    //   --jobs <n>            файлов одновременно
+    //   --output <файл>       результаты (по умолчанию detections.jsonl)
+    //   --format <jsonl|binary>  формат результатов
+    //   --annotate <каталог>  записать видео с разметкой
+    //   --make-synthetic <файл> [изображение лица]  записать синтетический ролик
+    //   --self-test           проверить пакетный режим на синтетическом ролике
+    // Замеры ядер на первых кадрах ролика:
+    //   --bench ...           флаги стенда замеров (см. common/bench.h)
+    bool use_pipeline = false;
+    bool use_pyramid = false;
+    bool show = true;
+    int queue_capacity = 8;
+    int workers = 0;
+    int track_interval = 0;
+    bool track_verify = false;
+    bool use_batch = false;
+    BatchOptions batch;
+    BenchOptions bench;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--pipeline") {
+            use_pipeline = true;
+        }
+        else if (arg == "--pyramid") {
+            use_pyramid = true;
+        }
+        else if (arg == "--queue" && i + 1 < argc) {
+            queue_capacity = std::max(2, std::stoi(argv[++i]));
+        }
+        else if (arg == "--workers" && i + 1 < argc) {
+            workers = std::max(1, std::stoi(argv[++i]));
+        }
+        else if (arg == "--track") {
+            track_interval = 10;
+            if (i + 1 < argc && std::isdigit(static_cast<unsigned char>(argv[i + 1][0]))) {
+                track_interval = std::max(1, std::stoi(argv[++i]));
+            }
+        }
+        else if (arg == "--track-verify") {
+            track_verify = true;
+        }
+        else if (arg == "--no-display") {
+            show = false;
+        }
+        else if (arg == "--batch") {
+            use_batch = true;
+        }
+        else if (arg == "--list" && i + 1 < argc) {
+            std::ifstream list(argv[++i]);
+            std::string line;
+            while (std::getline(list, line)) {
+                if (!line.empty() && line.back() == '\r') line.pop_back();
+                if (!line.empty()) batch.inputs.push_back(line);
+            }
+        }
+        else if (arg == "--jobs" && i + 1 < argc) {
+            batch.jobs = std::max(1, std::stoi(argv[++i]));
+        }
+        else if (arg == "--output" && i + 1 < argc) {
+            batch.output = argv[++i];
+        }
+        else if (arg == "--format" && i + 1 < argc) {
+            std::string format = argv[++i];
+            if (format != "jsonl" && format != "binary") {
+                std::cerr << "Неизвестный формат результатов: " << format << " (jsonl или binary)" << std::endl;
+                return -1;
+            }
+            batch.binary = format == "binary";
+        }
+        else if (arg == "--annotate" && i + 1 < argc) {
+            batch.annotate_dir = argv[++i];
+        }
+        else if (arg == "--make-synthetic" && i + 1 < argc) {
+            std::string path = argv[++i];
+            std::string face_image = (i + 1 < argc && argv[i + 1][0] != '-') ? argv[++i] : "";
+            bool ok = make_synthetic_clip(path, 250, face_image);
+            std::cout << (ok ? "Синтетический ролик записан: " : "Ошибка записи ролика: ") << path << std::endl;
+            return ok ? 0 : -1;
+        }
+        else if (arg == "--self-test") {
+            return run_self_test();
+        }
+        else if (bench.parse(i, argc, argv)) {
+            continue;
+        }
+        else {
+            batch.inputs.push_back(arg);
+        }
+    }
+    std::string video_path = batch.inputs.empty() ? "ZUA.mp4" : batch.inputs.front();
+
     try {
+        if (use_batch) {
+            if (batch.inputs.empty()) {
+                std::cerr << "Не заданы входные файлы" << std::endl;
+                return -1;
+            }
+            batch.track_interval = track_interval;
+            BatchSummary summary = run_batch(batch);
+            return summary.files_failed == 0 ? 0 : 1;
+        }
+
+        if (bench.report) {
+            return run_benchmarks(video_path, workers, bench);
+        }
+        if (use_pyramid) {
+            return run_pyramid(video_path, workers, show);
+        }
+        if (use_pipeline) {
+            return run_pipeline(video_path, queue_capacity, workers, show);
+        }
+
         // Загрузка каскадов Хаара
         cv::CascadeClassifier face_cascade, eyes_cascade, smile_cascade;
         if (!face_cascade.load("haarcascade_frontalface_default.xml") ||
@@ -79,8 +1601,13 @@ int main() {
             return -1;
         }
 
+        // Пул потоков для обработки лиц
+        int thread_count = std::max(1u, std::thread::hardware_concurrency());
+        FaceWorkerPool pool(thread_count, "haarcascade_eye.xml", "haarcascade_smile.xml");
+        std::cout << "Потоков в пуле: " << pool.size() << std::endl;
+
         // Открытие видеофайла
-        cv::VideoCapture cap("ZUA.mp4");
+        cv::VideoCapture cap(video_path);
         if (!cap.isOpened()) {
             std::cerr << "Ошибка открытия видео!" << std::endl;
             return -1;
@@ -88,6 +1615,9 @@ int main() {
 
         cv::Mat frame;
         int frame_count = 0;
+        FaceTracker tracker(track_interval);
+        long long verify_faces = 0, verify_missed = 0;
+        double verify_time = 0;
         double total_single_thread = 0;
         double total_multi_thread = 0;
 
@@ -97,43 +1627,70 @@ int main() {
 
             // Предварительная обработка изображения
             cv::Mat gray;
-            cv::cvtColor(frame, gray, cv::COLOR_BGR2GRAY);
-            cv::equalizeHist(gray, gray);
-            cv::GaussianBlur(gray, gray, cv::Size(5, 5), 0);
+            preprocess_frame(frame, gray);
 
-            // Детекция лиц
+            // Детекция лиц: на каждом кадре или через сопровождение
             std::vector<cv::Rect> faces;
-            face_cascade.detectMultiScale(gray, faces, 1.1, 5, 0, cv::Size(150, 150));
+            std::vector<int> face_ids;
+            if (track_interval > 0) {
+                for (const auto& track : tracker.update(face_cascade, gray)) {
+                    faces.push_back(track.rect);
+                    face_ids.push_back(track.id);
+                }
+
+                // Проверка полноты: лица полной детекции без подходящего трека считаются пропущенными
+                if (track_verify) {
+                    auto start_verify = std::chrono::high_resolution_clock::now();
+                    std::vector<cv::Rect> reference;
+                    detect_faces(face_cascade, gray, reference);
+                    verify_time += std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start_verify).count();
+                    for (const auto& r : reference) {
+                        bool matched = false;
+                        for (const auto& f : faces) {
+                            if (overlap(r, f) > 0.3) matched = true;
+                        }
+                        verify_faces++;
+                        if (!matched) verify_missed++;
+                    }
+                }
+            }
+            else {
+                detect_faces(face_cascade, gray, faces);
+            }
 
             // Обработка в одном потоке (для сравнения)
             auto start_single = std::chrono::high_resolution_clock::now();
+            std::vector<FaceResult> results;
             for (const auto& face : faces) {
-                process_face(gray, frame, face, eyes_cascade, smile_cascade);
+                results.push_back(process_face(gray, face, eyes_cascade, smile_cascade));
             }
             auto end_single = std::chrono::high_resolution_clock::now();
             std::chrono::duration<double> elapsed_single = end_single - start_single;
             total_single_thread += elapsed_single.count();
 
-            // Обработка в нескольких потоках
+            // Обработка в пуле потоков
             auto start_multi = std::chrono::high_resolution_clock::now();
-            std::vector<std::thread> threads;
+            std::vector<std::future<FaceResult>> pending;
             for (const auto& face : faces) {
-                threads.emplace_back(process_face,
-                    std::cref(gray),
-                    std::ref(frame),
-                    std::cref(face),
-                    std::ref(eyes_cascade),
-                    std::ref(smile_cascade));
-            }
-            for (auto& t : threads) {
-                if (t.joinable()) {
-                    t.join();
-                }
+                pending.push_back(pool.submit(gray, face));
+            }
+            results.clear();
+            for (auto& f : pending) {
+                results.push_back(f.get());
             }
             auto end_multi = std::chrono::high_resolution_clock::now();
             std::chrono::duration<double> elapsed_multi = end_multi - start_multi;
             total_multi_thread += elapsed_multi.count();
 
+            // Отрисовка в главном потоке
+            for (size_t f = 0; f < results.size(); ++f) {
+                draw_face(frame, results[f]);
+                if (f < face_ids.size()) {
+                    cv::putText(frame, "id " + std::to_string(face_ids[f]), results[f].face.tl() + cv::Point(0, -8),
+                        cv::FONT_HERSHEY_SIMPLEX, 0.8, cv::Scalar(255, 0, 0), 2);
+                }
+            }
+
             frame_count++;
 
             // Вывод статистики каждые 10 кадров
@@ -146,8 +1703,10 @@ int main() {
             }
 
             // Отображение результата
-            cv::imshow("Детекция лиц", frame);
-            if (cv::waitKey(30) >= 0) break;
+            if (show) {
+                cv::imshow("Детекция лиц", frame);
+                if (cv::waitKey(30) >= 0) break;
+            }
         }
 
         // Итоговый отчет
@@ -158,6 +1717,20 @@ int main() {
             std::cout << "Среднее ускорение:      " << std::fixed << std::setprecision(2) << avg_speedup << "x" << std::endl;
             std::cout << "Общее время (1 поток):  " << total_single_thread << " сек" << std::endl;
             std::cout << "Общее время (N потоков):" << total_multi_thread << " сек" << std::endl;
+            if (track_interval > 0) {
+                const FaceTracker::Stats& ts = tracker.statistics();
+                std::cout << "Сопровождение: полных детекций " << ts.full_scans << ", поисков в окнах "
+                    << ts.window_scans << std::endl;
+                std::cout << "Время детекции лиц:     " << ts.detect_time << " сек ("
+                    << std::setprecision(1) << 1000.0 * ts.detect_time / frame_count << " мс на кадр)" << std::endl;
+                if (track_verify) {
+                    std::cout << "Полная детекция:        " << std::setprecision(2) << verify_time << " сек, ускорение "
+                        << verify_time / (ts.detect_time + 1e-10) << "x" << std::endl;
+                    std::cout << "Полнота сопровождения:  " << std::setprecision(1)
+                        << 100.0 * (verify_faces - verify_missed) / std::max(1LL, verify_faces) << "% ("
+                        << verify_missed << " из " << verify_faces << " лиц пропущено)" << std::endl;
+                }
+            }
             std::cout << "=========================" << std::endl;
         }
 
@@ -4,44 +4,46 @@
 #include <mutex>
 #include <iomanip>
 #include <locale>
+#include "common/lock_stats.h"
+#include "common/matrix.h"
 
 using namespace std;
 
-mutex mtx; //      
+InstrumentedMutex mtx("mtx"); //       (  )
 
 //      
-vector<vector<int>> extractMinor(const vector<vector<int>>& matrix, int excludeRow, int excludeCol) {
-    vector<vector<int>> minorMatrix;
-    int size = matrix.size();
+Matrix<int> extractMinor(const Matrix<int>& matrix, int excludeRow, int excludeCol) {
+    int size = matrix.rows();
+    Matrix<int> minorMatrix(size - 1, size - 1);
 
-    for (int i = 0; i < size; ++i) {
+    for (int i = 0, mi = 0; i < size; ++i) {
         if (i == excludeRow) continue;
-        vector<int> rowElements;
-        for (int j = 0; j < size; ++j) {
+        const int* source = matrix.row(i);
+        int* target = minorMatrix.row(mi++);
+        for (int j = 0, mj = 0; j < size; ++j) {
             if (j == excludeCol) continue;
-            rowElements.push_back(matrix[i][j]);
+            target[mj++] = source[j];
         }
-        minorMatrix.push_back(rowElements);
     }
     return minorMatrix;
 }
 
 //    
-int computeDeterminant(const vector<vector<int>>& matrix) {
-    int size = matrix.size();
-    if (size == 1) return matrix[0][0];
-    if (size == 2) return matrix[0][0] * matrix[1][1] - matrix[0][1] * matrix[1][0];
+int computeDeterminant(const Matrix<int>& matrix) {
+    int size = matrix.rows();
+    if (size == 1) return matrix(0, 0);
+    if (size == 2) return matrix(0, 0) * matrix(1, 1) - matrix(0, 1) * matrix(1, 0);
 
     vector<thread> workers;
     vector<int> partialResults(size, 0);
     int detValue = 0;
 
     auto minorComputation = [&](int col) {
-        vector<vector<int>> minorMatrix = extractMinor(matrix, 0, col);
+        Matrix<int> minorMatrix = extractMinor(matrix, 0, col);
         int coefficient = (col % 2 == 0) ? 1 : -1;
         int subDet = computeDeterminant(minorMatrix);
         mtx.lock();
-        partialResults[col] = coefficient * matrix[0][col] * subDet;
+        partialResults[col] = coefficient * matrix(0, col) * subDet;
         mtx.unlock();
         };
 
@@ -61,10 +63,10 @@ int computeDeterminant(const vector<vector<int>>& matrix) {
 }
 
 //     
-void printMatrix(const vector<vector<int>>& matrix) {
-    for (const auto& row : matrix) {
-        for (int val : row) {
-            cout << setw(5) << val << " ";
+void printMatrix(const Matrix<int>& matrix) {
+    for (int i = 0; i < matrix.rows(); ++i) {
+        for (int j = 0; j < matrix.cols(); ++j) {
+            cout << setw(5) << matrix(i, j) << " ";
         }
         cout << endl;
     }
@@ -77,11 +79,11 @@ int main() {
     cout << "  : ";
     cin >> dimension;
 
-    vector<vector<int>> matrix(dimension, vector<int>(dimension));
+    Matrix<int> matrix(dimension, dimension);
     cout << "  : " << endl;
     for (int i = 0; i < dimension; ++i) {
         for (int j = 0; j < dimension; ++j) {
-            cin >> matrix[i][j];
+            cin >> matrix(i, j);
         }
     }
 
@@ -4,45 +4,241 @@
 #include <vector>
 #include <mutex>
 #include <iomanip>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <algorithm>
+#include <sstream>
+#include <cstdlib>
+#include <cctype>
+#include <functional>
+#include "../common/lock_stats.h"
+#include "../common/text.h"
 
 const int NUM_THREADS = 10;
 const int NUM_ITERATIONS = 100000;
+const int BATCH_SIZE = 64;
+const int CACHE_LINE = 64;
+
+// Способы увеличения общего счётчика
+enum class Strategy {
+    Unsynchronized,   // counter++ без синхронизации (гонка данных)
+    Mutex,            // lock_guard на каждый инкремент
+    MutexInstrumented,// то же на InstrumentedMutex (статистика ожидания, только с --lock-stats)
+    AtomicSeqCst,     // fetch_add с порядком seq_cst
+    AtomicRelaxed,    // fetch_add с порядком relaxed
+    Batched,          // локальная сумма, fetch_add раз в BATCH_SIZE инкрементов
+    Sharded           // свой выровненный по кэш-линии счётчик на поток
+};
+
+const Strategy ALL_STRATEGIES[] = { Strategy::Unsynchronized, Strategy::Mutex, Strategy::AtomicSeqCst,
+    Strategy::AtomicRelaxed, Strategy::Batched, Strategy::Sharded };
+
+std::string strategyName(Strategy strategy) {
+    switch (strategy) {
+    case Strategy::Unsynchronized: return "Без мьютекса";
+    case Strategy::Mutex: return "С мьютексом";
+    case Strategy::MutexInstrumented: return "Мьютекс+статистика";
+    case Strategy::AtomicSeqCst: return "atomic seq_cst";
+    case Strategy::AtomicRelaxed: return "atomic relaxed";
+    case Strategy::Batched: return "Пакетный fetch_add";
+    case Strategy::Sharded: return "Шардированный";
+    }
+    return "";
+}
+
+// Счётчик из отдельных ячеек по одной кэш-линии: каждый поток пишет в свою ячейку,
+// поэтому линии не передаются между ядрами; чтение суммирует все ячейки
+class ShardedCounter {
+    struct alignas(CACHE_LINE) Cell {
+        std::atomic<long long> value{ 0 };
+        std::atomic<bool> owned{ false };
+    };
+
+public:
+    // Ячейка, закреплённая за потоком на время жизни объекта. Пока писатель один,
+    // инкремент - обычные load и store без атомарного RMW; если свободных ячеек
+    // не осталось, поток делит ячейку с другими через fetch_add
+    class Slot {
+    public:
+        Slot(const Slot&) = delete;
+        Slot& operator=(const Slot&) = delete;
+
+        ~Slot() {
+            if (exclusive) {
+                cell->owned.store(false, std::memory_order_release);
+            }
+        }
+
+        void add(long long value) {
+            if (exclusive) {
+                cell->value.store(cell->value.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+            }
+            else {
+                cell->value.fetch_add(value, std::memory_order_relaxed);
+            }
+        }
+
+    private:
+        friend class ShardedCounter;
+        Slot(Cell* cell, bool exclusive) : cell(cell), exclusive(exclusive) {}
+
+        Cell* cell;
+        bool exclusive;
+    };
+
+    explicit ShardedCounter(size_t shards) : cells(shards) {}
+
+    Slot slot() {
+        for (auto& cell : cells) {
+            bool expected = false;
+            if (!cell.owned.load(std::memory_order_relaxed) &&
+                cell.owned.compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+                return Slot(&cell, true);
+            }
+        }
+        size_t hash = std::hash<std::thread::id>()(std::this_thread::get_id());
+        return Slot(&cells[hash % cells.size()], false);
+    }
+
+    // Разовое увеличение без закреплённой ячейки
+    void add(long long value) {
+        size_t hash = std::hash<std::thread::id>()(std::this_thread::get_id());
+        cells[hash % cells.size()].value.fetch_add(value, std::memory_order_relaxed);
+    }
+
+    // Точна, когда все писатели завершили работу; во время записи - оценка снизу
+    // значения на момент завершения чтения
+    long long read() const {
+        long long sum = 0;
+        for (const auto& cell : cells) {
+            sum += cell.value.load(std::memory_order_relaxed);
+        }
+        return sum;
+    }
+
+    void reset() {
+        for (auto& cell : cells) {
+            cell.value.store(0, std::memory_order_relaxed);
+        }
+    }
+
+private:
+    std::vector<Cell> cells;
+};
 
 // Глобальные переменные
 int counter = 0;
 std::mutex counterMutex;
+InstrumentedMutex instrumentedMutex("counterMutex");
+alignas(CACHE_LINE) std::atomic<long long> atomicCounter{ 0 };
+ShardedCounter shardedCounter(256);
 
-// Функция инкрементации
-void increment(bool useMutex) {
-    for (int i = 0; i < NUM_ITERATIONS; ++i) {
-        if (useMutex) {
+// Функция инкрементации выбранным способом
+template <Strategy S>
+void increment(int iterations) {
+    if constexpr (S == Strategy::Sharded) {
+        ShardedCounter::Slot slot = shardedCounter.slot();
+        for (int i = 0; i < iterations; ++i) {
+            slot.add(1);
+        }
+        return;
+    }
+
+    long long pending = 0;
+    for (int i = 0; i < iterations; ++i) {
+        if constexpr (S == Strategy::Unsynchronized) {
+            counter++;
+        }
+        else if constexpr (S == Strategy::Mutex) {
             std::lock_guard<std::mutex> lock(counterMutex);
             counter++;
         }
-        else {
+        else if constexpr (S == Strategy::MutexInstrumented) {
+            InstrumentedLock lock(instrumentedMutex);
             counter++;
         }
+        else if constexpr (S == Strategy::AtomicSeqCst) {
+            atomicCounter.fetch_add(1, std::memory_order_seq_cst);
+        }
+        else if constexpr (S == Strategy::AtomicRelaxed) {
+            atomicCounter.fetch_add(1, std::memory_order_relaxed);
+        }
+        else if constexpr (S == Strategy::Batched) {
+            if (++pending == BATCH_SIZE) {
+                atomicCounter.fetch_add(pending, std::memory_order_relaxed);
+                pending = 0;
+            }
+        }
+    }
+    if (pending > 0) {
+        atomicCounter.fetch_add(pending, std::memory_order_relaxed);
+    }
+}
+
+void (*incrementFunction(Strategy strategy))(int) {
+    switch (strategy) {
+    case Strategy::Unsynchronized: return increment<Strategy::Unsynchronized>;
+    case Strategy::Mutex: return increment<Strategy::Mutex>;
+    case Strategy::MutexInstrumented: return increment<Strategy::MutexInstrumented>;
+    case Strategy::AtomicSeqCst: return increment<Strategy::AtomicSeqCst>;
+    case Strategy::AtomicRelaxed: return increment<Strategy::AtomicRelaxed>;
+    case Strategy::Batched: return increment<Strategy::Batched>;
+    case Strategy::Sharded: return increment<Strategy::Sharded>;
+    }
+    return nullptr;
+}
+
+// Итоговое значение счётчика выбранного способа
+long long counterValue(Strategy strategy) {
+    switch (strategy) {
+    case Strategy::Unsynchronized:
+    case Strategy::Mutex:
+    case Strategy::MutexInstrumented:
+        return counter;
+    case Strategy::Sharded:
+        return shardedCounter.read();
+    default:
+        return atomicCounter.load();
     }
 }
 
-void runTest(bool useMutex, const std::string& testName) {
+// Результат одного прогона
+struct TestResult {
+    long long expected;
+    long long actual;
+    double nsPerIncrement;   // время прогона на один инкремент всех потоков
+};
+
+TestResult runTest(Strategy strategy, int numThreads, int iterations, bool verbose) {
     std::vector<std::thread> threads;
     counter = 0;
+    atomicCounter = 0;
+    shardedCounter.reset();
 
-    for (int i = 0; i < NUM_THREADS; ++i) {
-        threads.emplace_back(increment, useMutex);
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < numThreads; ++i) {
+        threads.emplace_back(incrementFunction(strategy), iterations);
     }
 
     for (auto& t : threads) {
         t.join();
     }
+    double elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+    TestResult result;
+    result.expected = static_cast<long long>(numThreads) * iterations;
+    result.actual = counterValue(strategy);
+    result.nsPerIncrement = elapsed / result.expected;
+    if (!verbose) {
+        return result;
+    }
 
-    int expected = NUM_THREADS * NUM_ITERATIONS;
-    std::cout << "\nТест: " << testName << "\n";
-    std::cout << "Ожидаемое значение: " << expected << "\n";
-    std::cout << "Фактическое значение: " << counter << "\n";
+    std::cout << "\nТест: " << strategyName(strategy) << "\n";
+    std::cout << "Ожидаемое значение: " << result.expected << "\n";
+    std::cout << "Фактическое значение: " << result.actual << "\n";
 
-    if (!useMutex) {
+    if (strategy == Strategy::Unsynchronized) {
         std::cout << "\nБез мьютекса:\n";
         std::cout << " - Потоки одновременно изменяют общее значение без синхронизации.\n";
         std::cout << " - Это приводит к гонке данных, из-за чего некоторые инкременты теряются.\n";
@@ -54,13 +250,86 @@ void runTest(bool useMutex, const std::string& testName) {
         std::cout << " - Каждый поток безопасно увеличивает значение.\n";
         std::cout << " - Итоговое значение совпадает с ожидаемым.\n";
     }
+    return result;
 }
 
-int main() {
+// Перебор числа потоков для всех способов: нс на инкремент и масштабирование
+// пропускной способности относительно одного потока. Мьютекс со статистикой
+// заметно дороже обычного, поэтому его строка добавляется только по lockStats
+void runBenchmark(int iterations, bool lockStats) {
+    int hardware = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<int> threadCounts;
+    for (int t = 1; t <= std::max(2 * hardware, 8); t *= 2) {
+        threadCounts.push_back(t);
+    }
+
+    std::cout << "\n--- Сравнение способов, " << iterations << " инкрементов на поток, ядер: " << hardware << " ---\n";
+    std::cout << "Нс на инкремент (масштабирование относительно 1 потока)\n";
+    std::cout << padRight("Способ", 20);
+    for (int t : threadCounts) {
+        std::cout << padRight(std::to_string(t) + " пот.", 18);
+    }
+    std::cout << "Верно\n";
+
+    std::vector<Strategy> strategies(std::begin(ALL_STRATEGIES), std::end(ALL_STRATEGIES));
+    if (lockStats) {
+        strategies.insert(strategies.begin() + 2, Strategy::MutexInstrumented);
+    }
+
+    for (Strategy strategy : strategies) {
+        std::cout << padRight(strategyName(strategy), 20);
+        double single = 0.0;
+        bool correct = true;
+        for (int t : threadCounts) {
+            // Лучший из трёх прогонов
+            TestResult best = runTest(strategy, t, iterations, false);
+            for (int trial = 1; trial < 3; ++trial) {
+                TestResult r = runTest(strategy, t, iterations, false);
+                if (r.nsPerIncrement < best.nsPerIncrement) best = r;
+                correct = correct && r.actual == r.expected;
+            }
+            correct = correct && best.actual == best.expected;
+            if (t == 1) single = best.nsPerIncrement;
+
+            std::ostringstream cell;
+            cell << std::fixed << std::setprecision(2) << best.nsPerIncrement << " (" << std::setprecision(1)
+                << single / best.nsPerIncrement << "x)";
+            std::cout << padRight(cell.str(), 18);
+        }
+        std::cout << (correct ? "да" : "нет") << "\n";
+    }
+}
+
+int main(int argc, char** argv) {
     SetConsoleOutputCP(65001);
     setlocale(LC_ALL, "Russian");
+
+    // --bench [n]    сравнение всех способов при разном числе потоков (n инкрементов на поток)
+    // --lock-stats   добавить мьютекс со статистикой ожидания (отчёт в stderr при выходе)
+    bool bench = false, lockStats = false;
+    int iterations = 1000000;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--bench") {
+            bench = true;
+            if (i + 1 < argc && std::isdigit(static_cast<unsigned char>(argv[i + 1][0]))) {
+                iterations = std::max(1, std::atoi(argv[++i]));
+            }
+        }
+        else if (arg == "--lock-stats") {
+            lockStats = true;
+        }
+    }
+    if (bench) {
+        runBenchmark(iterations, lockStats);
+        return 0;
+    }
+
     std::cout << "\n--- Тестирование многопоточного инкремента счетчика ---\n";
-    runTest(false, "Без мьютекса");
-    runTest(true, "С мьютексом");
+    runTest(Strategy::Unsynchronized, NUM_THREADS, NUM_ITERATIONS, true);
+    runTest(Strategy::Mutex, NUM_THREADS, NUM_ITERATIONS, true);
+    if (lockStats) {
+        runTest(Strategy::MutexInstrumented, NUM_THREADS, NUM_ITERATIONS, true);
+    }
     return 0;
 }
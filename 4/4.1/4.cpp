@@ -1,104 +1,297 @@
 #include <iostream>
 #include <vector>
-#include <chrono>
 #include <omp.h>
 #include <windows.h>
+#include "../../common/bench.h"
+#include "../../common/perf_counters.h"
+#include "../../common/roofline.h"
+#include "../../common/matrix.h"
+#include "../../common/gemm.h"
 
 using namespace std;
 
 const int matrixSize = 1000;
-using Matrix = vector<vector<int>>;
 
 //    
-void fillMatrix(Matrix& matrix) {
-    for (auto& row : matrix) {
-        for (auto& element : row) {
-            element = rand() % 100;
+void fillMatrix(Matrix<int>& matrix) {
+    for (int i = 0; i < matrixSize; ++i) {
+        for (int j = 0; j < matrixSize; ++j) {
+            matrix(i, j) = rand() % 100;
         }
     }
 }
 
 //   ( )
-void resetMatrix(Matrix& matrix) {
-    for (auto& row : matrix) {
-        fill(row.begin(), row.end(), 0);
-    }
-}
-
-//     
-double measureExecutionTime(void (*func)(const Matrix&, const Matrix&, Matrix&), const Matrix& A, const Matrix& B, Matrix& C) {
-    auto start = chrono::high_resolution_clock::now();
-    func(A, B, C);
-    auto end = chrono::high_resolution_clock::now();
-    return chrono::duration<double>(end - start).count();
+void resetMatrix(Matrix<int>& matrix) {
+    matrix.fill(0);
 }
 
 //    ( )
-void multiplySequential(const Matrix& A, const Matrix& B, Matrix& result) {
+void multiplySequential(const Matrix<int>& A, const Matrix<int>& B, Matrix<int>& result) {
+    PerfRegion region("multiplySequential");
     for (int i = 0; i < matrixSize; ++i) {
+        const int* a = A.row(i);
+        int* c = result.row(i);
         for (int j = 0; j < matrixSize; ++j) {
             for (int k = 0; k < matrixSize; ++k) {
-                result[i][j] += A[i][k] * B[k][j];
+                c[j] += a[k] * B.row(k)[j];
             }
         }
     }
 }
 
 //    OpenMP static
-void multiplyParallelStatic(const Matrix& A, const Matrix& B, Matrix& result) {
-#pragma omp parallel for schedule(static)
-    for (int i = 0; i < matrixSize; ++i) {
-        for (int j = 0; j < matrixSize; ++j) {
-            for (int k = 0; k < matrixSize; ++k) {
-                result[i][j] += A[i][k] * B[k][j];
+void multiplyParallelStatic(const Matrix<int>& A, const Matrix<int>& B, Matrix<int>& result) {
+#pragma omp parallel
+    {
+        //         (nowait),
+        //       .  A  C
+        //    , B - ,     
+        PerfRegion region("multiplyParallelStatic");
+#pragma omp for schedule(static) nowait
+        for (int i = 0; i < matrixSize; ++i) {
+            const int* a = A.row(i);
+            int* c = result.row(i);
+            for (int j = 0; j < matrixSize; ++j) {
+                for (int k = 0; k < matrixSize; ++k) {
+                    c[j] += a[k] * B.row(k)[j];
+                }
             }
         }
     }
 }
 
 //    OpenMP dynamic (  4 )
-void multiplyParallelDynamic(const Matrix& A, const Matrix& B, Matrix& result) {
-#pragma omp parallel for schedule(dynamic, 4)
-    for (int i = 0; i < matrixSize; ++i) {
-        for (int j = 0; j < matrixSize; ++j) {
-            for (int k = 0; k < matrixSize; ++k) {
-                result[i][j] += A[i][k] * B[k][j];
+void multiplyParallelDynamic(const Matrix<int>& A, const Matrix<int>& B, Matrix<int>& result) {
+#pragma omp parallel
+    {
+        PerfRegion region("multiplyParallelDynamic");
+#pragma omp for schedule(dynamic, 4) nowait
+        for (int i = 0; i < matrixSize; ++i) {
+            const int* a = A.row(i);
+            int* c = result.row(i);
+            for (int j = 0; j < matrixSize; ++j) {
+                for (int k = 0; k < matrixSize; ++k) {
+                    c[j] += a[k] * B.row(k)[j];
+                }
             }
         }
     }
 }
 
-int main() {
+//       :
+//        ,     B  
+void multiplyViews(MatrixView<const int> A, MatrixView<const int> B, MatrixView<int> result) {
+    PerfRegion region("multiplyViews");
+    for (int i = 0; i < A.rows(); ++i) {
+        for (int j = 0; j < B.cols(); ++j) {
+            int sum = 0;
+            for (int k = 0; k < A.cols(); ++k) {
+                sum += A(i, k) * B(k, j);
+            }
+            result(i, j) += sum;
+        }
+    }
+}
+
+//        (. common/gemm.h): A  ,
+// B  ,      ,   multiplyParallelStatic
+template <class In, class Acc>
+void multiplyTyped(const Matrix<In>& A, const Matrix<In>& BColumns, Matrix<Acc>& result) {
+#pragma omp parallel for schedule(static)
+    for (int i = 0; i < matrixSize; ++i) {
+        gemmAccumulate<In, Acc>(A.rowRange(i, i + 1), BColumns.view(), result.rowRange(i, i + 1));
+    }
+}
+
+//  A  B      gemm/<>_<>  
+template <class In, class Acc>
+struct TypedMultiply {
+    string name;
+    Matrix<In> A, BColumns;
+    Matrix<Acc> C;
+
+    TypedMultiply(const Matrix<int>& sourceA, const Matrix<int>& sourceB, const NumaOptions& numa)
+        : name(string("gemm/") + gemmTypeName<In>() + "_" + gemmTypeName<Acc>()),
+        A(matrixSize, matrixSize, numa), BColumns(matrixSize, matrixSize, Layout::ColMajor),
+        C(matrixSize, matrixSize, numa) {
+        A.view().assign(sourceA.view());
+        BColumns.view().assign(sourceB.view());
+    }
+
+    void add(BenchSuite& suite, double operations) {
+        suite.add(name, [this] { multiplyTyped(A, BColumns, C); })
+            .setup([this] { C.fill(0); }).items(operations, "op");
+    }
+
+    // : A  B   , C   
+    double bytes() const {
+        return (2.0 * sizeof(In) + sizeof(Acc)) * matrixSize * matrixSize;
+    }
+
+    // C       
+    void print(const vector<BenchResult>& results, double operations) const {
+        double seconds = BenchSuite::median(results, name);
+        GemmCheck check = gemmValidate<In, Acc>(A.view(), BColumns.view(), C.view());
+        cout << "  " << gemmTypeName<In>() << " -> " << gemmTypeName<Acc>() << ": " << seconds << " , "
+            << operations / seconds / 1e9 << " /,  " << gemmKernelName<In, Acc>() << ", : ";
+        if (check.ok()) cout << "OK";
+        else if (check.overflows > 0) cout << "   " << check.overflows << " ";
+        else cout << "  " << check.mismatches << " ";
+        cout << " (" << check.checked << " ";
+        if (!check.boundFits) cout << ",      " << gemmTypeName<Acc>();
+        cout << ")\n";
+    }
+
+    //   ,  ,     64  A
+    void crossCheck() const {
+        cout << "  ";
+        gemmCrossCheck<In, Acc>(cout, name.c_str(), A.rowRange(0, (min)(64, matrixSize)), BColumns.view());
+    }
+
+    //        ;    
+    //   ,   
+    void edgeCheck() const {
+        cout << "  ";
+        GemmCheck check = gemmEdgeCheck<In, Acc>(cout, name);
+        cout << "      :  " << check.mismatches << ",   "
+            << check.overflows << "  " << check.checked << "\n";
+    }
+};
+
+int main(int argc, char* argv[]) {
     SetConsoleOutputCP(65001);
     setlocale(LC_ALL, "Russian");
     srand(static_cast<unsigned>(time(nullptr)));
 
+    //    (--bench, --bench-trials  .., . common/bench.h),
+    //  roofline (--roofline, . common/roofline.h)   
+    //   NUMA (--numa, . common/numa.h)
+    BenchOptions options;
+    options.trials = 3;
+    RooflineOptions roofline;
+    NumaOptions numa;
+    for (int i = 1; i < argc; ++i) {
+        if (!options.parse(i, argc, argv) && !roofline.parse(i, argc, argv)) {
+            numa.parse(i, argc, argv);
+        }
+    }
+
     omp_set_num_threads(4);
+    string binding = numaBindThreads(numa);
 
-    Matrix A(matrixSize, vector<int>(matrixSize));
-    Matrix B(matrixSize, vector<int>(matrixSize));
-    Matrix C(matrixSize, vector<int>(matrixSize, 0));
+    //     ;   i   
+    // ,   i   schedule(static) (. common/numa.h)
+    Matrix<int> A(matrixSize, matrixSize, numa);
+    Matrix<int> B(matrixSize, matrixSize, numa);
+    Matrix<int> C(matrixSize, matrixSize, numa);
 
     fillMatrix(A);
     fillMatrix(B);
 
+    //   B,   ,   
+    Matrix<int> BColumns(matrixSize, matrixSize, Layout::ColMajor);
+    BColumns.view().assign(B.view());
+
+    //        ;  0..99   int8
+    TypedMultiply<int8_t, int32_t> gemmInt8(A, B, numa);
+    TypedMultiply<int16_t, int32_t> gemmInt16(A, B, numa);
+    TypedMultiply<int32_t, int32_t> gemmInt32(A, B, numa);
+    TypedMultiply<float, float> gemmFloat(A, B, numa);
+
+    if (numa.report) {
+        NumaReport placement("4.1", numa, binding);
+        placement.add("A", A);
+        placement.add("B", B);
+        placement.add("C", C);
+        placement.print(cout);
+    }
+
+    //     C,      
+    const double operations = 2.0 * matrixSize * matrixSize * matrixSize;
+    BenchSuite suite("4.1");
+    suite.add("matmul/sequential", [&] { multiplySequential(A, B, C); })
+        .setup([&] { resetMatrix(C); }).items(operations, "op");
+    suite.add("matmul/omp_static", [&] { multiplyParallelStatic(A, B, C); })
+        .setup([&] { resetMatrix(C); }).items(operations, "op");
+    suite.add("matmul/omp_dynamic4", [&] { multiplyParallelDynamic(A, B, C); })
+        .setup([&] { resetMatrix(C); }).items(operations, "op");
+    suite.add("layout/b_row_major", [&] { multiplyViews(A.view(), B.view(), C.view()); })
+        .setup([&] { resetMatrix(C); }).items(operations, "op");
+    suite.add("layout/b_col_major", [&] { multiplyViews(A.view(), BColumns.view(), C.view()); })
+        .setup([&] { resetMatrix(C); }).items(operations, "op");
+    gemmInt8.add(suite, operations);
+    gemmInt16.add(suite, operations);
+    gemmInt32.add(suite, operations);
+    gemmFloat.add(suite, operations);
+
+    vector<BenchResult> results = suite.run(options);
+    if (options.report) {
+        suite.report(results, options);
+        return 0;
+    }
+
+    //   -    A  B    C;  B 
+    //      ,       
+    if (roofline.enabled) {
+        double bytes = 3.0 * 4 * matrixSize * matrixSize;
+        Roofline model("4.1");
+        model.add("matmul/sequential", "int32", 1, operations, bytes, BenchSuite::median(results, "matmul/sequential"));
+        model.add("matmul/omp_static", "int32", omp_get_max_threads(), operations, bytes,
+            BenchSuite::median(results, "matmul/omp_static"));
+        model.add("matmul/omp_dynamic4", "int32", omp_get_max_threads(), operations, bytes,
+            BenchSuite::median(results, "matmul/omp_dynamic4"));
+        model.add(gemmInt8.name, "int8", omp_get_max_threads(), operations, gemmInt8.bytes(),
+            BenchSuite::median(results, gemmInt8.name));
+        model.add(gemmInt16.name, "int16", omp_get_max_threads(), operations, gemmInt16.bytes(),
+            BenchSuite::median(results, gemmInt16.name));
+        model.add(gemmInt32.name, "int32", omp_get_max_threads(), operations, gemmInt32.bytes(),
+            BenchSuite::median(results, gemmInt32.name));
+        model.add(gemmFloat.name, "fp32", omp_get_max_threads(), operations, gemmFloat.bytes(),
+            BenchSuite::median(results, gemmFloat.name));
+        model.report(cout);
+        if (!roofline.csv.empty()) model.appendCsv(roofline.csv);
+        return 0;
+    }
+
     cout << "\n---     ---\n";
+    cout << "(  " << options.trials << " ,  : " << options.warmup << ")\n\n";
 
-    double timeSequential = measureExecutionTime(multiplySequential, A, B, C);
+    double timeSequential = BenchSuite::median(results, "matmul/sequential");
     cout << " : " << timeSequential << " \n";
     cout << ":   ,   .\n\n";
 
-    resetMatrix(C);
-    double timeStatic = measureExecutionTime(multiplyParallelStatic, A, B, C);
+    double timeStatic = BenchSuite::median(results, "matmul/omp_static");
     cout << "OpenMP Static: " << timeStatic << " \n";
     cout << ":      .\n";
     cout << "     ,       .\n\n";
 
-    resetMatrix(C);
-    double timeDynamic = measureExecutionTime(multiplyParallelDynamic, A, B, C);
+    double timeDynamic = BenchSuite::median(results, "matmul/omp_dynamic4");
     cout << "OpenMP Dynamic (4 ): " << timeDynamic << " \n";
     cout << ":     4 .\n";
-    cout << "    ,      .\n";
+    cout << "    ,      .\n\n";
+
+    cout << " B ( ,  ):   " << BenchSuite::median(results, "layout/b_row_major")
+        << " ,   " << BenchSuite::median(results, "layout/b_col_major") << " \n";
+    cout << ":   B      B ,       .\n\n";
+
+    cout << "      (A  , B  , OpenMP static):\n";
+    gemmInt8.print(results, operations);
+    gemmInt16.print(results, operations);
+    gemmInt32.print(results, operations);
+    gemmFloat.print(results, operations);
+
+    cout << "\n  (: " << simdLevelName(simdDetect())
+        << ",  -  SIMD_LEVEL)  :\n";
+    gemmInt8.crossCheck();
+    gemmInt16.crossCheck();
+    gemmInt32.crossCheck();
+    gemmFloat.crossCheck();
+    cout << "      (max, min),  :\n";
+    gemmInt8.edgeCheck();
+    gemmInt16.edgeCheck();
+    gemmInt32.edgeCheck();
+    gemmFloat.edgeCheck();
 
     return 0;
 }
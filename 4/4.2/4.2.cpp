@@ -1,11 +1,11 @@
 ﻿#include <iostream>
 #include <vector>
-#include <chrono>
 #include <omp.h>
 #include <cstdlib>
 #include <ctime>
 #include <windows.h>
 #include <iomanip>
+#include "../../common/bench.h"
 
 const int N = 10000;
 
@@ -72,42 +72,55 @@ void oddEvenSortParallel(std::vector<int>& array) {
     }
 }
 
-int main() {
+int main(int argc, char* argv[]) {
     // Настройка консоли для поддержки русского языка
     SetConsoleOutputCP(65001);
     setlocale(LC_ALL, "Russian");
 
+    // Флаги стенда замеров (--bench, --bench-trials и т.д., см. common/bench.h)
+    BenchOptions options;
+    for (int i = 1; i < argc; ++i) {
+        options.parse(i, argc, argv);
+    }
+
     omp_set_num_threads(4);
 
+    std::vector<int> source(N);
     std::vector<int> arraySequential(N);
     std::vector<int> arrayParallel(N);
 
     srand(static_cast<unsigned int>(time(nullptr)));
 
+    // Заполнение массива; каждый запуск сортирует свежую копию исходных данных
+    fillArray(source);
+
+    BenchSuite suite("4.2");
+    suite.add("sort/odd_even_sequential", [&] { oddEvenSortSequential(arraySequential); })
+        .setup([&] { arraySequential = source; }).items(N, "elem");
+    suite.add("sort/odd_even_omp", [&] { oddEvenSortParallel(arrayParallel); })
+        .setup([&] { arrayParallel = source; }).items(N, "elem");
+
+    std::vector<BenchResult> results = suite.run(options);
+    if (options.report) {
+        suite.report(results, options);
+        return 0;
+    }
+
     std::cout << "=======================================================\n";
     std::cout << "           Сравнение производительности сортировок\n";
     std::cout << "     Метод нечётно-чётной транспозиции (Odd-Even Sort)\n";
     std::cout << "=======================================================\n";
-    std::cout << "Размер массива: " << N << " элементов\n\n";
-
-    // Заполнение массива
-    fillArray(arraySequential);
-    arrayParallel = arraySequential;
+    std::cout << "Размер массива: " << N << " элементов\n";
+    std::cout << "Медиана по " << options.trials << " замерам, прогревочных запусков: " << options.warmup << "\n\n";
 
     // Последовательная сортировка
-    auto start = std::chrono::high_resolution_clock::now();
-    oddEvenSortSequential(arraySequential);
-    auto end = std::chrono::high_resolution_clock::now();
-    double timeSequential = std::chrono::duration<double>(end - start).count();
+    double timeSequential = BenchSuite::median(results, "sort/odd_even_sequential");
 
     std::cout << "Результат последовательной сортировки:\n";
     std::cout << "Время выполнения: " << std::fixed << std::setprecision(6) << timeSequential << " секунд\n\n";
 
     // Параллельная сортировка
-    start = std::chrono::high_resolution_clock::now();
-    oddEvenSortParallel(arrayParallel);
-    end = std::chrono::high_resolution_clock::now();
-    double timeParallel = std::chrono::duration<double>(end - start).count();
+    double timeParallel = BenchSuite::median(results, "sort/odd_even_omp");
 
     std::cout << "Результат параллельной сортировки:\n";
     std::cout << "Время выполнения: " << std::fixed << std::setprecision(6) << timeParallel << " секунд\n\n";
@@ -1,27 +1,112 @@
 #include <iostream>
 #include <omp.h>
 #include <vector>
-#include <chrono>
 #include <cstdlib>
 #include <windows.h>
 #include <iomanip>
+#include <algorithm>
+#include "../../common/bench.h"
+#include "../../common/roofline.h"
+#include "../../common/numa.h"
+#include "../../common/dispatch.h"
 
 using namespace std;
 
-//    
-long long calculateSumParallel(const vector<int>& array) {
+//  count        (. common/dispatch.h);
+//    int32  int64  
+using SumFn = long long (*)(const int* data, size_t count);
+
+long long sumScalar(const int* data, size_t count) {
     long long sum = 0;
+    for (size_t i = 0; i < count; ++i) {
+        sum += data[i];
+    }
+    return sum;
+}
 
-#pragma omp parallel for reduction(+:sum)
-    for (int i = 0; i < array.size(); ++i) {
-        sum += array[i];
+SIMD_TARGET_SSE42 long long sumSse42(const int* data, size_t count) {
+    __m128i acc0 = _mm_setzero_si128(), acc1 = _mm_setzero_si128();
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        acc0 = _mm_add_epi64(acc0, _mm_cvtepi32_epi64(v));
+        acc1 = _mm_add_epi64(acc1, _mm_cvtepi32_epi64(_mm_srli_si128(v, 8)));
+    }
+    alignas(16) long long lanes[2];
+    _mm_store_si128(reinterpret_cast<__m128i*>(lanes), _mm_add_epi64(acc0, acc1));
+    long long sum = lanes[0] + lanes[1];
+    for (; i < count; ++i) {
+        sum += data[i];
+    }
+    return sum;
+}
+
+SIMD_TARGET_AVX2 long long sumAvx2(const int* data, size_t count) {
+    __m256i acc0 = _mm256_setzero_si256(), acc1 = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        acc0 = _mm256_add_epi64(acc0, _mm256_cvtepi32_epi64(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i))));
+        acc1 = _mm256_add_epi64(acc1, _mm256_cvtepi32_epi64(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i + 4))));
+    }
+    alignas(32) long long lanes[4];
+    _mm256_store_si256(reinterpret_cast<__m256i*>(lanes), _mm256_add_epi64(acc0, acc1));
+    long long sum = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+    for (; i < count; ++i) {
+        sum += data[i];
+    }
+    return sum;
+}
+
+//     :      GCC 12 
+//   -Wuninitialized
+SIMD_TARGET_AVX512 long long sumAvx512(const int* data, size_t count) {
+    __m512i acc0 = _mm512_setzero_si512(), acc1 = _mm512_setzero_si512();
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        acc0 = _mm512_add_epi64(acc0, _mm512_maskz_cvtepi32_epi64(0xFF, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i))));
+        acc1 = _mm512_add_epi64(acc1, _mm512_maskz_cvtepi32_epi64(0xFF, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i + 8))));
+    }
+    alignas(64) long long lanes[8];
+    _mm512_store_si512(lanes, _mm512_add_epi64(acc0, acc1));
+    long long sum = 0;
+    for (int lane = 0; lane < 8; ++lane) {
+        sum += lanes[lane];
+    }
+    for (; i < count; ++i) {
+        sum += data[i];
+    }
+    return sum;
+}
+
+const SimdKernel<SumFn> sumKernel(sumScalar, sumSse42, sumAvx2, sumAvx512);
+
+//     ,   
+long long calculateSumSimd(const NumaArray<int>& array) {
+    return sumKernel.get()(array.data(), array.size());
+}
+
+//       SUM_BLOCK 
+//  schedule(static)    NumaArray, 
+//       
+const long long SUM_BLOCK = 4096;
+
+long long calculateSumParallel(const NumaArray<int>& array) {
+    long long sum = 0;
+    long long size = static_cast<long long>(array.size());
+    long long blocks = (size + SUM_BLOCK - 1) / SUM_BLOCK;
+    SumFn kernel = sumKernel.get();
+
+#pragma omp parallel for schedule(static) reduction(+:sum)
+    for (long long block = 0; block < blocks; ++block) {
+        long long start = block * SUM_BLOCK;
+        sum += kernel(array.data() + start, static_cast<size_t>((std::min)(SUM_BLOCK, size - start)));
     }
 
     return sum;
 }
 
 //    
-long long calculateSumSequential(const vector<int>& array) {
+long long calculateSumSequential(const NumaArray<int>& array) {
     long long sum = 0;
 
     for (int i = 0; i < array.size(); ++i) {
@@ -31,66 +116,118 @@ long long calculateSumSequential(const vector<int>& array) {
     return sum;
 }
 
-int main() {
+int main(int argc, char* argv[]) {
     //         
     SetConsoleOutputCP(65001);
     setlocale(LC_ALL, "Russian");
 
+    //    (--bench, --bench-trials  .., . common/bench.h),
+    //  roofline (--roofline, . common/roofline.h)   
+    //   NUMA (--numa, . common/numa.h)
+    BenchOptions options;
+    RooflineOptions roofline;
+    NumaOptions numa;
+    for (int i = 1; i < argc; ++i) {
+        if (!options.parse(i, argc, argv) && !roofline.parse(i, argc, argv)) {
+            numa.parse(i, argc, argv);
+        }
+    }
+
+    //     OpenMP;   ,   
+    //     ,   
+    omp_set_num_threads(4);
+    string binding = numaBindThreads(numa);
+
     const size_t arraySize = 10000000;
-    vector<int> array(arraySize);
+    NumaArray<int> array(arraySize, numa);
 
     srand(static_cast<unsigned>(time(nullptr)));
 
-    //      0  99
+    //      0  99;   
+    //  ,     
     for (size_t i = 0; i < arraySize; ++i) {
         array[i] = rand() % 100;
     }
 
-    //     OpenMP
-    omp_set_num_threads(4);
+    if (numa.report) {
+        NumaReport placement("5.1", numa, binding);
+        placement.add("array", array);
+        placement.print(cout);
+    }
+
+    //     ,      
+    //   (        )
+    long long sumParallel = 0;
+    long long sumSequential = 0;
+    long long sumSimd = 0;
+    BenchSuite suite("5.1");
+    suite.add("sum/sequential", [&] { sumSequential = calculateSumSequential(array); DoNotOptimize(sumSequential); })
+        .items(static_cast<double>(arraySize), "elem");
+    suite.add("sum/simd", [&] { sumSimd = calculateSumSimd(array); DoNotOptimize(sumSimd); })
+        .items(static_cast<double>(arraySize), "elem");
+    suite.add("sum/omp_reduction", [&] { sumParallel = calculateSumParallel(array); DoNotOptimize(sumParallel); })
+        .items(static_cast<double>(arraySize), "elem");
+
+    vector<BenchResult> results = suite.run(options);
+    if (options.report) {
+        suite.report(results, options);
+        return 0;
+    }
+    double timeSequential = BenchSuite::median(results, "sum/sequential");
+    double timeSimd = BenchSuite::median(results, "sum/simd");
+    double timeParallel = BenchSuite::median(results, "sum/omp_reduction");
+
+    // :    4    
+    if (roofline.enabled) {
+        double n = static_cast<double>(arraySize);
+        Roofline model("5.1");
+        model.add("sum/sequential", "int32", 1, n, 4 * n, timeSequential);
+        model.add("sum/simd", "int32", 1, n, 4 * n, timeSimd);
+        model.add("sum/omp_reduction", "int32", omp_get_max_threads(), n, 4 * n, timeParallel);
+        model.report(cout);
+        if (!roofline.csv.empty()) model.appendCsv(roofline.csv);
+        return 0;
+    }
 
     cout << "=============================================================\n";
     cout << "             \n";
     cout << "                  \n";
     cout << "=============================================================\n";
     cout << "   : " << arraySize << "\n";
-    cout << "    : 4\n\n";
-
-    //  
-    auto startParallel = chrono::high_resolution_clock::now();
-    long long sumParallel = calculateSumParallel(array);
-    auto endParallel = chrono::high_resolution_clock::now();
-    chrono::duration<double> timeParallel = endParallel - startParallel;
-
-    //  
-    auto startSequential = chrono::high_resolution_clock::now();
-    long long sumSequential = calculateSumSequential(array);
-    auto endSequential = chrono::high_resolution_clock::now();
-    chrono::duration<double> timeSequential = endSequential - startSequential;
+    cout << "    : 4\n";
+    cout << "  : " << simdLevelName(sumKernel.level())
+        << " (: " << simdLevelName(simdDetect()) << ",  -  SIMD_LEVEL)\n";
+    cout << "  " << options.trials << " ,  : " << options.warmup << "\n\n";
 
     // 
     cout << " :\n";
     cout << " -  ():     " << sumParallel << "\n";
-    cout << " -  (): " << sumSequential << "\n\n";
+    cout << " -  (): " << sumSequential << "\n";
+    cout << " -  (SIMD,  ): " << sumSimd << "\n\n";
 
     cout << " :\n";
-    cout << " -  :     " << fixed << setprecision(6) << timeParallel.count() << " \n";
-    cout << " -  : " << fixed << setprecision(6) << timeSequential.count() << " \n\n";
+    cout << " -  :     " << fixed << setprecision(6) << timeParallel << " \n";
+    cout << " -  : " << fixed << setprecision(6) << timeSequential << " \n";
+    cout << " - SIMD   :         " << fixed << setprecision(6) << timeSimd << " \n\n";
 
     //  
     cout << " :\n";
-    if (sumParallel == sumSequential) {
+    if (sumParallel == sumSequential && sumSimd == sumSequential) {
         cout << " -  .   .\n";
     }
     else {
         cout << " - :   .   .\n";
     }
+    cout << " -    : ";
+    simdCrossCheck(cout, "sum", sumKernel, [&](SumFn kernel) { return kernel(array.data(), array.size()); });
 
     //  
     cout << "\n :\n";
     cout << " -      "
         << fixed << setprecision(2)
-        << (timeSequential.count() / timeParallel.count()) << " ()\n";
+        << (timeSequential / timeParallel) << " ()\n";
+    cout << " - SIMD       "
+        << (timeSequential / timeSimd) << " ()\n";
 
     cout << "=============================================================\n";
 
@@ -1,10 +1,12 @@
 ﻿#include <iostream>
 #include <omp.h>
 #include <cmath>
-#include <chrono>
 #include <windows.h>
 #include <iomanip>
 #include <locale>
+#include "../../common/bench.h"
+#include "../../common/dispatch.h"
+#include "../../common/repro_sum.h"
 
 double integrateParallel(double a, double b, int steps) {
     double h = (b - a) / steps;
@@ -19,6 +21,28 @@ double integrateParallel(double a, double b, int steps) {
     return total * h;
 }
 
+// Воспроизводимая редукция: каждый поток копит точную сумму своих точек, суммы
+// объединяются без округлений (см. common/repro_sum.h), поэтому результат побитово
+// один и тот же при любом числе потоков и расписании
+double integrateReproducible(double a, double b, int steps) {
+    double h = (b - a) / steps;
+    ReproducibleSum total;
+
+#pragma omp parallel
+    {
+        ReproducibleSum local;
+#pragma omp for nowait
+        for (int i = 0; i < steps; ++i) {
+            double x = a + (i + 0.5) * h;
+            local.add(sin(x));
+        }
+#pragma omp critical
+        total.merge(local);
+    }
+
+    return total.value() * h;
+}
+
 double integrateSingleThread(double a, double b, int steps) {
     double h = (b - a) / steps;
     double total = 0.0;
@@ -31,10 +55,192 @@ double integrateSingleThread(double a, double b, int steps) {
     return total * h;
 }
 
-int main() {
+// Векторное ядро: сумма sin(a + (i + 0.5) * h) по i из [begin, end) в вариантах для
+// разных наборов команд (см. common/dispatch.h).
+// Все варианты дают побитово одинаковый результат: sin считается одним и тем же
+// многочленом без FMA (скалярные функции помечены SIMD_TARGET_SCALAR, чтобы
+// компилятор не слил умножения и сложения и при сборке с -mfma), а точка i всегда прибавляется к частичной сумме
+// (i - begin) % SIN_LANES, и частичные суммы складываются в одном порядке.
+// Поэтому SSE4.2 держит 4 регистра по 2 суммы, AVX2 - 2 по 4, AVX-512 - 1 на 8
+const int SIN_LANES = 8;
+const double INV_PI = 0.318309886183790671538;
+const double PI_HI = 3.141592653589793116;
+const double PI_LO = 1.2246467991473532e-16;
+
+// Ряд Тейлора sin(r) = r + r * r^2 * (c3 + r^2 * (c5 + ... + r^2 * c21)), от старшего
+// коэффициента; на |r| <= pi/2 остаток меньше 1e-17
+const int SIN_TERMS = 10;
+const double SIN_COEFFS[SIN_TERMS] = {
+    1.0 / 51090942171709440000.0, -1.0 / 121645100408832000.0, 1.0 / 355687428096000.0,
+    -1.0 / 1307674368000.0, 1.0 / 6227020800.0, -1.0 / 39916800.0, 1.0 / 362880.0,
+    -1.0 / 5040.0, 1.0 / 120.0, -1.0 / 6.0
+};
+
+using SinSumFn = double (*)(double a, double h, int begin, int end);
+
+// sin(x) = (-1)^k sin(r), x = k * pi + r
+SIMD_TARGET_SCALAR inline double sinPoly(double x) {
+    double k = std::floor(x * INV_PI + 0.5);
+    double r = (x - k * PI_HI) - k * PI_LO;
+    double r2 = r * r;
+    double p = SIN_COEFFS[0];
+    for (int c = 1; c < SIN_TERMS; ++c) {
+        p = p * r2 + SIN_COEFFS[c];
+    }
+    double parity = k - 2.0 * std::floor(k * 0.5);
+    return (r + r * r2 * p) * (1.0 - 2.0 * parity);
+}
+
+SIMD_TARGET_SCALAR inline double sinCombine(const double* partial) {
+    return ((partial[0] + partial[1]) + (partial[2] + partial[3]))
+        + ((partial[4] + partial[5]) + (partial[6] + partial[7]));
+}
+
+SIMD_TARGET_SCALAR double sinSumScalar(double a, double h, int begin, int end) {
+    double partial[SIN_LANES] = {};
+    int i = begin;
+    for (; i + SIN_LANES <= end; i += SIN_LANES) {
+        for (int lane = 0; lane < SIN_LANES; ++lane) {
+            partial[lane] += sinPoly(a + (i + lane + 0.5) * h);
+        }
+    }
+    double total = sinCombine(partial);
+    for (; i < end; ++i) {
+        total += sinPoly(a + (i + 0.5) * h);
+    }
+    return total;
+}
+
+SIMD_TARGET_SSE42 inline __m128d sinPolySse42(__m128d x) {
+    __m128d k = _mm_floor_pd(_mm_add_pd(_mm_mul_pd(x, _mm_set1_pd(INV_PI)), _mm_set1_pd(0.5)));
+    __m128d r = _mm_sub_pd(_mm_sub_pd(x, _mm_mul_pd(k, _mm_set1_pd(PI_HI))), _mm_mul_pd(k, _mm_set1_pd(PI_LO)));
+    __m128d r2 = _mm_mul_pd(r, r);
+    __m128d p = _mm_set1_pd(SIN_COEFFS[0]);
+    for (int c = 1; c < SIN_TERMS; ++c) {
+        p = _mm_add_pd(_mm_mul_pd(p, r2), _mm_set1_pd(SIN_COEFFS[c]));
+    }
+    __m128d parity = _mm_sub_pd(k, _mm_mul_pd(_mm_set1_pd(2.0), _mm_floor_pd(_mm_mul_pd(k, _mm_set1_pd(0.5)))));
+    __m128d sign = _mm_sub_pd(_mm_set1_pd(1.0), _mm_mul_pd(_mm_set1_pd(2.0), parity));
+    return _mm_mul_pd(_mm_add_pd(r, _mm_mul_pd(_mm_mul_pd(r, r2), p)), sign);
+}
+
+SIMD_TARGET_SSE42 double sinSumSse42(double a, double h, int begin, int end) {
+    __m128d acc[4], offset[4];
+    for (int v = 0; v < 4; ++v) {
+        acc[v] = _mm_setzero_pd();
+        offset[v] = _mm_set_pd(begin + 2 * v + 1.5, begin + 2 * v + 0.5);
+    }
+    const __m128d va = _mm_set1_pd(a), vh = _mm_set1_pd(h), step = _mm_set1_pd(SIN_LANES);
+    int i = begin;
+    for (; i + SIN_LANES <= end; i += SIN_LANES) {
+        for (int v = 0; v < 4; ++v) {
+            acc[v] = _mm_add_pd(acc[v], sinPolySse42(_mm_add_pd(va, _mm_mul_pd(offset[v], vh))));
+            offset[v] = _mm_add_pd(offset[v], step);
+        }
+    }
+    alignas(16) double partial[SIN_LANES];
+    for (int v = 0; v < 4; ++v) {
+        _mm_store_pd(partial + 2 * v, acc[v]);
+    }
+    double total = sinCombine(partial);
+    for (; i < end; ++i) {
+        total += sinPoly(a + (i + 0.5) * h);
+    }
+    return total;
+}
+
+SIMD_TARGET_AVX2 inline __m256d sinPolyAvx2(__m256d x) {
+    __m256d k = _mm256_floor_pd(_mm256_add_pd(_mm256_mul_pd(x, _mm256_set1_pd(INV_PI)), _mm256_set1_pd(0.5)));
+    __m256d r = _mm256_sub_pd(_mm256_sub_pd(x, _mm256_mul_pd(k, _mm256_set1_pd(PI_HI))), _mm256_mul_pd(k, _mm256_set1_pd(PI_LO)));
+    __m256d r2 = _mm256_mul_pd(r, r);
+    __m256d p = _mm256_set1_pd(SIN_COEFFS[0]);
+    for (int c = 1; c < SIN_TERMS; ++c) {
+        p = _mm256_add_pd(_mm256_mul_pd(p, r2), _mm256_set1_pd(SIN_COEFFS[c]));
+    }
+    __m256d parity = _mm256_sub_pd(k, _mm256_mul_pd(_mm256_set1_pd(2.0), _mm256_floor_pd(_mm256_mul_pd(k, _mm256_set1_pd(0.5)))));
+    __m256d sign = _mm256_sub_pd(_mm256_set1_pd(1.0), _mm256_mul_pd(_mm256_set1_pd(2.0), parity));
+    return _mm256_mul_pd(_mm256_add_pd(r, _mm256_mul_pd(_mm256_mul_pd(r, r2), p)), sign);
+}
+
+SIMD_TARGET_AVX2 double sinSumAvx2(double a, double h, int begin, int end) {
+    __m256d acc[2], offset[2];
+    for (int v = 0; v < 2; ++v) {
+        acc[v] = _mm256_setzero_pd();
+        offset[v] = _mm256_set_pd(begin + 4 * v + 3.5, begin + 4 * v + 2.5, begin + 4 * v + 1.5, begin + 4 * v + 0.5);
+    }
+    const __m256d va = _mm256_set1_pd(a), vh = _mm256_set1_pd(h), step = _mm256_set1_pd(SIN_LANES);
+    int i = begin;
+    for (; i + SIN_LANES <= end; i += SIN_LANES) {
+        for (int v = 0; v < 2; ++v) {
+            acc[v] = _mm256_add_pd(acc[v], sinPolyAvx2(_mm256_add_pd(va, _mm256_mul_pd(offset[v], vh))));
+            offset[v] = _mm256_add_pd(offset[v], step);
+        }
+    }
+    alignas(32) double partial[SIN_LANES];
+    for (int v = 0; v < 2; ++v) {
+        _mm256_store_pd(partial + 4 * v, acc[v]);
+    }
+    double total = sinCombine(partial);
+    for (; i < end; ++i) {
+        total += sinPoly(a + (i + 0.5) * h);
+    }
+    return total;
+}
+
+// Округление вниз с маской всех дорожек: форма без маски в заголовках GCC 12 даёт
+// ложное предупреждение -Wuninitialized
+SIMD_TARGET_AVX512 inline __m512d sinPolyAvx512(__m512d x) {
+    const int floor_mode = _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC;
+    __m512d k = _mm512_maskz_roundscale_pd(0xFF, _mm512_add_pd(_mm512_mul_pd(x, _mm512_set1_pd(INV_PI)), _mm512_set1_pd(0.5)), floor_mode);
+    __m512d r = _mm512_sub_pd(_mm512_sub_pd(x, _mm512_mul_pd(k, _mm512_set1_pd(PI_HI))), _mm512_mul_pd(k, _mm512_set1_pd(PI_LO)));
+    __m512d r2 = _mm512_mul_pd(r, r);
+    __m512d p = _mm512_set1_pd(SIN_COEFFS[0]);
+    for (int c = 1; c < SIN_TERMS; ++c) {
+        p = _mm512_add_pd(_mm512_mul_pd(p, r2), _mm512_set1_pd(SIN_COEFFS[c]));
+    }
+    __m512d parity = _mm512_sub_pd(k, _mm512_mul_pd(_mm512_set1_pd(2.0),
+        _mm512_maskz_roundscale_pd(0xFF, _mm512_mul_pd(k, _mm512_set1_pd(0.5)), floor_mode)));
+    __m512d sign = _mm512_sub_pd(_mm512_set1_pd(1.0), _mm512_mul_pd(_mm512_set1_pd(2.0), parity));
+    return _mm512_mul_pd(_mm512_add_pd(r, _mm512_mul_pd(_mm512_mul_pd(r, r2), p)), sign);
+}
+
+SIMD_TARGET_AVX512 double sinSumAvx512(double a, double h, int begin, int end) {
+    __m512d acc = _mm512_setzero_pd();
+    __m512d offset = _mm512_set_pd(begin + 7.5, begin + 6.5, begin + 5.5, begin + 4.5,
+        begin + 3.5, begin + 2.5, begin + 1.5, begin + 0.5);
+    const __m512d va = _mm512_set1_pd(a), vh = _mm512_set1_pd(h), step = _mm512_set1_pd(SIN_LANES);
+    int i = begin;
+    for (; i + SIN_LANES <= end; i += SIN_LANES) {
+        acc = _mm512_add_pd(acc, sinPolyAvx512(_mm512_add_pd(va, _mm512_mul_pd(offset, vh))));
+        offset = _mm512_add_pd(offset, step);
+    }
+    alignas(64) double partial[SIN_LANES];
+    _mm512_store_pd(partial, acc);
+    double total = sinCombine(partial);
+    for (; i < end; ++i) {
+        total += sinPoly(a + (i + 0.5) * h);
+    }
+    return total;
+}
+
+const SimdKernel<SinSumFn> sinSumKernel(sinSumScalar, sinSumSse42, sinSumAvx2, sinSumAvx512);
+
+// Один поток, векторное ядро, выбранное при запуске
+double integrateSimd(double a, double b, int steps) {
+    double h = (b - a) / steps;
+    return sinSumKernel.get()(a, h, 0, steps) * h;
+}
+
+int main(int argc, char* argv[]) {
     SetConsoleOutputCP(65001);
     setlocale(LC_ALL, "Russian");
 
+    // Флаги стенда замеров (--bench, --bench-trials и т.д., см. common/bench.h)
+    BenchOptions options;
+    for (int i = 1; i < argc; ++i) {
+        options.parse(i, argc, argv);
+    }
+
     const double a = 0.0;
     const double b = 3.1415; // приближённое значение π
     const int steps = 10000000;
@@ -43,46 +249,97 @@ int main() {
 
     omp_set_num_threads(4);
 
+    double result_parallel = 0.0;
+    double result_single = 0.0;
+    double result_simd = 0.0;
+    double result_reproducible = 0.0;
+    BenchSuite suite("5.2");
+    suite.add("integrate/sequential", [&] { result_single = integrateSingleThread(a, b, steps); DoNotOptimize(result_single); })
+        .items(steps, "step");
+    suite.add("integrate/simd", [&] { result_simd = integrateSimd(a, b, steps); DoNotOptimize(result_simd); })
+        .items(steps, "step");
+    suite.add("integrate/omp_reduction", [&] { result_parallel = integrateParallel(a, b, steps); DoNotOptimize(result_parallel); })
+        .items(steps, "step");
+    suite.add("integrate/omp_reproducible", [&] { result_reproducible = integrateReproducible(a, b, steps); DoNotOptimize(result_reproducible); })
+        .items(steps, "step");
+
+    std::vector<BenchResult> results = suite.run(options);
+    if (options.report) {
+        suite.report(results, options);
+        return 0;
+    }
+    double time_single = BenchSuite::median(results, "integrate/sequential");
+    double time_parallel = BenchSuite::median(results, "integrate/omp_reduction");
+    double time_simd = BenchSuite::median(results, "integrate/simd");
+    double time_reproducible = BenchSuite::median(results, "integrate/omp_reproducible");
+
     std::cout << "=============================================================\n";
     std::cout << "              Численное интегрирование функции\n";
     std::cout << "              Метод прямоугольников (Rectangle Rule)\n";
     std::cout << "=============================================================\n";
     std::cout << "Вычисляем определённый интеграл функции sin(x)\n";
     std::cout << "На интервале от " << a << " до " << b << "\n";
-    std::cout << "Количество шагов: " << steps << "\n\n";
-
-    auto start_parallel = std::chrono::high_resolution_clock::now();
-    double result_parallel = integrateParallel(a, b, steps);
-    auto end_parallel = std::chrono::high_resolution_clock::now();
-    double time_parallel = std::chrono::duration<double>(end_parallel - start_parallel).count();
-
-    auto start_single = std::chrono::high_resolution_clock::now();
-    double result_single = integrateSingleThread(a, b, steps);
-    auto end_single = std::chrono::high_resolution_clock::now();
-    double time_single = std::chrono::duration<double>(end_single - start_single).count();
+    std::cout << "Количество шагов: " << steps << "\n";
+    std::cout << "Вариант векторного ядра: " << simdLevelName(sinSumKernel.level())
+        << " (процессор: " << simdLevelName(simdDetect()) << ", выбор - переменная SIMD_LEVEL)\n";
+    std::cout << "Медиана по " << options.trials << " замерам, прогревочных запусков: " << options.warmup << "\n\n";
 
     std::cout << "-------------------- Результаты -----------------------------\n";
     std::cout << std::fixed << std::setprecision(10);
     std::cout << "Ожидаемое (аналитическое) значение интеграла : " << expected << "\n";
     std::cout << "Параллельный расчёт                          : " << result_parallel << "\n";
-    std::cout << "Последовательный расчёт                      : " << result_single << "\n\n";
+    std::cout << "Последовательный расчёт                      : " << result_single << "\n";
+    std::cout << "Векторный расчёт в одном потоке              : " << result_simd << "\n";
+    std::cout << "Параллельный воспроизводимый расчёт          : " << result_reproducible << "\n\n";
 
     std::cout << std::setprecision(6);
     std::cout << "Время выполнения (параллельно)   : " << time_parallel << " секунд\n";
     std::cout << "Время выполнения (один поток)    : " << time_single << " секунд\n";
+    std::cout << "Время выполнения (SIMD, 1 поток) : " << time_simd << " секунд\n";
+    std::cout << "Время выполнения (воспроизводимо): " << time_reproducible << " секунд\n";
 
     std::cout << "\n------------------ Проверка точности -------------------------\n";
     if (std::abs(result_parallel - expected) < epsilon &&
-        std::abs(result_single - expected) < epsilon) {
-        std::cout << "Оба метода дали корректный результат с допустимой погрешностью.\n";
+        std::abs(result_single - expected) < epsilon &&
+        std::abs(result_simd - expected) < epsilon &&
+        std::abs(result_reproducible - expected) < epsilon) {
+        std::cout << "Все методы дали корректный результат с допустимой погрешностью.\n";
     }
     else {
         std::cout << "Результаты не совпадают с аналитическим решением!\n";
     }
+    std::cout << "Варианты ядра против скалярного (побитово): ";
+    double h = (b - a) / steps;
+    simdCrossCheck(std::cout, "integrate", sinSumKernel, [&](SinSumFn kernel) { return kernel(a, h, 0, steps); });
+
+    // Обычная редукция меняется с числом потоков, воспроизводимая - нет
+    std::cout << "\n---------- Зависимость от числа потоков (17 знаков) ----------\n";
+    std::cout << "Потоков   omp reduction          воспроизводимая\n";
+    std::cout << std::setprecision(17);
+    double first_parallel = 0.0, first_reproducible = 0.0;
+    bool parallel_stable = true, reproducible_stable = true;
+    int saved_threads = omp_get_max_threads();
+    for (int threads : { 1, 2, 3, 4, 8 }) {
+        omp_set_num_threads(threads);
+        double parallel = integrateParallel(a, b, steps);
+        double reproducible = integrateReproducible(a, b, steps);
+        if (threads == 1) {
+            first_parallel = parallel;
+            first_reproducible = reproducible;
+        }
+        parallel_stable = parallel_stable && parallel == first_parallel;
+        reproducible_stable = reproducible_stable && reproducible == first_reproducible;
+        std::cout << std::setw(7) << threads << "   " << parallel << "   " << reproducible << "\n";
+    }
+    omp_set_num_threads(saved_threads);
+    std::cout << "omp reduction: " << (parallel_stable ? "совпадает" : "зависит от числа потоков")
+        << ", воспроизводимая: " << (reproducible_stable ? "совпадает побитово" : "РАЗЛИЧАЕТСЯ") << "\n";
 
     std::cout << "=============================================================\n";
     std::cout << "Разница во времени выполнения (ускорение): "
         << std::setprecision(2) << time_single / time_parallel << " раз(а)\n";
+    std::cout << "Ускорение векторного ядра в одном потоке: " << time_single / time_simd << " раз(а)\n";
+    std::cout << "Цена воспроизводимости против omp reduction: " << time_reproducible / time_parallel << " раз(а)\n";
     std::cout << "=============================================================\n";
 
     return 0;
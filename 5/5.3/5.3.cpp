@@ -1,82 +1,233 @@
 #include <iostream>
 #include <vector>
 #include <omp.h>
-#include <chrono>
 #include <windows.h>
 #include <iomanip>
+#include "../../common/bench.h"
+#include "../../common/perf_counters.h"
+#include "../../common/roofline.h"
+#include "../../common/matrix.h"
+#include "../../common/gemm.h"
 
 using namespace std;
 
 //     
-vector<int> multiplyMatrixVectorSingle(const vector<vector<int>>& matrix, const vector<int>& vec) {
-    int rows = matrix.size();
-    int cols = matrix[0].size();
+vector<int> multiplyMatrixVectorSingle(const Matrix<int>& matrix, const vector<int>& vec) {
+    int rows = matrix.rows();
+    int cols = matrix.cols();
     vector<int> result(rows, 0);
 
+    PerfRegion region("multiplyMatrixVectorSingle");
     for (int i = 0; i < rows; ++i) {
+        const int* row = matrix.row(i);
         for (int j = 0; j < cols; ++j) {
-            result[i] += matrix[i][j] * vec[j];
+            result[i] += row[j] * vec[j];
         }
     }
     return result;
 }
 
-//     
-vector<int> multiplyMatrixVectorParallel(const vector<vector<int>>& matrix, const vector<int>& vec) {
-    int rows = matrix.size();
-    int cols = matrix[0].size();
+//     ;      ,
+//     (schedule(static)  ),   
+vector<int> multiplyMatrixVectorParallel(const Matrix<int>& matrix, const vector<int>& vec) {
+    int rows = matrix.rows();
+    int cols = matrix.cols();
     vector<int> result(rows, 0);
 
-#pragma omp parallel for
-    for (int i = 0; i < rows; ++i) {
-        for (int j = 0; j < cols; ++j) {
-            result[i] += matrix[i][j] * vec[j];
+#pragma omp parallel
+    {
+        //    -     (nowait)
+        PerfRegion region("multiplyMatrixVectorParallel");
+#pragma omp for schedule(static) nowait
+        for (int i = 0; i < rows; ++i) {
+            const int* row = matrix.row(i);
+            for (int j = 0; j < cols; ++j) {
+                result[i] += row[j] * vec[j];
+            }
         }
     }
     return result;
 }
 
-int main() {
+//        (. common/gemm.h); 
+//     ,   multiplyMatrixVectorParallel
+template <class In, class Acc>
+void multiplyMatrixVectorTyped(const Matrix<In>& matrix, const vector<In>& vec, vector<Acc>& result) {
+#pragma omp parallel for schedule(static)
+    for (int i = 0; i < matrix.rows(); ++i) {
+        gemv<In, Acc>(matrix.rowRange(i, i + 1), vec.data(), &result[i]);
+    }
+}
+
+//          matvec/<>_<>  
+template <class In, class Acc>
+struct TypedMatvec {
+    string name;
+    Matrix<In> matrix;
+    vector<In> vec;
+    vector<Acc> result;
+
+    TypedMatvec(const Matrix<int>& sourceMatrix, const vector<int>& sourceVec, const NumaOptions& numa)
+        : name(string("matvec/") + gemmTypeName<In>() + "_" + gemmTypeName<Acc>()),
+        matrix(sourceMatrix.rows(), sourceMatrix.cols(), numa), vec(sourceVec.begin(), sourceVec.end()),
+        result(sourceMatrix.rows()) {
+        matrix.view().assign(sourceMatrix.view());
+    }
+
+    void add(BenchSuite& suite, double operations) {
+        suite.add(name, [this] { multiplyMatrixVectorTyped(matrix, vec, result); }).items(operations, "op");
+    }
+
+    // :      ,    
+    double bytes() const {
+        return sizeof(In) * (static_cast<double>(matrix.rows()) * matrix.cols() + matrix.cols())
+            + sizeof(Acc) * static_cast<double>(matrix.rows());
+    }
+
+    void print(const vector<BenchResult>& results, double operations) const {
+        double seconds = BenchSuite::median(results, name);
+        GemmCheck check = gemvValidate<In, Acc>(matrix.view(), vec.data(), result.data());
+        cout << "  " << left << setw(6) << gemmTypeName<In>() << "-> " << setw(8) << string(gemmTypeName<Acc>()) + ":" << right
+            << fixed << setprecision(6) << seconds << " , " << setprecision(2) << operations / seconds / 1e9
+            << " /,  " << gemmKernelName<In, Acc>() << ", : ";
+        if (check.ok()) cout << "OK";
+        else if (check.overflows > 0) cout << "   " << check.overflows << " ";
+        else cout << "  " << check.mismatches << " ";
+        cout << "\n";
+    }
+
+    //   ,  ,  
+    void crossCheck() const {
+        cout << "  ";
+        gemvCrossCheck<In, Acc>(cout, name.c_str(), matrix.view(), vec.data());
+    }
+
+    //        ;    
+    //   ,   
+    void edgeCheck() const {
+        cout << "  ";
+        GemmCheck check = gemvEdgeCheck<In, Acc>(cout, name);
+        cout << "      :  " << check.mismatches << ",   "
+            << check.overflows << "  " << check.checked << "\n";
+    }
+};
+
+int main(int argc, char* argv[]) {
     //      
     SetConsoleOutputCP(65001);
     setlocale(LC_ALL, "Russian");
 
+    //    (--bench, --bench-trials  .., . common/bench.h),
+    //  roofline (--roofline, . common/roofline.h)   
+    //   NUMA (--numa, . common/numa.h)
+    BenchOptions options;
+    RooflineOptions roofline;
+    NumaOptions numa;
+    for (int i = 1; i < argc; ++i) {
+        if (!options.parse(i, argc, argv) && !roofline.parse(i, argc, argv)) {
+            numa.parse(i, argc, argv);
+        }
+    }
+
     //    
     const int rows = 5000, cols = 5000;
     omp_set_num_threads(8); //    OpenMP
+    string binding = numaBindThreads(numa);
 
-    //    ,  
-    vector<vector<int>> matrix(rows, vector<int>(cols, 1));
+    //   (,  )  ,  .
+    //        
+    Matrix<int> matrix(rows, cols, numa);
+    matrix.fill(1);
     vector<int> vec(cols, 1);
 
+    //        
+    TypedMatvec<int8_t, int32_t> matvecInt8(matrix, vec, numa);
+    TypedMatvec<int16_t, int32_t> matvecInt16(matrix, vec, numa);
+    TypedMatvec<int32_t, int32_t> matvecInt32(matrix, vec, numa);
+    TypedMatvec<float, float> matvecFloat(matrix, vec, numa);
+
+    if (numa.report) {
+        NumaReport placement("5.3", numa, binding);
+        placement.add("matrix", matrix);
+        placement.print(cout);
+    }
+
+    vector<int> result_single, result_parallel;
+    const double operations = 2.0 * rows * cols;
+    BenchSuite suite("5.3");
+    suite.add("matvec/sequential", [&] { result_single = multiplyMatrixVectorSingle(matrix, vec); })
+        .items(operations, "op");
+    suite.add("matvec/omp", [&] { result_parallel = multiplyMatrixVectorParallel(matrix, vec); })
+        .items(operations, "op");
+    matvecInt8.add(suite, operations);
+    matvecInt16.add(suite, operations);
+    matvecInt32.add(suite, operations);
+    matvecFloat.add(suite, operations);
+
+    vector<BenchResult> results = suite.run(options);
+    if (options.report) {
+        suite.report(results, options);
+        return 0;
+    }
+    double duration_single = BenchSuite::median(results, "matvec/sequential");
+    double duration_parallel = BenchSuite::median(results, "matvec/omp");
+
+    //   : 2    ,    
+    if (roofline.enabled) {
+        double bytes = 4.0 * rows * cols + 4.0 * cols + 4.0 * rows;
+        Roofline model("5.3");
+        model.add("matvec/sequential", "int32", 1, operations, bytes, duration_single);
+        model.add("matvec/omp", "int32", omp_get_max_threads(), operations, bytes, duration_parallel);
+        model.add(matvecInt8.name, "int8", omp_get_max_threads(), operations, matvecInt8.bytes(),
+            BenchSuite::median(results, matvecInt8.name));
+        model.add(matvecInt16.name, "int16", omp_get_max_threads(), operations, matvecInt16.bytes(),
+            BenchSuite::median(results, matvecInt16.name));
+        model.add(matvecInt32.name, "int32", omp_get_max_threads(), operations, matvecInt32.bytes(),
+            BenchSuite::median(results, matvecInt32.name));
+        model.add(matvecFloat.name, "fp32", omp_get_max_threads(), operations, matvecFloat.bytes(),
+            BenchSuite::median(results, matvecFloat.name));
+        model.report(cout);
+        if (!roofline.csv.empty()) model.appendCsv(roofline.csv);
+        return 0;
+    }
+
     cout << "================================================================\n";
     cout << "                                        \n";
     cout << "================================================================\n";
     cout << " : " << rows << " x " << cols << "\n";
     cout << " : " << cols << "\n";
-    cout << "      1.\n\n";
-
-    //  
-    auto start_single = chrono::high_resolution_clock::now();
-    vector<int> result_single = multiplyMatrixVectorSingle(matrix, vec);
-    auto end_single = chrono::high_resolution_clock::now();
-    chrono::duration<double> duration_single = end_single - start_single;
-
-    //  
-    auto start_parallel = chrono::high_resolution_clock::now();
-    vector<int> result_parallel = multiplyMatrixVectorParallel(matrix, vec);
-    auto end_parallel = chrono::high_resolution_clock::now();
-    chrono::duration<double> duration_parallel = end_parallel - start_parallel;
+    cout << "      1.\n";
+    cout << "  " << options.trials << " ,  : " << options.warmup << "\n\n";
 
     //  
     cout << "-------------------   ----------------------\n";
     cout << fixed << setprecision(6);
-    cout << "  ()   : " << duration_single.count() << " \n";
-    cout << "  ()       : " << duration_parallel.count() << " \n";
+    cout << "  ()   : " << duration_single << " \n";
+    cout << "  ()       : " << duration_parallel << " \n";
 
     //  
-    double speedup = duration_single.count() / duration_parallel.count();
-    cout << "    : " << fixed << setprecision(2) << speedup << " ()\n";
+    double speedup = duration_single / duration_parallel;
+    cout << "    : " << fixed << setprecision(2) << speedup << " ()\n\n";
+
+    //    ,      
+    //  :    
+    cout << "     :\n";
+    matvecInt8.print(results, operations);
+    matvecInt16.print(results, operations);
+    matvecInt32.print(results, operations);
+    matvecFloat.print(results, operations);
+
+    cout << "\n  (: " << simdLevelName(simdDetect())
+        << ",  -  SIMD_LEVEL)  :\n";
+    matvecInt8.crossCheck();
+    matvecInt16.crossCheck();
+    matvecInt32.crossCheck();
+    matvecFloat.crossCheck();
+    cout << "      (max, min),  :\n";
+    matvecInt8.edgeCheck();
+    matvecInt16.edgeCheck();
+    matvecInt32.edgeCheck();
+    matvecFloat.edgeCheck();
 
     cout << "================================================================\n";
     return 0;
@@ -5,6 +5,8 @@
 #include <omp.h>
 #include <windows.h>
 #include <string>
+#include "../common/perf_counters.h"
+#include "../common/dispatch.h"
 
 const int HEIGHT = 30;
 const int WIDTH = 80;
@@ -28,34 +30,140 @@ void renderField(const std::vector<std::vector<int>>& field) {
     }
 }
 
-// Подсчёт живых соседей
-int countNeighbors(const std::vector<std::vector<int>>& field, int x, int y) {
+// Новое состояние клетки по её состоянию и числу живых соседей
+inline int lifeRule(int alive, int neighbors) {
+    return (neighbors == 3 || (alive == 1 && neighbors == 2)) ? 1 : 0;
+}
+
+// Подсчёт живых соседей клетки j строки mid; up и down - соседние строки
+// (за краем поля - строка из нулей), за краями строки клеток нет
+inline int countNeighbors(const int* up, const int* mid, const int* down, int j, int width) {
     int live = 0;
-    for (int dx = -1; dx <= 1; ++dx) {
-        for (int dy = -1; dy <= 1; ++dy) {
-            if (dx == 0 && dy == 0) continue;
-            int nx = x + dx;
-            int ny = y + dy;
-            if (nx >= 0 && nx < HEIGHT && ny >= 0 && ny < WIDTH) {
-                live += field[nx][ny];
-            }
-        }
+    for (int dj = -1; dj <= 1; ++dj) {
+        int col = j + dj;
+        if (col < 0 || col >= width) continue;
+        live += up[col] + down[col] + (dj != 0 ? mid[col] : 0);
     }
     return live;
 }
 
-// Обновление игрового поля (параллельное)
+// Обновление одной строки поля в вариантах для разных наборов команд
+// (см. common/dispatch.h). Векторные варианты считают внутренние клетки сразу по
+// 4, 8 или 16, крайние клетки строки - скалярно
+using LifeRowFn = void (*)(const int* up, const int* mid, const int* down, int* out, int width);
+
+void lifeRowScalar(const int* up, const int* mid, const int* down, int* out, int width) {
+    for (int j = 0; j < width; ++j) {
+        out[j] = lifeRule(mid[j], countNeighbors(up, mid, down, j, width));
+    }
+}
+
+// Число живых соседей клеток j..j+3: сумма восьми сдвинутых загрузок
+SIMD_TARGET_SSE42 inline __m128i lifeNeighborsSse42(const int* up, const int* mid, const int* down, int j) {
+    __m128i sum = _mm_setzero_si128();
+    for (int dj = -1; dj <= 1; ++dj) {
+        sum = _mm_add_epi32(sum, _mm_loadu_si128(reinterpret_cast<const __m128i*>(up + j + dj)));
+        sum = _mm_add_epi32(sum, _mm_loadu_si128(reinterpret_cast<const __m128i*>(down + j + dj)));
+        if (dj != 0) sum = _mm_add_epi32(sum, _mm_loadu_si128(reinterpret_cast<const __m128i*>(mid + j + dj)));
+    }
+    return sum;
+}
+
+SIMD_TARGET_SSE42 void lifeRowSse42(const int* up, const int* mid, const int* down, int* out, int width) {
+    const __m128i one = _mm_set1_epi32(1), two = _mm_set1_epi32(2), three = _mm_set1_epi32(3);
+    int j = 0;
+    if (width > 0) {
+        out[0] = lifeRule(mid[0], countNeighbors(up, mid, down, 0, width));
+        j = 1;
+    }
+    for (; j + 4 < width; j += 4) {
+        __m128i sum = lifeNeighborsSse42(up, mid, down, j);
+        __m128i alive = _mm_cmpeq_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(mid + j)), one);
+        __m128i next = _mm_or_si128(_mm_cmpeq_epi32(sum, three), _mm_and_si128(_mm_cmpeq_epi32(sum, two), alive));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + j), _mm_and_si128(next, one));
+    }
+    for (; j < width; ++j) {
+        out[j] = lifeRule(mid[j], countNeighbors(up, mid, down, j, width));
+    }
+}
+
+SIMD_TARGET_AVX2 inline __m256i lifeNeighborsAvx2(const int* up, const int* mid, const int* down, int j) {
+    __m256i sum = _mm256_setzero_si256();
+    for (int dj = -1; dj <= 1; ++dj) {
+        sum = _mm256_add_epi32(sum, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(up + j + dj)));
+        sum = _mm256_add_epi32(sum, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(down + j + dj)));
+        if (dj != 0) sum = _mm256_add_epi32(sum, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(mid + j + dj)));
+    }
+    return sum;
+}
+
+SIMD_TARGET_AVX2 void lifeRowAvx2(const int* up, const int* mid, const int* down, int* out, int width) {
+    const __m256i one = _mm256_set1_epi32(1), two = _mm256_set1_epi32(2), three = _mm256_set1_epi32(3);
+    int j = 0;
+    if (width > 0) {
+        out[0] = lifeRule(mid[0], countNeighbors(up, mid, down, 0, width));
+        j = 1;
+    }
+    for (; j + 8 < width; j += 8) {
+        __m256i sum = lifeNeighborsAvx2(up, mid, down, j);
+        __m256i alive = _mm256_cmpeq_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(mid + j)), one);
+        __m256i next = _mm256_or_si256(_mm256_cmpeq_epi32(sum, three), _mm256_and_si256(_mm256_cmpeq_epi32(sum, two), alive));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + j), _mm256_and_si256(next, one));
+    }
+    for (; j < width; ++j) {
+        out[j] = lifeRule(mid[j], countNeighbors(up, mid, down, j, width));
+    }
+}
+
+SIMD_TARGET_AVX512 inline __m512i lifeNeighborsAvx512(const int* up, const int* mid, const int* down, int j) {
+    __m512i sum = _mm512_setzero_si512();
+    for (int dj = -1; dj <= 1; ++dj) {
+        sum = _mm512_add_epi32(sum, _mm512_loadu_si512(up + j + dj));
+        sum = _mm512_add_epi32(sum, _mm512_loadu_si512(down + j + dj));
+        if (dj != 0) sum = _mm512_add_epi32(sum, _mm512_loadu_si512(mid + j + dj));
+    }
+    return sum;
+}
+
+SIMD_TARGET_AVX512 void lifeRowAvx512(const int* up, const int* mid, const int* down, int* out, int width) {
+    const __m512i one = _mm512_set1_epi32(1), two = _mm512_set1_epi32(2), three = _mm512_set1_epi32(3);
+    int j = 0;
+    if (width > 0) {
+        out[0] = lifeRule(mid[0], countNeighbors(up, mid, down, 0, width));
+        j = 1;
+    }
+    for (; j + 16 < width; j += 16) {
+        __m512i sum = lifeNeighborsAvx512(up, mid, down, j);
+        __mmask16 alive = _mm512_cmpeq_epi32_mask(_mm512_loadu_si512(mid + j), one);
+        __mmask16 next = _mm512_cmpeq_epi32_mask(sum, three) | (_mm512_cmpeq_epi32_mask(sum, two) & alive);
+        _mm512_storeu_si512(out + j, _mm512_maskz_mov_epi32(next, one));
+    }
+    for (; j < width; ++j) {
+        out[j] = lifeRule(mid[j], countNeighbors(up, mid, down, j, width));
+    }
+}
+
+const SimdKernel<LifeRowFn> lifeKernel(lifeRowScalar, lifeRowSse42, lifeRowAvx2, lifeRowAvx512);
+
+// Строка из нулей вместо соседей за верхним и нижним краем поля
+const std::vector<int>& emptyRow() {
+    static const std::vector<int> row(WIDTH, 0);
+    return row;
+}
+
+// Обновление игрового поля (параллельное) вариантом ядра, выбранным при запуске
 void updateField(const std::vector<std::vector<int>>& current, std::vector<std::vector<int>>& next) {
-#pragma omp parallel for collapse(2)
-    for (int i = 0; i < HEIGHT; ++i) {
-        for (int j = 0; j < WIDTH; ++j) {
-            int neighbors = countNeighbors(current, i, j);
-            if (current[i][j] == 1) {
-                next[i][j] = (neighbors == 2 || neighbors == 3) ? 1 : 0;
-            }
-            else {
-                next[i][j] = (neighbors == 3) ? 1 : 0;
-            }
+    LifeRowFn kernel = lifeKernel.get();
+    const int* empty = emptyRow().data();
+#pragma omp parallel
+    {
+        // Счётчики каждого потока - только за его строки (nowait)
+        PerfRegion region("updateField");
+#pragma omp for nowait
+        for (int i = 0; i < HEIGHT; ++i) {
+            const int* up = i > 0 ? current[i - 1].data() : empty;
+            const int* down = i + 1 < HEIGHT ? current[i + 1].data() : empty;
+            kernel(up, current[i].data(), down, next[i].data(), WIDTH);
         }
     }
 }
@@ -63,10 +171,14 @@ void updateField(const std::vector<std::vector<int>>& current, std::vector<std::
 // Подсчёт живых клеток
 int countLiveCells(const std::vector<std::vector<int>>& field) {
     int total = 0;
-#pragma omp parallel for reduction(+:total)
-    for (int i = 0; i < HEIGHT; ++i)
-        for (int j = 0; j < WIDTH; ++j)
-            total += field[i][j];
+#pragma omp parallel reduction(+:total)
+    {
+        PerfRegion region("countLiveCells");
+#pragma omp for nowait
+        for (int i = 0; i < HEIGHT; ++i)
+            for (int j = 0; j < WIDTH; ++j)
+                total += field[i][j];
+    }
     return total;
 }
 
@@ -89,11 +201,38 @@ void initializeGlider(std::vector<std::vector<int>>& field) {
     field[x + 2][y + 2] = 1;
 }
 
+// Поле после generations поколений из случайного начального при заданном варианте ядра
+std::vector<std::vector<int>> simulateWith(LifeRowFn kernel, unsigned seed, int generations) {
+    std::vector<std::vector<int>> field(HEIGHT, std::vector<int>(WIDTH));
+    std::vector<std::vector<int>> next(HEIGHT, std::vector<int>(WIDTH));
+    srand(seed);
+    for (auto& row : field)
+        for (int& cell : row)
+            cell = rand() % 2;
+
+    const int* empty = emptyRow().data();
+    for (int generation = 0; generation < generations; ++generation) {
+        for (int i = 0; i < HEIGHT; ++i) {
+            kernel(i > 0 ? field[i - 1].data() : empty, field[i].data(),
+                i + 1 < HEIGHT ? field[i + 1].data() : empty, next[i].data(), WIDTH);
+        }
+        field.swap(next);
+    }
+    return field;
+}
+
 int main() {
     setupConsole();
-    srand(static_cast<unsigned>(time(nullptr)));
+    unsigned seed = static_cast<unsigned>(time(nullptr));
     omp_set_num_threads(4);
 
+    // Все варианты ядра, доступные процессору, должны дать то же поле, что скалярный
+    std::cout << "Вариант векторного ядра: " << simdLevelName(lifeKernel.level())
+        << " (процессор: " << simdLevelName(simdDetect()) << ", выбор - переменная SIMD_LEVEL)\n";
+    std::cout << "Проверка вариантов против скалярного за " << ITERATIONS << " поколений: ";
+    simdCrossCheck(std::cout, "life", lifeKernel, [&](LifeRowFn kernel) { return simulateWith(kernel, seed, ITERATIONS); });
+    srand(seed);
+
     std::vector<std::vector<int>> field(HEIGHT, std::vector<int>(WIDTH));
     std::vector<std::vector<int>> nextField(HEIGHT, std::vector<int>(WIDTH));
 
@@ -2,14 +2,41 @@
 #include <mpi.h>
 #include <vector>
 #include <ctime>
-#include <chrono>
+#include <string>
+#include <climits>
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+#include <iomanip>
+#include <omp.h>
+#include "../common/bench.h"
+#include "../common/repro_sum.h"
 
 using namespace std;
 
+// Режим размещения данных
+enum class DataMode {
+    Replicated,  // каждый процесс хранит весь массив (исходный вариант)
+    Generated,   // каждый процесс генерирует только свой блок
+    File         // каждый процесс читает только свой блок из общего файла
+};
+
+// Максимальный размер одной операции MPI-IO (count имеет тип int)
+const long long io_chunk = INT_MAX / sizeof(int);
+
+// Функция для вычисления границ блока [start, end) процесса rank
+void block_range(long long n, int rank, int size, long long& start, long long& end) {
+    long long local_n = n / size;
+    long long remainder = n % size;
+
+    start = rank * local_n + (rank < remainder ? rank : remainder);
+    end = start + local_n + (rank < remainder ? 1 : 0);
+}
+
 // Функция для последовательного суммирования элементов массива
 long long sequential_sum(const vector<int>& arr) {
     long long sum = 0;
-    for (int i = 0; i < arr.size(); ++i) {
+    for (size_t i = 0; i < arr.size(); ++i) {
         sum += arr[i];
     }
     return sum;
@@ -17,14 +44,11 @@ long long sequential_sum(const vector<int>& arr) {
 
 // Функция для параллельного суммирования с использованием MPI
 long long parallel_sum(const vector<int>& arr, int rank, int size) {
-    int local_n = arr.size() / size;
-    int remainder = arr.size() % size;
-    long long local_sum = 0;
-
-    int start = rank * local_n + (rank < remainder ? rank : remainder);
-    int end = start + local_n + (rank < remainder ? 1 : 0);
+    long long start, end;
+    block_range(arr.size(), rank, size, start, end);
 
-    for (int i = start; i < end; ++i) {
+    long long local_sum = 0;
+    for (long long i = start; i < end; ++i) {
         local_sum += arr[i];
     }
 
@@ -34,44 +58,550 @@ long long parallel_sum(const vector<int>& arr, int rank, int size) {
     return global_sum;
 }
 
+// Функция для параллельного суммирования, когда процесс хранит только свой блок
+long long distributed_sum(const vector<int>& local_block) {
+    long long local_sum = sequential_sum(local_block);
+
+    long long global_sum = 0;
+    MPI_Reduce(&local_sum, &global_sum, 1, MPI_LONG_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
+
+    return global_sum;
+}
+
+// Гибридное суммирование: OpenMP-потоки с SIMD-аккумуляторами внутри процесса
+// и конвейер по блокам, в котором MPI_Iallreduce частичной суммы блока c
+// выполняется, пока потоки считают блок c + 1.
+// Все процессы коммуникатора должны передавать одинаковое число блоков.
+long long hybrid_sum(const vector<int>& local_block, int chunks, MPI_Comm comm, double* wait_time = nullptr) {
+    vector<long long> partial(chunks, 0);
+    vector<long long> reduced(chunks, 0);
+    vector<MPI_Request> requests(chunks, MPI_REQUEST_NULL);
+
+    const int* data = local_block.data();
+    long long n = local_block.size();
+
+    for (int c = 0; c < chunks; ++c) {
+        long long begin = n * c / chunks;
+        long long end = n * (c + 1) / chunks;
+        long long chunk_sum = 0;
+
+#pragma omp parallel for simd schedule(static) reduction(+:chunk_sum)
+        for (long long i = begin; i < end; ++i) {
+            chunk_sum += data[i];
+        }
+
+        partial[c] = chunk_sum;
+        MPI_Iallreduce(&partial[c], &reduced[c], 1, MPI_LONG_LONG, MPI_SUM, comm, &requests[c]);
+
+        // Продвигаем уже запущенные обмены между блоками вычислений
+        int done = 0;
+        MPI_Testall(c + 1, requests.data(), &done, MPI_STATUSES_IGNORE);
+    }
+
+    double wait_start = MPI_Wtime();
+    MPI_Waitall(chunks, requests.data(), MPI_STATUSES_IGNORE);
+    if (wait_time) {
+        *wait_time = MPI_Wtime() - wait_start;
+    }
+
+    long long global_sum = 0;
+    for (long long value : reduced) {
+        global_sum += value;
+    }
+    return global_sum;
+}
+
+// Элемент i вещественного массива: знакопеременные значения с порядками от 2^-40
+// до 2^20, так что сумма сильно зависит от порядка сложения. Считается целыми
+// операциями и одинаков на любом процессе
+double real_element(long long i) {
+    long long mantissa = i * 2654435761LL % 2000003 - 1000001;
+    return ldexp(static_cast<double>(mantissa), static_cast<int>(i % 41) - 40);
+}
+
+vector<double> generate_real_block(long long n, int rank, int size) {
+    long long start, end;
+    block_range(n, rank, size, start, end);
+    vector<double> block(end - start);
+    for (long long i = start; i < end; ++i) {
+        block[i - start] = real_element(i);
+    }
+    return block;
+}
+
+// Обычная редукция double: результат зависит от числа потоков и процессов
+double real_sum(const vector<double>& local_block) {
+    double local_sum = 0.0;
+    long long n = local_block.size();
+
+#pragma omp parallel for reduction(+:local_sum)
+    for (long long i = 0; i < n; ++i) {
+        local_sum += local_block[i];
+    }
+
+    double global_sum = 0.0;
+    MPI_Reduce(&local_sum, &global_sum, 1, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
+    return global_sum;
+}
+
+// Объединение суперсумматоров для MPI_Reduce. Буферы копируются, так как MPI не
+// обязан выравнивать их под int64
+void merge_reproducible_sums(void* in, void* inout, int* len, MPI_Datatype*) {
+    for (int k = 0; k < *len; ++k) {
+        ReproducibleSum a, b;
+        memcpy(&a, static_cast<char*>(in) + k * sizeof(ReproducibleSum), sizeof(ReproducibleSum));
+        memcpy(&b, static_cast<char*>(inout) + k * sizeof(ReproducibleSum), sizeof(ReproducibleSum));
+        b.merge(a);
+        memcpy(static_cast<char*>(inout) + k * sizeof(ReproducibleSum), &b, sizeof(ReproducibleSum));
+    }
+}
+
+// Воспроизводимая редукция double: потоки копят суммы в корзинах (BinnedSum),
+// затем все выравниваются на общее окно наибольшего модуля, точно переносятся в
+// суперсумматоры и объединяются без округлений. Результат побитово одинаков при
+// любом числе потоков и процессов
+double reproducible_real_sum(const vector<double>& local_block) {
+    static MPI_Datatype sum_type = [] {
+        MPI_Datatype type;
+        MPI_Type_contiguous(static_cast<int>(sizeof(ReproducibleSum)), MPI_BYTE, &type);
+        MPI_Type_commit(&type);
+        return type;
+    }();
+    static MPI_Op sum_op = [] {
+        MPI_Op op;
+        MPI_Op_create(merge_reproducible_sums, 1, &op);
+        return op;
+    }();
+
+    vector<BinnedSum> thread_sums(omp_get_max_threads());
+    long long n = local_block.size();
+
+#pragma omp parallel
+    {
+        // Копится в локальной переменной: соседние элементы вектора делили бы строку кэша
+        BinnedSum thread_sum;
+        long long start, end;
+        block_range(n, omp_get_thread_num(), omp_get_num_threads(), start, end);
+        thread_sum.add(local_block.data() + start, end - start);
+        thread_sums[omp_get_thread_num()] = thread_sum;
+    }
+
+    int window = 0;
+    for (const BinnedSum& s : thread_sums) window = max(window, s.index());
+    MPI_Allreduce(MPI_IN_PLACE, &window, 1, MPI_INT, MPI_MAX, MPI_COMM_WORLD);
+
+    ReproducibleSum local_sum;
+    for (BinnedSum& s : thread_sums) {
+        s.alignTo(window);
+        s.addTo(local_sum);
+    }
+
+    ReproducibleSum global_sum;
+    MPI_Reduce(&local_sum, &global_sum, 1, sum_type, sum_op, 0, MPI_COMM_WORLD);
+    return global_sum.value();
+}
+
+// Генерация собственного блока на месте (массив из единиц)
+vector<int> generate_local_block(long long n, int rank, int size) {
+    long long start, end;
+    block_range(n, rank, size, start, end);
+    return vector<int>(end - start, 1);
+}
+
+// Число коллективных вызовов, достаточное для самого большого блока
+int io_rounds(long long n, int size) {
+    long long max_block = n / size + (n % size ? 1 : 0);
+    return static_cast<int>((max_block + io_chunk - 1) / io_chunk);
+}
+
+// Коллективное чтение собственного блока из общего бинарного файла
+vector<int> read_local_block(const string& path, long long& n, int rank, int size) {
+    MPI_File fh;
+    if (MPI_File_open(MPI_COMM_WORLD, path.c_str(), MPI_MODE_RDONLY, MPI_INFO_NULL, &fh) != MPI_SUCCESS) {
+        if (rank == 0) {
+            cerr << "Error: cannot open " << path << endl;
+        }
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    MPI_Offset file_size = 0;
+    MPI_File_get_size(fh, &file_size);
+    n = file_size / static_cast<MPI_Offset>(sizeof(int));
+
+    long long start, end;
+    block_range(n, rank, size, start, end);
+    vector<int> block(end - start);
+
+    // Все процессы делают одинаковое число вызовов, даже если их часть уже прочитана
+    int rounds = io_rounds(n, size);
+    for (int r = 0; r < rounds; ++r) {
+        long long offset = min(static_cast<long long>(r) * io_chunk, end - start);
+        int count = static_cast<int>(min(io_chunk, end - start - offset));
+        MPI_File_read_at_all(fh, static_cast<MPI_Offset>((start + offset) * sizeof(int)),
+            block.data() + offset, count, MPI_INT, MPI_STATUS_IGNORE);
+    }
+
+    MPI_File_close(&fh);
+    return block;
+}
+
+// Коллективная запись общего бинарного файла: каждый процесс пишет свой блок
+void write_shared_file(const string& path, long long n, int rank, int size) {
+    MPI_File fh;
+    if (MPI_File_open(MPI_COMM_WORLD, path.c_str(), MPI_MODE_CREATE | MPI_MODE_WRONLY,
+        MPI_INFO_NULL, &fh) != MPI_SUCCESS) {
+        if (rank == 0) {
+            cerr << "Error: cannot create " << path << endl;
+        }
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    MPI_File_set_size(fh, static_cast<MPI_Offset>(n * sizeof(int)));
+
+    long long start, end;
+    block_range(n, rank, size, start, end);
+    vector<int> block = generate_local_block(n, rank, size);
+
+    int rounds = io_rounds(n, size);
+    for (int r = 0; r < rounds; ++r) {
+        long long offset = min(static_cast<long long>(r) * io_chunk, end - start);
+        int count = static_cast<int>(min(io_chunk, end - start - offset));
+        MPI_File_write_at_all(fh, static_cast<MPI_Offset>((start + offset) * sizeof(int)),
+            block.data() + offset, count, MPI_INT, MPI_STATUS_IGNORE);
+    }
+
+    MPI_File_close(&fh);
+}
+
+// Последовательность 1, 2, 4, ... до limit включительно
+vector<int> doubling_steps(int limit) {
+    vector<int> steps;
+    for (int v = 1; v < limit; v *= 2) {
+        steps.push_back(v);
+    }
+    steps.push_back(limit);
+    return steps;
+}
+
+// Время гибридного суммирования n элементов на ranks процессах по threads потоков
+// (лучшее из trials запусков). Возвращает результат только на world rank 0.
+double time_hybrid(long long n, int ranks, int threads, int chunks, int trials, bool& correct) {
+    int world_rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &world_rank);
+
+    MPI_Comm comm;
+    MPI_Comm_split(MPI_COMM_WORLD, world_rank < ranks ? 0 : MPI_UNDEFINED, world_rank, &comm);
+
+    double best = 0.0;
+    correct = true;
+    if (comm != MPI_COMM_NULL) {
+        omp_set_num_threads(threads);
+        vector<int> block = generate_local_block(n, world_rank, ranks);
+
+        for (int t = 0; t < trials; ++t) {
+            MPI_Barrier(comm);
+            double start = MPI_Wtime();
+            long long result = hybrid_sum(block, chunks, comm);
+            double local_time = MPI_Wtime() - start;
+
+            double time = 0.0;
+            MPI_Allreduce(&local_time, &time, 1, MPI_DOUBLE, MPI_MAX, comm);
+            if (t == 0 || time < best) {
+                best = time;
+            }
+            correct = correct && result == n;
+        }
+        MPI_Comm_free(&comm);
+    }
+
+    MPI_Barrier(MPI_COMM_WORLD);
+    return best;
+}
+
+// Таблица сильной и слабой масштабируемости по сетке процессы x потоки.
+// Локальная проверка: mpirun -n 4 ./8 --scaling
+// На кластере: один процесс на сокет, например
+//   OMP_PLACES=cores OMP_PROC_BIND=close mpirun --map-by socket --bind-to socket ./8 --scaling
+void scaling_report(long long n, int chunks, int rank, int size) {
+    const int trials = 3;
+    int max_threads = omp_get_max_threads();
+    vector<int> rank_steps = doubling_steps(size);
+    vector<int> thread_steps = doubling_steps(max_threads);
+
+    // Для слабой масштабируемости объём работы на один поток постоянен
+    long long unit_n = max(1LL, n / (static_cast<long long>(size) * max_threads));
+
+    for (int weak = 0; weak < 2; ++weak) {
+        bool correct = true;
+        double base = 0.0; // время конфигурации 1 x 1 (первая строка таблицы)
+
+        if (rank == 0) {
+            cout << "\n" << (weak ? "Weak scaling (" + to_string(unit_n) + " elements per thread)"
+                : "Strong scaling (" + to_string(n) + " elements)") << endl;
+            cout << "ranks  threads   time, s      speedup  efficiency  check" << endl;
+        }
+
+        for (int ranks : rank_steps) {
+            for (int threads : thread_steps) {
+                int workers = ranks * threads;
+                long long total = weak ? unit_n * workers : n;
+                double time = time_hybrid(total, ranks, threads, chunks, trials, correct);
+                if (workers == 1) {
+                    base = time;
+                }
+
+                if (rank == 0) {
+                    // При слабой масштабируемости идеальное время постоянно
+                    double speedup = weak ? base / time * workers : base / time;
+                    double efficiency = speedup / workers * 100;
+                    cout << setw(5) << ranks << "  " << setw(7) << threads << "  "
+                        << fixed << setprecision(6) << setw(10) << time << "  "
+                        << setprecision(2) << setw(9) << speedup << "x  "
+                        << setprecision(1) << setw(9) << efficiency << "%  "
+                        << (correct ? "OK" : "MISMATCH") << defaultfloat << endl;
+                }
+            }
+        }
+    }
+    omp_set_num_threads(max_threads);
+}
+
 int main(int argc, char* argv[]) {
-    MPI_Init(&argc, &argv);
+    // OpenMP-потоки не вызывают MPI, поэтому достаточно FUNNELED
+    int provided;
+    MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &provided);
 
     int rank, size;
     MPI_Comm_rank(MPI_COMM_WORLD, &rank);
     MPI_Comm_size(MPI_COMM_WORLD, &size);
 
+    // Разбор аргументов:
+    //   --distributed       каждый процесс генерирует только свой блок
+    //   --file <path>       каждый процесс читает свой блок из общего файла
+    //   --write-file <path> создать общий файл из единиц и выйти
+    //   --size <n>          число элементов
+    //   --hybrid            MPI + OpenMP + SIMD с конвейером MPI_Iallreduce
+    //   --chunks <k>        число блоков конвейера гибридного режима
+    //   --scaling           таблица масштабируемости процессы x потоки
+    //   --real              сумма вещественного массива: обычная и воспроизводимая редукция
+    //   --bench ...         отчёт стенда замеров (см. common/bench.h)
+    DataMode mode = DataMode::Replicated;
+    string path, write_path;
+    long long array_size = 100000000; // Уменьшил размер для демонстрации
+    bool hybrid = false;
+    bool scaling = false;
+    bool real = false;
+    int chunks = 16;
+    BenchOptions options;
+
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "--distributed") {
+            mode = DataMode::Generated;
+        }
+        else if (arg == "--file" && i + 1 < argc) {
+            mode = DataMode::File;
+            path = argv[++i];
+        }
+        else if (arg == "--write-file" && i + 1 < argc) {
+            write_path = argv[++i];
+        }
+        else if (arg == "--size" && i + 1 < argc) {
+            array_size = stoll(argv[++i]);
+        }
+        else if (arg == "--hybrid") {
+            hybrid = true;
+        }
+        else if (arg == "--chunks" && i + 1 < argc) {
+            chunks = max(1, stoi(argv[++i]));
+        }
+        else if (arg == "--scaling") {
+            scaling = true;
+        }
+        else if (arg == "--real") {
+            real = true;
+        }
+        else {
+            options.parse(i, argc, argv);
+        }
+    }
+
+    // Замер - максимум времени по процессам, все процессы стартуют после барьера
+    options.print = rank == 0;
+    options.sync = [] { MPI_Barrier(MPI_COMM_WORLD); };
+    options.combine = [](double seconds) {
+        double slowest = 0.0;
+        MPI_Allreduce(&seconds, &slowest, 1, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+        return slowest;
+    };
+
+    if (scaling) {
+        if (rank == 0) {
+            cout << "Hybrid scaling: " << size << " rank(s), up to "
+                << omp_get_max_threads() << " thread(s) per rank, " << chunks << " chunks" << endl;
+        }
+        scaling_report(array_size, chunks, rank, size);
+        MPI_Finalize();
+        return 0;
+    }
+
+    if (real) {
+        // Каждый процесс генерирует свой блок; сравниваются обычная и воспроизводимая
+        // редукции одного и того же массива
+        vector<double> local_block = generate_real_block(array_size, rank, size);
+
+        double plain_result = 0.0;
+        double reproducible_result = 0.0;
+        BenchSuite suite("8");
+        suite.add("sum/real_mpi_reduce", [&] { plain_result = real_sum(local_block); DoNotOptimize(plain_result); })
+            .items(static_cast<double>(array_size), "elem");
+        suite.add("sum/real_reproducible", [&] {
+            reproducible_result = reproducible_real_sum(local_block);
+            DoNotOptimize(reproducible_result);
+        }).items(static_cast<double>(array_size), "elem");
+
+        vector<BenchResult> results = suite.run(options);
+        if (options.report) {
+            suite.report(results, options);
+            MPI_Finalize();
+            return 0;
+        }
+        double plain_time = BenchSuite::median(results, "sum/real_mpi_reduce");
+        double reproducible_time = BenchSuite::median(results, "sum/real_reproducible");
+
+        if (rank == 0) {
+            cout << "Real sum: " << size << " rank(s), " << omp_get_max_threads() << " thread(s) per rank, "
+                << array_size << " elements" << endl;
+            cout << setprecision(17);
+            cout << "MPI_Reduce sum:   " << plain_result << " (" << hexfloat << plain_result << defaultfloat
+                << "), depends on ranks and threads" << endl;
+            cout << "Reproducible sum: " << reproducible_result << " (" << hexfloat << reproducible_result
+                << defaultfloat << "), binned sum rounded once" << endl;
+            cout << setprecision(6);
+            cout << "MPI_Reduce time: " << plain_time << " seconds, reproducible time: " << reproducible_time
+                << " seconds (median of " << options.trials << " trials)." << endl;
+            cout << "Reproducibility overhead: " << reproducible_time / plain_time << "x" << endl;
+        }
+
+        MPI_Finalize();
+        return 0;
+    }
+
+    // Гибридный режим работает только с распределёнными данными
+    if (hybrid && mode == DataMode::Replicated) {
+        mode = DataMode::Generated;
+    }
+
+    if (!write_path.empty()) {
+        double write_start = MPI_Wtime();
+        write_shared_file(write_path, array_size, rank, size);
+        double write_time = MPI_Wtime() - write_start;
+        if (rank == 0) {
+            cout << "Written " << array_size << " elements to " << write_path
+                << " in " << write_time << " seconds." << endl;
+        }
+        MPI_Finalize();
+        return 0;
+    }
+
+    if (mode != DataMode::Replicated) {
+        // Каждый процесс материализует только свой блок
+        MPI_Barrier(MPI_COMM_WORLD);
+        double load_start = MPI_Wtime();
+        vector<int> local_block = (mode == DataMode::File)
+            ? read_local_block(path, array_size, rank, size)
+            : generate_local_block(array_size, rank, size);
+        double load_time = MPI_Wtime() - load_start;
+
+        long long local_elements = local_block.size();
+        long long max_elements = 0;
+        MPI_Reduce(&local_elements, &max_elements, 1, MPI_LONG_LONG, MPI_MAX, 0, MPI_COMM_WORLD);
+
+        // В режиме отчёта измеряются оба варианта, иначе только выбранный
+        double wait_time = 0.0;
+        long long par_result = 0;
+        BenchSuite suite("8");
+        if (!hybrid || options.report) {
+            suite.add("sum/mpi_distributed", [&] { par_result = distributed_sum(local_block); DoNotOptimize(par_result); })
+                .items(static_cast<double>(array_size), "elem");
+        }
+        if (hybrid || options.report) {
+            suite.add("sum/hybrid_pipelined", [&] {
+                par_result = hybrid_sum(local_block, chunks, MPI_COMM_WORLD, &wait_time);
+                DoNotOptimize(par_result);
+            }).items(static_cast<double>(array_size), "elem");
+        }
+
+        vector<BenchResult> results = suite.run(options);
+        if (options.report) {
+            suite.report(results, options);
+            MPI_Finalize();
+            return 0;
+        }
+        double par_time = results.front().median;
+
+        // Время ожидания незавершённых обменов после локальной работы
+        double max_wait = 0.0;
+        MPI_Reduce(&wait_time, &max_wait, 1, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+
+        if (rank == 0) {
+            cout << "Mode: " << (mode == DataMode::File ? "file (" + path + ")" : string("generated")) << endl;
+            cout << "Total elements: " << array_size << endl;
+            cout << "Max elements per rank: " << max_elements
+                << " (" << max_elements * sizeof(int) / (1024.0 * 1024.0) << " MiB)" << endl;
+            cout << "Block setup time: " << load_time << " seconds." << endl;
+            cout << "Parallel sum: " << par_result << endl;
+            cout << "Parallel execution time: " << par_time << " seconds (median of "
+                << options.trials << " trials)." << endl;
+            if (hybrid) {
+                cout << "Hybrid: " << omp_get_max_threads() << " thread(s) per rank, " << chunks
+                    << " chunks, max exposed wait " << max_wait << " seconds." << endl;
+            }
+            if (mode == DataMode::Generated) {
+                cout << "Check: " << (par_result == array_size ? "OK" : "MISMATCH") << endl;
+            }
+        }
+
+        MPI_Finalize();
+        return 0;
+    }
+
     // Инициализация массива
-    const int array_size = 100000000; // Уменьшил размер для демонстрации
     vector<int> arr(array_size, 1); // Массив из единиц
 
-    // Измеряем только время параллельного выполнения
-    double seq_time = 0.0;
-    double par_time = 0.0;
+    // Последовательное суммирование выполняется только на процессе с rank == 0,
+    // остальные ждут его на сведении времени замера
+    long long seq_result = 0;
+    long long par_result = 0;
+    BenchSuite suite("8");
+    suite.add("sum/sequential", [&] {
+        if (rank == 0) {
+            seq_result = sequential_sum(arr);
+            DoNotOptimize(seq_result);
+        }
+    }).items(static_cast<double>(array_size), "elem");
+    suite.add("sum/mpi_replicated", [&] { par_result = parallel_sum(arr, rank, size); DoNotOptimize(par_result); })
+        .items(static_cast<double>(array_size), "elem");
+
+    vector<BenchResult> results = suite.run(options);
+    if (options.report) {
+        suite.report(results, options);
+        MPI_Finalize();
+        return 0;
+    }
+    double seq_time = BenchSuite::median(results, "sum/sequential");
+    double par_time = BenchSuite::median(results, "sum/mpi_replicated");
 
     if (rank == 0) {
-        // Последовательное суммирование (выполняется только на процессе с rank == 0)
-        auto seq_start = chrono::high_resolution_clock::now();
-        long long seq_result = sequential_sum(arr);
-        auto seq_end = chrono::high_resolution_clock::now();
-        seq_time = chrono::duration<double>(seq_end - seq_start).count();
         cout << "Sequential sum: " << seq_result << endl;
-        cout << "Sequential execution time: " << seq_time << " seconds." << endl;
+        cout << "Sequential execution time: " << seq_time << " seconds (median of "
+            << options.trials << " trials)." << endl;
     }
 
-    // Синхронизация перед началом параллельного выполнения
-    MPI_Barrier(MPI_COMM_WORLD);
-
-    // Параллельное суммирование
-    auto par_start = chrono::high_resolution_clock::now();
-    long long par_result = parallel_sum(arr, rank, size);
-    auto par_end = chrono::high_resolution_clock::now();
-    par_time = chrono::duration<double>(par_end - par_start).count();
-
     // Только процесс с rank == 0 выводит результаты
     if (rank == 0) {
         cout << "Parallel sum: " << par_result << endl;
-        cout << "Parallel execution time: " << par_time << " seconds." << endl;
+        cout << "Parallel execution time: " << par_time << " seconds (median of "
+            << options.trials << " trials)." << endl;
 
         // Корректное сравнение времени выполнения
         if (seq_time > 0) {
@@ -4,176 +4,671 @@
 #include <mpi.h>
 #include <cstdlib>
 #include <iomanip>
+#include <string>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <type_traits>
+#include "../common/roofline.h"
+#include "../common/matrix.h"
+#include "../common/gemm.h"
 
-//     
-std::vector<std::vector<double>> generate_random_matrix(int rows, int cols) {
-    std::vector<std::vector<double>> matrix(rows, std::vector<double>(cols));
-    for (int i = 0; i < rows; ++i) {
-        for (int j = 0; j < cols; ++j) {
-            matrix[i][j] = static_cast<double>(rand()) / RAND_MAX * 100.0;
+//    
+const int MATRIX_A = 1;
+const int MATRIX_B = 2;
+
+//   (SplitMix64):     seed, 
+//    ,      
+// ,           
+double random_element(unsigned long long seed, int matrix_id, long long index) {
+    unsigned long long z = seed ^ (static_cast<unsigned long long>(matrix_id) * 0xD1B54A32D192ED03ULL);
+    z += 0x9E3779B97F4A7C15ULL * static_cast<unsigned long long>(index + 1);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    z ^= z >> 31;
+    return static_cast<double>(z >> 11) / 9007199254740992.0 * 100.0;
+}
+
+//     T:      (0..99    int8)
+template <class T>
+T matrix_element(unsigned long long seed, int matrix_id, long long index) {
+    double value = random_element(seed, matrix_id, index);
+    if (std::is_integral<T>::value) value = std::floor(value);
+    return static_cast<T>(value);
+}
+
+//   MPI  
+template <class T> MPI_Datatype mpi_type();
+template <> MPI_Datatype mpi_type<double>() { return MPI_DOUBLE; }
+template <> MPI_Datatype mpi_type<float>() { return MPI_FLOAT; }
+template <> MPI_Datatype mpi_type<int32_t>() { return MPI_INT32_T; }
+template <> MPI_Datatype mpi_type<int16_t>() { return MPI_INT16_T; }
+template <> MPI_Datatype mpi_type<int8_t>() { return MPI_INT8_T; }
+
+//       cols ,  
+//  (r0, c0),    block (    )
+template <class T>
+void generate_block(MatrixView<T> block, unsigned long long seed, int matrix_id, int cols, int r0, int c0) {
+    for (int i = 0; i < block.rows(); ++i) {
+        T* row = block.row(i);
+        for (int j = 0; j < block.cols(); ++j) {
+            row[j] = matrix_element<T>(seed, matrix_id, static_cast<long long>(r0 + i) * cols + c0 + j);
         }
     }
-    return matrix;
 }
 
-//     
-void print_matrix_part(const std::vector<std::vector<double>>& matrix, int max_rows = 10, int max_cols = 10) {
-    int rows = std::min(static_cast<int>(matrix.size()), max_rows);
-    int cols = (matrix.empty()) ? 0 : std::min(static_cast<int>(matrix[0].size()), max_cols);
+//  MPI   : rows   cols    ld.
+//      :  view.data(),   
+template <class T>
+MPI_Datatype view_type(MatrixView<T> view) {
+    MPI_Datatype type;
+    MPI_Type_vector(view.rows(), view.cols(), static_cast<int>(view.ld()),
+        mpi_type<typename std::remove_const<T>::type>(), &type);
+    MPI_Type_commit(&type);
+    return type;
+}
+
+//     ; element(i, j)  
+template <typename Element>
+void print_matrix_part(Element element, int total_rows, int total_cols, int max_rows = 10, int max_cols = 10) {
+    int rows = std::min(total_rows, max_rows);
+    int cols = std::min(total_cols, max_cols);
 
-    std::cout << "Matrix (" << matrix.size() << "x"
-        << (matrix.empty() ? 0 : matrix[0].size()) << "), showing "
+    std::cout << "Matrix (" << total_rows << "x" << total_cols << "), showing "
         << rows << "x" << cols << ":\n";
 
     for (int i = 0; i < rows; ++i) {
         for (int j = 0; j < cols; ++j) {
-            std::cout << std::fixed << std::setprecision(2) << matrix[i][j] << "\t";
+            std::cout << std::fixed << std::setprecision(2) << +element(i, j) << "\t";
         }
         std::cout << "\n";
     }
 }
 
-int main(int argc, char** argv) {
-    MPI_Init(&argc, &argv);
+//       
+struct OverlapStats {
+    double compute = 0.0;  //  
+    double wait = 0.0;     //   
+    double total = 0.0;    //  
+};
 
-    int world_size, world_rank;
-    MPI_Comm_size(MPI_COMM_WORLD, &world_size);
-    MPI_Comm_rank(MPI_COMM_WORLD, &world_rank);
+//       
+void timed_wait(MPI_Request& request, OverlapStats& stats) {
+    double start = MPI_Wtime();
+    MPI_Wait(&request, MPI_STATUS_IGNORE);
+    stats.wait += MPI_Wtime() - start;
+}
 
-    //   (       )
-    int a_rows = 1000, a_cols = 1000;  //  A: a_rows x a_cols
-    int b_rows = a_cols, b_cols = 800;  //  B: b_rows x b_cols (  a_cols == b_rows)
+//        
+void report_overlap(const OverlapStats& stats, MPI_Comm comm) {
+    int rank, size;
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &size);
 
-    //     
-    if (a_cols != b_rows) {
-        if (world_rank == 0) {
-            std::cerr << "Error: The number of columns in matrix A must be equal to the number of rows in matrix B.\n";
+    double local[3] = { stats.compute, stats.wait, stats.total };
+    std::vector<double> all(rank == 0 ? 3 * size : 0);
+    MPI_Gather(local, 3, MPI_DOUBLE, all.data(), 3, MPI_DOUBLE, 0, comm);
+
+    if (rank == 0) {
+        std::cout << "Per-rank overlap (compute / exposed wait / total, seconds):\n";
+        for (int r = 0; r < size; ++r) {
+            double compute = all[3 * r], wait = all[3 * r + 1], total = all[3 * r + 2];
+            std::cout << "  rank " << r << ": " << std::fixed << std::setprecision(4)
+                << compute << " / " << wait << " / " << total
+                << " (compute " << std::setprecision(1) << (total > 0 ? compute / total * 100 : 0.0) << "%)\n";
         }
-        MPI_Finalize();
-        return 1;
     }
+}
 
-    std::vector<std::vector<double>> A, B, C;
-    double start_time, end_time;
+//      SUMMA
+struct ProcessGrid {
+    MPI_Comm grid_comm;  //   rows x cols
+    MPI_Comm row_comm;   //     ( =  )
+    MPI_Comm col_comm;   //     ( =  )
+    int rows, cols;
+    int my_row, my_col;
+};
 
-    //     A  B
-    if (world_rank == 0) {
-        srand(static_cast<unsigned>(time(nullptr)));
+//     ,   
+ProcessGrid create_grid(MPI_Comm comm) {
+    ProcessGrid grid;
+    int size;
+    MPI_Comm_size(comm, &size);
 
-        std::cout << "Generating matrices...\n";
-        start_time = MPI_Wtime();
+    int dims[2] = { 0, 0 };
+    int periods[2] = { 0, 0 };
+    MPI_Dims_create(size, 2, dims);
+    MPI_Cart_create(comm, 2, dims, periods, 0, &grid.grid_comm);
 
-        A = generate_random_matrix(a_rows, a_cols);
-        B = generate_random_matrix(b_rows, b_cols);
-        C.resize(a_rows, std::vector<double>(b_cols, 0.0));
+    int rank, coords[2];
+    MPI_Comm_rank(grid.grid_comm, &rank);
+    MPI_Cart_coords(grid.grid_comm, rank, 2, coords);
 
-        std::cout << "Matrix A:\n";
-        print_matrix_part(A);
-        std::cout << "\nMatrix B:\n";
-        print_matrix_part(B);
-        std::cout << "\n";
-    }
+    grid.rows = dims[0];
+    grid.cols = dims[1];
+    grid.my_row = coords[0];
+    grid.my_col = coords[1];
 
-    //   B  
-    //    B
-    int b_dims[2];
-    if (world_rank == 0) {
-        b_dims[0] = b_rows;
-        b_dims[1] = b_cols;
-    }
-    MPI_Bcast(b_dims, 2, MPI_INT, 0, MPI_COMM_WORLD);
+    int keep_cols[2] = { 0, 1 };
+    int keep_rows[2] = { 1, 0 };
+    MPI_Cart_sub(grid.grid_comm, keep_cols, &grid.row_comm);
+    MPI_Cart_sub(grid.grid_comm, keep_rows, &grid.col_comm);
+    return grid;
+}
 
-    //     B
-    //       B   
-    std::vector<double> B_linear(b_dims[0] * b_dims[1]);
-    if (world_rank == 0) {
-        for (int i = 0; i < b_dims[0]; ++i) {
-            for (int j = 0; j < b_dims[1]; ++j) {
-                B_linear[i * b_dims[1] + j] = B[i][j];
+void free_grid(ProcessGrid& grid) {
+    MPI_Comm_free(&grid.row_comm);
+    MPI_Comm_free(&grid.col_comm);
+    MPI_Comm_free(&grid.grid_comm);
+}
+
+//      part  parts    n
+void block_range(int n, int parts, int part, int& start, int& end) {
+    int base = n / parts;
+    int remainder = n % parts;
+    start = part * base + std::min(part, remainder);
+    end = start + base + (part < remainder ? 1 : 0);
+}
+
+//  ,    index
+int block_owner(int n, int parts, int index) {
+    int base = n / parts;
+    int remainder = n % parts;
+    int split = remainder * (base + 1);
+    return (index < split) ? index / (base + 1) : remainder + (index - split) / base;
+}
+
+//      0 
+//           
+template <class T>
+void gather_blocks(const Matrix<T>& local, Matrix<T>& full, int rows, int cols, const ProcessGrid& grid) {
+    int rank;
+    MPI_Comm_rank(grid.grid_comm, &rank);
+
+    MPI_Datatype send_type = view_type(local.view());
+    MPI_Request send_request;
+    MPI_Isend(local.data(), 1, send_type, 0, 1, grid.grid_comm, &send_request);
+
+    if (rank == 0) {
+        full = Matrix<T>(rows, cols);
+        for (int pr = 0; pr < grid.rows; ++pr) {
+            for (int pc = 0; pc < grid.cols; ++pc) {
+                int coords[2] = { pr, pc };
+                int source;
+                MPI_Cart_rank(grid.grid_comm, coords, &source);
+                int r0, r1, c0, c1;
+                block_range(rows, grid.rows, pr, r0, r1);
+                block_range(cols, grid.cols, pc, c0, c1);
+                MatrixView<T> block = full.block(r0, c0, r1 - r0, c1 - c0);
+                MPI_Datatype type = view_type(block);
+                MPI_Recv(block.data(), 1, type, source, 1, grid.grid_comm, MPI_STATUS_IGNORE);
+                MPI_Type_free(&type);
             }
         }
     }
-    MPI_Bcast(B_linear.data(), b_dims[0] * b_dims[1], MPI_DOUBLE, 0, MPI_COMM_WORLD);
+    MPI_Wait(&send_request, MPI_STATUS_IGNORE);
+    MPI_Type_free(&send_type);
+}
 
-    //    A  
-    int rows_per_process = a_rows / world_size;
-    int remainder = a_rows % world_size;
+//  SUMMA: C = A * B    .
+// A (m x k), B (k x n)  C (m x n)    ,
+//   -    A   
+//    B   ,       C.
+//      :  s+1  ,
+//    s.
+//     O((m*k + k*n + m*n) / P) .
+//  In,    Acc;   - gemmAccumulate
+// (common/gemm.h),    B   .
+template <class In, class Acc>
+void summa_multiply(const Matrix<In>& A_local, const Matrix<In>& B_local,
+    Matrix<Acc>& C_local, int m, int k, int n, int panel, const ProcessGrid& grid,
+    OverlapStats& stats) {
+    int a_r0, a_r1, a_c0, a_c1, b_r0, b_r1, b_c0, b_c1;
+    block_range(m, grid.rows, grid.my_row, a_r0, a_r1);
+    block_range(k, grid.cols, grid.my_col, a_c0, a_c1);
+    block_range(k, grid.rows, grid.my_row, b_r0, b_r1);
+    block_range(n, grid.cols, grid.my_col, b_c0, b_c1);
 
-    // ,     
-    int local_rows = rows_per_process + (world_rank < remainder ? 1 : 0);
-    std::vector<double> A_local(local_rows * a_cols);
+    int local_m = a_r1 - a_r0;
+    int local_n = b_c1 - b_c0;
 
-    //       
-    std::vector<int> counts(world_size);
-    std::vector<int> displs(world_size);
+    //  :  ,    -
+    struct Step { int kk, width, a_owner, a_start, b_owner, b_start; };
+    std::vector<Step> steps;
+    for (int kk = 0; kk < k; ) {
+        //         A,   B
+        Step step;
+        int a_end, b_end;
+        step.kk = kk;
+        step.a_owner = block_owner(k, grid.cols, kk);
+        step.b_owner = block_owner(k, grid.rows, kk);
+        block_range(k, grid.cols, step.a_owner, step.a_start, a_end);
+        block_range(k, grid.rows, step.b_owner, step.b_start, b_end);
+        step.width = std::min({ panel, a_end - kk, b_end - kk });
+        steps.push_back(step);
+        kk += step.width;
+    }
 
-    for (int i = 0; i < world_size; ++i) {
-        counts[i] = (rows_per_process + (i < remainder ? 1 : 0)) * a_cols;
-        displs[i] = (i == 0) ? 0 : displs[i - 1] + counts[i - 1];
+    C_local = Matrix<Acc>(local_m, local_n);
+    Matrix<In> A_panel[2], B_panel[2];
+    Matrix<In> B_packed(panel, local_n, Layout::ColMajor);
+    MPI_Request requests[2][2];
+    MPI_Datatype types[2][2];
+    for (int slot = 0; slot < 2; ++slot) {
+        A_panel[slot] = Matrix<In>(local_m, panel);
+        B_panel[slot] = Matrix<In>(panel, local_n);
     }
 
-    //      
-    std::vector<double> A_linear;
-    if (world_rank == 0) {
-        A_linear.resize(a_rows * a_cols);
-        for (int i = 0; i < a_rows; ++i) {
-            for (int j = 0; j < a_cols; ++j) {
-                A_linear[i * a_cols + j] = A[i][j];
-            }
-        }
+    //  .    A   B   
+    //  ( ),      
+    MatrixView<const In> a_view[2], b_view[2];
+
+    //     s
+    auto post_step = [&](int s) {
+        const Step& step = steps[s];
+        int slot = s % 2;
+        a_view[slot] = grid.my_col == step.a_owner
+            ? A_local.block(0, step.kk - step.a_start, local_m, step.width)
+            : A_panel[slot].block(0, 0, local_m, step.width);
+        b_view[slot] = grid.my_row == step.b_owner
+            ? B_local.rowRange(step.kk - step.b_start, step.kk - step.b_start + step.width)
+            : B_panel[slot].rowRange(0, step.width);
+
+        types[slot][0] = view_type(a_view[slot]);
+        types[slot][1] = view_type(b_view[slot]);
+        MPI_Ibcast(const_cast<In*>(a_view[slot].data()), 1, types[slot][0], step.a_owner,
+            grid.row_comm, &requests[slot][0]);
+        MPI_Ibcast(const_cast<In*>(b_view[slot].data()), 1, types[slot][1], step.b_owner,
+            grid.col_comm, &requests[slot][1]);
+    };
+
+    double pipeline_start = MPI_Wtime();
+    int step_count = static_cast<int>(steps.size());
+    if (step_count > 0) {
+        post_step(0);
     }
 
-    //   A  
-    MPI_Scatterv(A_linear.data(), counts.data(), displs.data(), MPI_DOUBLE,
-        A_local.data(), local_rows * a_cols, MPI_DOUBLE,
-        0, MPI_COMM_WORLD);
+    for (int s = 0; s < step_count; ++s) {
+        int slot = s % 2;
+        int width = steps[s].width;
+
+        if (s + 1 < step_count) {
+            post_step(s + 1);
+        }
+        timed_wait(requests[slot][0], stats);
+        timed_wait(requests[slot][1], stats);
+        MPI_Type_free(&types[slot][0]);
+        MPI_Type_free(&types[slot][1]);
 
-    //      
-    std::vector<double> C_local(local_rows * b_cols, 0.0);
+        //   C += A_panel * B_panel   16 
+        double compute_start = MPI_Wtime();
+        MatrixView<In> b_packed = B_packed.rowRange(0, width);
+        b_packed.assign(b_view[slot]);
+        for (int i0 = 0; i0 < local_m; i0 += 16) {
+            int i1 = std::min(local_m, i0 + 16);
+            gemmAccumulate<In, Acc>(a_view[slot].rowRange(i0, i1), b_packed, C_local.rowRange(i0, i1));
 
-    for (int i = 0; i < local_rows; ++i) {
-        for (int j = 0; j < b_cols; ++j) {
-            double sum = 0.0;
-            for (int k = 0; k < a_cols; ++k) {
-                sum += A_local[i * a_cols + k] * B_linear[k * b_cols + j];
+            //     
+            if (s + 1 < step_count) {
+                int flag;
+                MPI_Testall(2, requests[1 - slot], &flag, MPI_STATUSES_IGNORE);
             }
-            C_local[i * b_cols + j] = sum;
         }
+        stats.compute += MPI_Wtime() - compute_start;
     }
+    stats.total = MPI_Wtime() - pipeline_start;
+}
 
-    //     
-    //   counts  displs  
-    for (int i = 0; i < world_size; ++i) {
-        counts[i] = (rows_per_process + (i < remainder ? 1 : 0)) * b_cols;
-        displs[i] = (i == 0) ? 0 : displs[i - 1] + counts[i - 1];
+//   :    C
+//        (  ,  
+//   ; . gemmCheckElement)
+template <class In, class Acc>
+GemmCheck check_sample(const Matrix<Acc>& C, unsigned long long seed, int m, int k, int n, int samples = 16) {
+    GemmCheck check;
+    for (int s = 0; s < samples; ++s) {
+        int i = rand() % m;
+        int j = rand() % n;
+        gemmCheckElement<In, Acc>(
+            [&](int p) { return matrix_element<In>(seed, MATRIX_A, static_cast<long long>(i) * k + p); },
+            [&](int p) { return matrix_element<In>(seed, MATRIX_B, static_cast<long long>(p) * n + j); },
+            k, C(i, j), check);
     }
+    return check;
+}
+
+//  
+struct Settings {
+    int a_rows, a_cols, b_rows, b_cols;
+    bool use_summa;
+    int panel;
+    unsigned long long seed;
+    RooflineOptions roofline;
+};
+
+//        In   Acc
+template <class In, class Acc>
+void run_multiply(const Settings& settings) {
+    int world_size, world_rank;
+    MPI_Comm_size(MPI_COMM_WORLD, &world_size);
+    MPI_Comm_rank(MPI_COMM_WORLD, &world_rank);
+
+    int a_rows = settings.a_rows, a_cols = settings.a_cols;
+    int b_rows = settings.b_rows, b_cols = settings.b_cols;
+    bool use_summa = settings.use_summa;
+    int panel = settings.panel;
+    unsigned long long seed = settings.seed;
+    const RooflineOptions& roofline = settings.roofline;
+
+    //      
+    Matrix<Acc> C_full;
+    double start_time = 0.0, end_time = 0.0;
+    OverlapStats stats;
 
     if (world_rank == 0) {
-        //   C      
-        std::vector<double> C_linear(a_rows * b_cols);
-        MPI_Gatherv(C_local.data(), local_rows * b_cols, MPI_DOUBLE,
-            C_linear.data(), counts.data(), displs.data(), MPI_DOUBLE,
-            0, MPI_COMM_WORLD);
-
-        //      
-        for (int i = 0; i < a_rows; ++i) {
-            for (int j = 0; j < b_cols; ++j) {
-                C[i][j] = C_linear[i * b_cols + j];
+        srand(static_cast<unsigned>(seed));
+
+        std::cout << "Generating " << gemmTypeName<In>() << " matrices, " << gemmTypeName<Acc>()
+            << " accumulator, kernel " << gemmKernelName<In, Acc>() << " (seed " << seed << ")...\n";
+        std::cout << "Matrix A:\n";
+        print_matrix_part([&](int i, int j) {
+            return matrix_element<In>(seed, MATRIX_A, static_cast<long long>(i) * a_cols + j);
+            }, a_rows, a_cols);
+        std::cout << "\nMatrix B:\n";
+        print_matrix_part([&](int i, int j) {
+            return matrix_element<In>(seed, MATRIX_B, static_cast<long long>(i) * b_cols + j);
+            }, b_rows, b_cols);
+        std::cout << "\n";
+    }
+
+    //    :      
+    MPI_Barrier(MPI_COMM_WORLD);
+    start_time = MPI_Wtime();
+
+    if (use_summa) {
+        ProcessGrid grid = create_grid(MPI_COMM_WORLD);
+        if (world_rank == 0) {
+            std::cout << "SUMMA on " << grid.rows << "x" << grid.cols << " process grid, panel " << panel << "\n";
+        }
+
+        //  A  B   ,     
+        int r0, r1, c0, c1;
+        block_range(a_rows, grid.rows, grid.my_row, r0, r1);
+        block_range(a_cols, grid.cols, grid.my_col, c0, c1);
+        Matrix<In> A_local(r1 - r0, c1 - c0);
+        generate_block(A_local.view(), seed, MATRIX_A, a_cols, r0, c0);
+
+        block_range(b_rows, grid.rows, grid.my_row, r0, r1);
+        block_range(b_cols, grid.cols, grid.my_col, c0, c1);
+        Matrix<In> B_local(r1 - r0, c1 - c0);
+        generate_block(B_local.view(), seed, MATRIX_B, b_cols, r0, c0);
+
+        Matrix<Acc> C_local;
+        summa_multiply(A_local, B_local, C_local, a_rows, a_cols, b_cols, panel, grid, stats);
+        gather_blocks(C_local, C_full, a_rows, b_cols, grid);
+        end_time = MPI_Wtime();
+
+        report_overlap(stats, grid.grid_comm);
+        free_grid(grid);
+    }
+    else {
+        //    A  
+        int rows_per_process = a_rows / world_size;
+        int remainder = a_rows % world_size;
+
+        // ,     ,     
+        int row_start = world_rank * rows_per_process + std::min(world_rank, remainder);
+        int local_rows = rows_per_process + (world_rank < remainder ? 1 : 0);
+        Matrix<In> A_local(local_rows, a_cols);
+        generate_block(A_local.view(), seed, MATRIX_A, a_cols, row_start, 0);
+
+        if (world_rank == 0) {
+            C_full = Matrix<Acc>(a_rows, b_cols);
+        }
+
+        double pipeline_start = MPI_Wtime();
+
+        //  B  C    panel    :
+        //  B p+1  (MPI_Ibcast),    p,
+        //    C p  (MPI_Igatherv)    .
+        //  B p   p % world_size    ,
+        //      C     C_full.
+        //  -  [0, width) ,      MPI
+        //  .  gemmAccumulate   B 
+        //  
+        int panels = (b_cols + panel - 1) / panel;
+        Matrix<In> B_panel[2];
+        Matrix<Acc> C_panel[2];
+        Matrix<In> B_packed(a_cols, panel, Layout::ColMajor);
+        std::vector<int> c_counts(world_size), c_displs(world_size);
+        MPI_Request bcast_requests[2] = { MPI_REQUEST_NULL, MPI_REQUEST_NULL };
+        MPI_Request gather_requests[2] = { MPI_REQUEST_NULL, MPI_REQUEST_NULL };
+        MPI_Datatype b_types[2] = { MPI_DATATYPE_NULL, MPI_DATATYPE_NULL };
+        MPI_Datatype c_send_types[2] = { MPI_DATATYPE_NULL, MPI_DATATYPE_NULL };
+        MPI_Datatype c_types[2] = { MPI_DATATYPE_NULL, MPI_DATATYPE_NULL };
+
+        for (int slot = 0; slot < 2; ++slot) {
+            B_panel[slot] = Matrix<In>(a_cols, panel);
+            C_panel[slot] = Matrix<Acc>(local_rows, panel);
+        }
+
+        //      C   
+        for (int i = 0; i < world_size; ++i) {
+            c_counts[i] = rows_per_process + (i < remainder ? 1 : 0);
+            c_displs[i] = (i == 0) ? 0 : c_displs[i - 1] + c_counts[i - 1];
+        }
+
+        auto panel_width = [&](int p) { return std::min(panel, b_cols - p * panel); };
+
+        //    B  p
+        auto post_b_panel = [&](int p) {
+            int slot = p % 2;
+            int j0 = p * panel;
+            int width = panel_width(p);
+            int owner = p % world_size;
+            MatrixView<In> target = B_panel[slot].colRange(0, width);
+            if (world_rank == owner) {
+                generate_block(target, seed, MATRIX_B, b_cols, 0, j0);
+            }
+            b_types[slot] = view_type(target);
+            MPI_Ibcast(target.data(), 1, b_types[slot], owner, MPI_COMM_WORLD, &bcast_requests[slot]);
+        };
+
+        //    C  p
+        auto finish_c_panel = [&](int p) {
+            int slot = p % 2;
+            timed_wait(gather_requests[slot], stats);
+            MPI_Type_free(&c_send_types[slot]);
+            if (c_types[slot] != MPI_DATATYPE_NULL) {
+                MPI_Type_free(&c_types[slot]);
             }
+        };
+
+        post_b_panel(0);
+
+        for (int p = 0; p < panels; ++p) {
+            int slot = p % 2;
+            int width = panel_width(p);
+
+            if (p + 1 < panels) {
+                post_b_panel(p + 1);
+            }
+            timed_wait(bcast_requests[slot], stats);
+            MPI_Type_free(&b_types[slot]);
+
+            //   C     p-2
+            if (p >= 2) {
+                finish_c_panel(p - 2);
+            }
+
+            //       
+            double compute_start = MPI_Wtime();
+            MatrixView<Acc> c_panel = C_panel[slot].colRange(0, width);
+            c_panel.fill(Acc());
+            MatrixView<In> b_packed = B_packed.colRange(0, width);
+            b_packed.assign(B_panel[slot].colRange(0, width));
+            for (int i0 = 0; i0 < local_rows; i0 += 16) {
+                int i1 = std::min(local_rows, i0 + 16);
+                gemmAccumulate<In, Acc>(A_local.rowRange(i0, i1), b_packed, c_panel.rowRange(i0, i1));
+
+                //    
+                int flag;
+                MPI_Testall(2, bcast_requests, &flag, MPI_STATUSES_IGNORE);
+            }
+            stats.compute += MPI_Wtime() - compute_start;
+
+            //      :  
+            //   width    ld   C_full
+            Acc* recv_buffer = nullptr;
+            if (world_rank == 0) {
+                MPI_Datatype row_type;
+                MPI_Type_contiguous(width, mpi_type<Acc>(), &row_type);
+                MPI_Type_create_resized(row_type, 0, static_cast<MPI_Aint>(C_full.ld()) * sizeof(Acc), &c_types[slot]);
+                MPI_Type_commit(&c_types[slot]);
+                MPI_Type_free(&row_type);
+                recv_buffer = C_full.row(0) + p * panel;
+            }
+            c_send_types[slot] = view_type(c_panel);
+            MPI_Igatherv(c_panel.data(), 1, c_send_types[slot],
+                recv_buffer, c_counts.data(), c_displs.data(), c_types[slot],
+                0, MPI_COMM_WORLD, &gather_requests[slot]);
         }
 
+        for (int p = std::max(0, panels - 2); p < panels; ++p) {
+            finish_c_panel(p);
+        }
+        stats.total = MPI_Wtime() - pipeline_start;
         end_time = MPI_Wtime();
 
+        if (world_rank == 0) {
+            std::cout << "Row-block multiply, panel " << panel << " columns\n";
+        }
+        report_overlap(stats, MPI_COMM_WORLD);
+    }
+
+    if (world_rank == 0) {
         std::cout << "\nResult matrix C (partial view):\n";
-        print_matrix_part(C);
+        print_matrix_part([&](int i, int j) { return C_full(i, j); }, a_rows, b_cols);
+        GemmCheck check = check_sample<In, Acc>(C_full, seed, a_rows, a_cols, b_cols);
+        std::cout << "\nSample check: " << (check.ok() ? "OK" : "MISMATCH");
+        if (check.overflows > 0) std::cout << " (" << check.overflows << " sums overflow " << gemmTypeName<Acc>() << ")";
+        std::cout << "\n";
 
         std::cout << "\n\nMatrix multiplication completed.\n";
         std::cout << "Time taken: " << end_time - start_time << " seconds\n";
     }
+
+    //       (   
+    //  )  ;   -    
+    if (roofline.enabled) {
+        MPI_Barrier(MPI_COMM_WORLD);
+        RooflineMachine local = rooflineMeasure(1);
+        double peaks[2] = { local.flops, local.bandwidth }, total[2];
+        MPI_Allreduce(peaks, total, 2, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+        double compute = 0.0;
+        MPI_Reduce(&stats.compute, &compute, 1, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+
+        if (world_rank == 0) {
+            RooflineMachine machine;
+            machine.threads = world_size;
+            machine.flops = total[0];
+            machine.bandwidth = total[1];
+
+            //  : A  B , C    
+            double flops = 2.0 * a_rows * a_cols * b_cols;
+            double bytes = sizeof(In) * (static_cast<double>(a_rows) * a_cols + static_cast<double>(b_rows) * b_cols)
+                + sizeof(Acc) * static_cast<double>(a_rows) * b_cols;
+            std::string name = use_summa ? "gemm/summa" : "gemm/row_block";
+            Roofline model("9");
+            model.setMachine(machine);
+            model.add(name + " compute", gemmTypeName<In>(), world_size, flops, bytes, compute);
+            model.add(name + " total", gemmTypeName<In>(), world_size, flops, bytes, end_time - start_time);
+            std::cout << "\n";
+            model.report(std::cout);
+            if (!roofline.csv.empty()) model.appendCsv(roofline.csv);
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+    MPI_Init(&argc, &argv);
+
+    int world_size, world_rank;
+    MPI_Comm_size(MPI_COMM_WORLD, &world_size);
+    MPI_Comm_rank(MPI_COMM_WORLD, &world_rank);
+
+    //   (       )
+    int a_rows = 1000, a_cols = 1000;  //  A: a_rows x a_cols
+    int b_rows = a_cols, b_cols = 800;  //  B: b_rows x b_cols (  a_cols == b_rows)
+
+    // :
+    //   --dims <m> <k> <n>   A (m x k)  B (k x n)
+    //   --summa                SUMMA
+    //   --panel <w>          
+    //   --seed <s>             
+    //   --type <t>           : double ( ), float,
+    //                       int16  int8 (  int32)
+    //   --roofline              roofline (. common/roofline.h)
+    //   --roofline-csv <f>     CSV  
+    bool use_summa = false;
+    int panel = 64;
+    unsigned long long seed = static_cast<unsigned long long>(time(nullptr));
+    std::string type = "double";
+    RooflineOptions roofline;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--dims" && i + 3 < argc) {
+            a_rows = std::stoi(argv[++i]);
+            a_cols = b_rows = std::stoi(argv[++i]);
+            b_cols = std::stoi(argv[++i]);
+        }
+        else if (arg == "--summa") {
+            use_summa = true;
+        }
+        else if (arg == "--panel" && i + 1 < argc) {
+            panel = std::max(1, std::stoi(argv[++i]));
+        }
+        else if (arg == "--seed" && i + 1 < argc) {
+            seed = std::stoull(argv[++i]);
+        }
+        else if (arg == "--type" && i + 1 < argc) {
+            type = argv[++i];
+        }
+        else {
+            roofline.parse(i, argc, argv);
+        }
+    }
+
+    //    seed  
+    MPI_Bcast(&seed, 1, MPI_UNSIGNED_LONG_LONG, 0, MPI_COMM_WORLD);
+
+    //     
+    if (a_cols != b_rows) {
+        if (world_rank == 0) {
+            std::cerr << "Error: The number of columns in matrix A must be equal to the number of rows in matrix B.\n";
+        }
+        MPI_Finalize();
+        return 1;
+    }
+    if (type != "double" && type != "float" && type != "int16" && type != "int8") {
+        if (world_rank == 0) {
+            std::cerr << "Error: unknown element type " << type << " (double, float, int16, int8).\n";
+        }
+        MPI_Finalize();
+        return 1;
+    }
+
+    Settings settings = { a_rows, a_cols, b_rows, b_cols, use_summa, panel, seed, roofline };
+    if (type == "double") {
+        run_multiply<double, double>(settings);
+    }
+    else if (type == "float") {
+        run_multiply<float, float>(settings);
+    }
+    else if (type == "int16") {
+        run_multiply<int16_t, int32_t>(settings);
+    }
     else {
-        MPI_Gatherv(C_local.data(), local_rows * b_cols, MPI_DOUBLE,
-            nullptr, nullptr, nullptr, MPI_DOUBLE,
-            0, MPI_COMM_WORLD);
+        run_multiply<int8_t, int32_t>(settings);
     }
 
     MPI_Finalize();
@@ -0,0 +1,449 @@
+﻿#pragma once
+// Общий стенд для замеров времени: прогрев, повторные запуски, медиана, MAD и
+// доверительный интервал медианы, закрепление потоков, вывод таблицей, JSON или CSV.
+// Каждая программа регистрирует свои ядра под постоянными именами, поэтому
+// результаты разных сборок и машин можно сравнивать построчно.
+//
+// Флаги (разбирает BenchOptions::parse):
+//   --bench                 напечатать таблицу замеров
+//   --bench-trials <n>      число замеров на ядро
+//   --bench-warmup <n>      число прогревочных запусков
+//   --bench-min-time <с>    минимальная длительность замера (короткие ядра повторяются)
+//   --bench-filter <текст>  только ядра, в имени которых есть текст
+//   --bench-pin [cpu]       закрепить главный поток и потоки OpenMP начиная с cpu
+//   --bench-format <text|json|csv>
+//   --bench-output <файл>   записать отчёт в файл вместо stdout
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <ctime>
+#include <cstdlib>
+#include <deque>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#if defined(_WIN32)
+#include <windows.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// Не даёт компилятору выбросить вычисление значения
+#if defined(__GNUC__) || defined(__clang__)
+template <class T>
+inline void DoNotOptimize(const T& value) {
+    asm volatile("" : : "m"(value) : "memory");
+}
+
+// Все записи в память до этой точки считаются наблюдаемыми
+inline void ClobberMemory() {
+    asm volatile("" : : : "memory");
+}
+#else
+inline void benchUseAddress(const volatile char*) {}
+
+template <class T>
+inline void DoNotOptimize(const T& value) {
+    benchUseAddress(&reinterpret_cast<const volatile char&>(value));
+    _ReadWriteBarrier();
+}
+
+inline void ClobberMemory() {
+    _ReadWriteBarrier();
+}
+#endif
+
+// Закрепление текущего потока за логическим процессором
+inline bool pinCurrentThread(int cpu) {
+#if defined(_WIN32)
+    return SetThreadAffinityMask(GetCurrentThread(), DWORD_PTR(1) << cpu) != 0;
+#elif defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+    (void)cpu;
+    return false;
+#endif
+}
+
+struct BenchOptions {
+    int trials = 5;
+    int warmup = 1;
+    double minTime = 0.01;  // секунд на один замер
+    int pinCpu = -1;        // -1 - без закрепления
+    bool report = false;    // печатать отчёт стенда вместо обычного вывода программы
+    bool print = true;      // false на процессах MPI кроме нулевого
+    std::string format = "text";
+    std::string output;
+    std::string filter;
+
+    // Вызывается перед каждым замером (например, MPI_Barrier)
+    std::function<void()> sync;
+    // Сведение длительности замера между процессами (например, максимум по MPI_Allreduce)
+    std::function<double(double)> combine;
+
+    // Разбор одного флага стенда; true, если argv[i] (и его значение) обработан
+    bool parse(int& i, int argc, char** argv) {
+        std::string arg = argv[i];
+        auto value = [&]() -> const char* { return i + 1 < argc ? argv[++i] : nullptr; };
+        auto hasNumber = [&]() { return i + 1 < argc && std::isdigit(static_cast<unsigned char>(argv[i + 1][0])); };
+        const char* v = nullptr;
+
+        if (arg == "--bench") {
+            report = true;
+        }
+        else if (arg == "--bench-trials" && (v = value())) {
+            trials = (std::max)(1, std::atoi(v));
+        }
+        else if (arg == "--bench-warmup" && (v = value())) {
+            warmup = (std::max)(0, std::atoi(v));
+        }
+        else if (arg == "--bench-min-time" && (v = value())) {
+            minTime = std::atof(v);
+        }
+        else if (arg == "--bench-filter" && (v = value())) {
+            filter = v;
+            report = true;
+        }
+        else if (arg == "--bench-pin") {
+            pinCpu = hasNumber() ? std::atoi(argv[++i]) : 0;
+        }
+        else if (arg == "--bench-format" && (v = value())) {
+            format = v;
+            report = true;
+        }
+        else if (arg == "--bench-output" && (v = value())) {
+            output = v;
+            report = true;
+        }
+        else {
+            return false;
+        }
+        return true;
+    }
+};
+
+// Итог замеров одного ядра; все времена - секунды на один запуск ядра
+struct BenchResult {
+    std::string name;
+    std::vector<double> samples;
+    int batch = 1;          // запусков ядра внутри одного замера
+    double median = 0, mad = 0, mean = 0, minimum = 0, maximum = 0;
+    double ciLow = 0, ciHigh = 0;  // 95% доверительный интервал медианы
+    double items = 0;       // объём работы за запуск (для пропускной способности)
+    std::string unit;
+
+    double throughput() const { return items > 0 && median > 0 ? items / median : 0.0; }
+};
+
+inline double benchMedian(std::vector<double> values) {
+    if (values.empty()) return 0.0;
+    std::sort(values.begin(), values.end());
+    size_t n = values.size();
+    return n % 2 ? values[n / 2] : 0.5 * (values[n / 2 - 1] + values[n / 2]);
+}
+
+// Статистики по замерам. Интервал медианы строится по порядковым статистикам
+// (биномиальное приближение), поэтому не требует нормальности распределения
+inline void benchSummarize(BenchResult& r) {
+    std::vector<double> sorted = r.samples;
+    std::sort(sorted.begin(), sorted.end());
+    size_t n = sorted.size();
+    if (n == 0) return;
+
+    r.median = benchMedian(sorted);
+    std::vector<double> deviations;
+    double sum = 0;
+    for (double s : sorted) {
+        deviations.push_back(std::fabs(s - r.median));
+        sum += s;
+    }
+    r.mad = benchMedian(deviations);
+    r.mean = sum / n;
+    r.minimum = sorted.front();
+    r.maximum = sorted.back();
+
+    double half = 1.96 * std::sqrt(static_cast<double>(n)) / 2;
+    long long lo = static_cast<long long>(std::floor(n / 2.0 - half));
+    long long hi = static_cast<long long>(std::ceil(1 + n / 2.0 + half));
+    lo = (std::max)(1LL, (std::min)(lo, static_cast<long long>(n)));
+    hi = (std::max)(1LL, (std::min)(hi, static_cast<long long>(n)));
+    r.ciLow = sorted[lo - 1];
+    r.ciHigh = sorted[hi - 1];
+}
+
+// Время в удобных единицах: 12.3 ms, 450 us
+inline std::string benchFormatTime(double seconds) {
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(3);
+    if (seconds >= 1) out << seconds << " s";
+    else if (seconds >= 1e-3) out << seconds * 1e3 << " ms";
+    else if (seconds >= 1e-6) out << seconds * 1e6 << " us";
+    else out << seconds * 1e9 << " ns";
+    return out.str();
+}
+
+inline std::string benchJsonString(const std::string& text) {
+    std::string out = "\"";
+    for (char c : text) {
+        if (c == '"' || c == '\\') out += '\\';
+        out += c;
+    }
+    return out + "\"";
+}
+
+// Сведения о сборке и машине, которые пишутся рядом с результатами
+inline std::vector<std::pair<std::string, std::string>> benchContext(const std::string& program) {
+    std::vector<std::pair<std::string, std::string>> context;
+    context.push_back({ "program", program });
+#if defined(__clang__)
+    context.push_back({ "compiler", "clang " __clang_version__ });
+#elif defined(__GNUC__)
+    context.push_back({ "compiler", "gcc " __VERSION__ });
+#elif defined(_MSC_VER)
+    context.push_back({ "compiler", "msvc " + std::to_string(_MSC_FULL_VER) });
+#else
+    context.push_back({ "compiler", "unknown" });
+#endif
+    std::string build;
+#if defined(NDEBUG)
+    build += "ndebug ";
+#endif
+#if defined(__OPTIMIZE__)
+    build += "optimized ";
+#endif
+#if defined(__AVX512F__)
+    build += "avx512f ";
+#elif defined(__AVX2__)
+    build += "avx2 ";
+#elif defined(__AVX__)
+    build += "avx ";
+#endif
+#if defined(_OPENMP)
+    build += "openmp ";
+#endif
+    if (!build.empty()) build.pop_back();
+    context.push_back({ "build", build });
+
+    const char* host = std::getenv("COMPUTERNAME");
+    if (!host) host = std::getenv("HOSTNAME");
+    context.push_back({ "host", host ? host : "" });
+    context.push_back({ "cpus", std::to_string(std::thread::hardware_concurrency()) });
+#ifdef _OPENMP
+    context.push_back({ "omp_threads", std::to_string(omp_get_max_threads()) });
+#endif
+
+    std::time_t now = std::time(nullptr);
+    char stamp[32] = "";
+    std::strftime(stamp, sizeof(stamp), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now));
+    context.push_back({ "time", stamp });
+    return context;
+}
+
+// Набор именованных ядер одной программы
+class BenchSuite {
+public:
+    struct Case {
+        std::string name;
+        std::function<void()> run;
+        std::function<void()> setupFn;  // подготовка данных перед каждым запуском, не измеряется
+        double itemCount = 0;
+        std::string itemUnit;
+
+        Case& setup(std::function<void()> fn) { setupFn = std::move(fn); return *this; }
+        Case& items(double count, const std::string& unit) { itemCount = count; itemUnit = unit; return *this; }
+    };
+
+    explicit BenchSuite(std::string program) : program(std::move(program)) {}
+
+    Case& add(const std::string& name, std::function<void()> run) {
+        Case added;
+        added.name = name;
+        added.run = std::move(run);
+        cases.push_back(std::move(added));
+        return cases.back();
+    }
+
+    // Прогоняет все ядра (с учётом фильтра) в порядке регистрации
+    std::vector<BenchResult> run(const BenchOptions& options) {
+        if (options.pinCpu >= 0) {
+            pinThreads(options.pinCpu);
+        }
+
+        std::vector<BenchResult> results;
+        for (Case& c : cases) {
+            if (!options.filter.empty() && c.name.find(options.filter) == std::string::npos) continue;
+            results.push_back(measure(c, options));
+        }
+        return results;
+    }
+
+    // Печать или запись отчёта в выбранном формате
+    void report(const std::vector<BenchResult>& results, const BenchOptions& options) const {
+        if (!options.print) return;
+        std::ofstream file;
+        if (!options.output.empty()) {
+            file.open(options.output);
+            if (!file) {
+                std::cerr << "Cannot write " << options.output << std::endl;
+                return;
+            }
+        }
+        std::ostream& out = options.output.empty() ? std::cout : file;
+
+        if (options.format == "json") writeJson(out, results, options);
+        else if (options.format == "csv") writeCsv(out, results, options);
+        else writeText(out, results, options);
+    }
+
+    // Медиана ядра по имени (0, если ядро не запускалось)
+    static double median(const std::vector<BenchResult>& results, const std::string& name) {
+        for (const BenchResult& r : results) {
+            if (r.name == name) return r.median;
+        }
+        return 0.0;
+    }
+
+private:
+    std::string program;
+    std::deque<Case> cases;
+
+    // Один замер: batch запусков подряд, время на один запуск
+    double timeOnce(Case& c, int batch, const BenchOptions& options) {
+        if (c.setupFn) c.setupFn();
+        if (options.sync) options.sync();
+        ClobberMemory();
+        auto start = std::chrono::steady_clock::now();
+        for (int b = 0; b < batch; ++b) {
+            c.run();
+        }
+        ClobberMemory();
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if (options.combine) seconds = options.combine(seconds);
+        return seconds / batch;
+    }
+
+    BenchResult measure(Case& c, const BenchOptions& options) {
+        BenchResult r;
+        r.name = c.name;
+        r.items = c.itemCount;
+        r.unit = c.itemUnit;
+
+        // Прогрев; по последнему прогревочному запуску подбирается число повторов
+        // коротких ядер. Ядра с подготовкой данных всегда запускаются по одному разу
+        double last = 0;
+        for (int w = 0; w < options.warmup; ++w) {
+            last = timeOnce(c, 1, options);
+        }
+        if (!c.setupFn && last > 0 && last < options.minTime) {
+            r.batch = static_cast<int>((std::min)(1e6, std::ceil(options.minTime / last)));
+        }
+
+        for (int t = 0; t < options.trials; ++t) {
+            r.samples.push_back(timeOnce(c, r.batch, options));
+        }
+        benchSummarize(r);
+        return r;
+    }
+
+    // Главный поток - на cpu, потоки OpenMP - на cpu, cpu + 1, ... по кругу
+    static void pinThreads(int cpu) {
+        int cpus = (std::max)(1u, std::thread::hardware_concurrency());
+        if (!pinCurrentThread(cpu % cpus)) {
+            std::cerr << "Thread pinning is not available" << std::endl;
+            return;
+        }
+#ifdef _OPENMP
+#pragma omp parallel
+        pinCurrentThread((cpu + omp_get_thread_num()) % cpus);
+#endif
+    }
+
+    void writeText(std::ostream& out, const std::vector<BenchResult>& results, const BenchOptions& options) const {
+        size_t width = 4;
+        for (const BenchResult& r : results) width = (std::max)(width, r.name.size());
+
+        out << "Benchmarks: " << program << " (" << options.trials << " trials, "
+            << options.warmup << " warm-up)" << std::endl;
+        out << std::left << std::setw(width) << "name" << std::right
+            << std::setw(13) << "median" << std::setw(9) << "MAD" << std::setw(27) << "95% CI"
+            << std::setw(13) << "min" << "  throughput" << std::endl;
+        for (const BenchResult& r : results) {
+            std::ostringstream mad, ci;
+            mad << std::fixed << std::setprecision(1) << (r.median > 0 ? 100 * r.mad / r.median : 0.0) << "%";
+            ci << benchFormatTime(r.ciLow) << " .. " << benchFormatTime(r.ciHigh);
+            out << std::left << std::setw(width) << r.name << std::right
+                << std::setw(13) << benchFormatTime(r.median) << std::setw(9) << mad.str()
+                << std::setw(27) << ci.str() << std::setw(13) << benchFormatTime(r.minimum);
+            if (r.throughput() > 0) {
+                out << "  " << std::setprecision(4) << std::defaultfloat << r.throughput() << " " << r.unit << "/s";
+            }
+            out << std::endl;
+        }
+    }
+
+    void writeJson(std::ostream& out, const std::vector<BenchResult>& results, const BenchOptions& options) const {
+        out << std::setprecision(9) << "{\n  \"context\": {";
+        auto context = benchContext(program);
+        for (size_t i = 0; i < context.size(); ++i) {
+            out << (i ? ", " : "") << benchJsonString(context[i].first) << ": " << benchJsonString(context[i].second);
+        }
+        out << ", \"trials\": " << options.trials << ", \"warmup\": " << options.warmup << "},\n  \"benchmarks\": [";
+        for (size_t i = 0; i < results.size(); ++i) {
+            const BenchResult& r = results[i];
+            out << (i ? ",\n" : "\n") << "    {\"name\": " << benchJsonString(r.name)
+                << ", \"batch\": " << r.batch << ", \"median_s\": " << r.median << ", \"mad_s\": " << r.mad
+                << ", \"ci95_low_s\": " << r.ciLow << ", \"ci95_high_s\": " << r.ciHigh
+                << ", \"mean_s\": " << r.mean << ", \"min_s\": " << r.minimum << ", \"max_s\": " << r.maximum;
+            if (r.items > 0) {
+                out << ", \"items\": " << r.items << ", \"unit\": " << benchJsonString(r.unit)
+                    << ", \"throughput\": " << r.throughput();
+            }
+            out << ", \"samples_s\": [";
+            for (size_t s = 0; s < r.samples.size(); ++s) {
+                out << (s ? ", " : "") << r.samples[s];
+            }
+            out << "]}";
+        }
+        out << "\n  ]\n}" << std::endl;
+    }
+
+    void writeCsv(std::ostream& out, const std::vector<BenchResult>& results, const BenchOptions& options) const {
+        auto context = benchContext(program);
+        auto field = [](const std::string& text) {
+            if (text.find_first_of(",\"\n") == std::string::npos) return text;
+            std::string quoted = "\"";
+            for (char c : text) {
+                quoted += c;
+                if (c == '"') quoted += '"';
+            }
+            return quoted + "\"";
+        };
+
+        for (const auto& kv : context) out << kv.first << ",";
+        out << "name,trials,warmup,batch,median_s,mad_s,ci95_low_s,ci95_high_s,mean_s,min_s,max_s,items,unit,throughput" << std::endl;
+        out << std::setprecision(9);
+        for (const BenchResult& r : results) {
+            for (const auto& kv : context) out << field(kv.second) << ",";
+            out << field(r.name) << "," << options.trials << "," << options.warmup << "," << r.batch << ","
+                << r.median << "," << r.mad << "," << r.ciLow << "," << r.ciHigh << ","
+                << r.mean << "," << r.minimum << "," << r.maximum << ","
+                << r.items << "," << field(r.unit) << "," << r.throughput() << std::endl;
+        }
+    }
+};
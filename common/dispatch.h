@@ -0,0 +1,217 @@
+﻿#pragma once
+// Выбор варианта горячего ядра по возможностям процессора во время выполнения.
+// Один исполняемый файл содержит каждое ядро в нескольких вариантах: scalar
+// (базовый набор команд сборки), SSE4.2, AVX2 (+FMA) и AVX-512 (F, BW, VL, DQ).
+// Вариант - отдельная функция с атрибутом SIMD_TARGET_*: GCC и Clang компилируют
+// её под указанный набор команд независимо от -march, MSVC разрешает интринсики
+// любого набора и без атрибута. Поэтому векторные варианты пишутся интринсиками.
+//
+// Уровень определяется один раз при запуске по CPUID и XGETBV (ОС должна сохранять
+// регистры ymm/zmm), SimdKernel запоминает лучший вариант не выше этого уровня.
+// Переменная окружения SIMD_LEVEL=scalar|sse4.2|avx2|avx512 понижает уровень для
+// проверки и замеров; уровень выше доступного не включается.
+// simdCrossCheck прогоняет все варианты, доступные на машине, и сравнивает их
+// результат со скалярным.
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define SIMD_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+// GCC для C++ по умолчанию сливает a * b + c в FMA (-ffp-contract=fast), и вариант
+// с FMA считал бы иначе, чем скалярный. Поэтому сжатие выключено во всех вариантах,
+// включая скалярный (SIMD_TARGET_SCALAR, им же помечаются общие с векторными
+// вариантами функции), даже если сама сборка идёт с -mfma или -march=haswell;
+// FMA пишется явно (_mm*_fmadd_*). Clang сливает только внутри одного выражения
+// (-ffp-contract=on), для него сжатие выключается прагмой на всю единицу трансляции.
+// MSVC с /fp:precise не сливает
+#if defined(SIMD_X86) && defined(__GNUC__) && !defined(__clang__)
+#define SIMD_NO_CONTRACT , optimize("fp-contract=off")
+#define SIMD_TARGET_SCALAR __attribute__((optimize("fp-contract=off")))
+#else
+#define SIMD_NO_CONTRACT
+#define SIMD_TARGET_SCALAR
+#endif
+#if defined(__clang__)
+#pragma clang fp contract(off)
+#endif
+
+#if defined(SIMD_X86) && (defined(__GNUC__) || defined(__clang__))
+#define SIMD_TARGET_SSE42 __attribute__((target("sse4.2,popcnt") SIMD_NO_CONTRACT))
+#define SIMD_TARGET_AVX2 __attribute__((target("avx2,fma,bmi,bmi2,popcnt") SIMD_NO_CONTRACT))
+#define SIMD_TARGET_AVX512 __attribute__((target("avx512f,avx512bw,avx512vl,avx512dq,avx2,fma,bmi,bmi2,popcnt") SIMD_NO_CONTRACT))
+#else
+#define SIMD_TARGET_SSE42
+#define SIMD_TARGET_AVX2
+#define SIMD_TARGET_AVX512
+#endif
+
+enum class SimdLevel { Scalar, Sse42, Avx2, Avx512 };
+const int SIMD_LEVEL_COUNT = 4;
+
+inline const char* simdLevelName(SimdLevel level) {
+    switch (level) {
+    case SimdLevel::Sse42: return "sse4.2";
+    case SimdLevel::Avx2: return "avx2";
+    case SimdLevel::Avx512: return "avx512";
+    default: return "scalar";
+    }
+}
+
+inline bool simdParseLevel(const std::string& name, SimdLevel& level) {
+    for (int i = 0; i < SIMD_LEVEL_COUNT; ++i) {
+        if (name == simdLevelName(static_cast<SimdLevel>(i))) {
+            level = static_cast<SimdLevel>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+#if defined(SIMD_X86)
+// Регистры eax, ebx, ecx, edx листа leaf (подлиста sub) CPUID
+inline void simdCpuid(unsigned leaf, unsigned sub, unsigned regs[4]) {
+#if defined(_MSC_VER)
+    int r[4];
+    __cpuidex(r, static_cast<int>(leaf), static_cast<int>(sub));
+    for (int i = 0; i < 4; ++i) regs[i] = static_cast<unsigned>(r[i]);
+#else
+    __cpuid_count(leaf, sub, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+
+// Какие регистры сохраняет ОС при переключении контекста (XCR0)
+inline unsigned long long simdXcr0() {
+#if defined(_MSC_VER)
+    return _xgetbv(0);
+#else
+    unsigned lo, hi;
+    __asm__ volatile("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+    return (static_cast<unsigned long long>(hi) << 32) | lo;
+#endif
+}
+#endif
+
+// Наибольший уровень, который поддерживают процессор и ОС
+inline SimdLevel simdDetect() {
+#if defined(SIMD_X86)
+    unsigned regs[4];
+    simdCpuid(0, 0, regs);
+    unsigned maxLeaf = regs[0];
+    simdCpuid(1, 0, regs);
+    unsigned ecx1 = regs[2];
+    bool sse42 = (ecx1 >> 20 & 1) && (ecx1 >> 23 & 1);  // SSE4.2, POPCNT
+    if (!sse42) return SimdLevel::Scalar;
+
+    bool osxsave = ecx1 >> 27 & 1;
+    bool avx = (ecx1 >> 28 & 1) && (ecx1 >> 12 & 1);  // AVX, FMA
+    unsigned long long xcr0 = osxsave ? simdXcr0() : 0;
+    bool ymmSaved = (xcr0 & 0x6) == 0x6;
+    bool zmmSaved = (xcr0 & 0xE6) == 0xE6;
+    if (!avx || !ymmSaved || maxLeaf < 7) return SimdLevel::Sse42;
+
+    simdCpuid(7, 0, regs);
+    unsigned ebx7 = regs[1];
+    bool avx2 = (ebx7 >> 5 & 1) && (ebx7 >> 3 & 1) && (ebx7 >> 8 & 1);  // AVX2, BMI1, BMI2
+    if (!avx2) return SimdLevel::Sse42;
+
+    // F, DQ, BW, VL
+    bool avx512 = (ebx7 >> 16 & 1) && (ebx7 >> 17 & 1) && (ebx7 >> 30 & 1) && (ebx7 >> 31 & 1);
+    return avx512 && zmmSaved ? SimdLevel::Avx512 : SimdLevel::Avx2;
+#else
+    return SimdLevel::Scalar;
+#endif
+}
+
+// Рабочий уровень: определённый по CPUID, ограниченный переменной SIMD_LEVEL
+inline SimdLevel simdLevel() {
+    static const SimdLevel level = [] {
+        SimdLevel detected = simdDetect();
+        const char* forced = std::getenv("SIMD_LEVEL");
+        if (!forced || !*forced) return detected;
+
+        SimdLevel requested;
+        if (!simdParseLevel(forced, requested)) {
+            std::cerr << "SIMD_LEVEL=" << forced << " is not one of scalar, sse4.2, avx2, avx512; using "
+                << simdLevelName(detected) << "\n";
+            return detected;
+        }
+        if (requested > detected) {
+            std::cerr << "SIMD_LEVEL=" << forced << " is not supported by this CPU; using "
+                << simdLevelName(detected) << "\n";
+            return detected;
+        }
+        return requested;
+    }();
+    return level;
+}
+
+// Набор вариантов одного ядра. Отсутствующий вариант (nullptr) заменяется
+// ближайшим уровнем ниже; скалярный вариант обязателен
+template <class Fn>
+class SimdKernel {
+public:
+    SimdKernel(Fn scalar, Fn sse42, Fn avx2, Fn avx512)
+        : variants{ scalar, sse42, avx2, avx512 } {
+        chosen = resolve(simdLevel());
+    }
+
+    // Уровень варианта, который работает вместо level
+    SimdLevel resolve(SimdLevel level) const {
+        int i = static_cast<int>(level);
+        while (i > 0 && !variants[i]) --i;
+        return static_cast<SimdLevel>(i);
+    }
+
+    Fn at(SimdLevel level) const { return variants[static_cast<int>(resolve(level))]; }
+
+    // Вариант, выбранный при запуске
+    Fn get() const { return variants[static_cast<int>(chosen)]; }
+    SimdLevel level() const { return chosen; }
+
+    // Различные варианты, которые может выполнить этот процессор
+    std::vector<SimdLevel> levels() const {
+        std::vector<SimdLevel> result;
+        for (int i = 0; i <= static_cast<int>(simdDetect()); ++i) {
+            if (variants[i]) result.push_back(static_cast<SimdLevel>(i));
+        }
+        return result;
+    }
+
+private:
+    Fn variants[SIMD_LEVEL_COUNT];
+    SimdLevel chosen;
+};
+
+// Прогон всех доступных вариантов ядра: run(fn) возвращает результат варианта,
+// same(reference, result) сравнивает его со скалярным. Печатает строку
+// "name: sse4.2 ok avx2 ok ..." и возвращает true, если совпали все
+template <class Fn, class Run, class Same>
+bool simdCrossCheck(std::ostream& out, const char* name, const SimdKernel<Fn>& kernel, Run run, Same same) {
+    auto reference = run(kernel.at(SimdLevel::Scalar));
+    bool ok = true;
+    out << name << ":";
+    for (SimdLevel level : kernel.levels()) {
+        if (level == SimdLevel::Scalar) continue;
+        bool match = same(reference, run(kernel.at(level)));
+        ok = ok && match;
+        out << " " << simdLevelName(level) << (match ? " ok" : " MISMATCH");
+    }
+    if (kernel.levels().size() == 1) out << " scalar only";
+    out << "\n";
+    return ok;
+}
+
+// Сравнение на точное (побитовое для целых и для вещественных без NaN) совпадение
+template <class Fn, class Run>
+bool simdCrossCheck(std::ostream& out, const char* name, const SimdKernel<Fn>& kernel, Run run) {
+    return simdCrossCheck(out, name, kernel, run, [](const auto& a, const auto& b) { return a == b; });
+}
@@ -0,0 +1,653 @@
+﻿#pragma once
+// Умножение матриц (C += A * B) и матрицы на вектор (y = A * x) для разных типов
+// входных данных и накопителя: int8 и int16 с накоплением в int32, int32, float,
+// double. Всё сводится к скалярным произведениям строки A на столбец B (или на x),
+// поэтому быстрый путь ждёт A по строкам и B по столбцам (Layout::ColMajor), иначе
+// работает обычный цикл по представлениям.
+// Микроядро выбирается по паре типов (if constexpr) и по процессору во время
+// выполнения (SimdKernel, см. dispatch.h): варианты scalar, sse4.2, avx2, avx512.
+//   int16 -> int32   pmaddwd: произведения и попарные суммы за инструкцию
+//   int8  -> int32   расширение до int16 (pmovsxbw) и pmaddwd
+//   int32 -> int32   pmulld + paddd
+//   float, double    mul + add (sse4.2), FMA (avx2, avx512)
+// Остальные пары - скалярный цикл. Целые суммы в векторных ядрах переполняются
+// по модулю 2^32, поэтому результат верен, только если точная сумма помещается в
+// накопитель; это проверяет gemmValidate. Целые варианты совпадают побитово,
+// вещественные - с точностью до округления (FMA и число дорожек меняют порядок
+// сложений); gemmCrossCheck сверяет их так же, как gemmValidate.
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <ostream>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include "matrix.h"
+#include "dispatch.h"
+
+template <class T>
+inline const char* gemmTypeName() {
+    if (std::is_same<T, int8_t>::value) return "int8";
+    if (std::is_same<T, int16_t>::value) return "int16";
+    if (std::is_same<T, int32_t>::value) return "int32";
+    if (std::is_same<T, float>::value) return "float";
+    if (std::is_same<T, double>::value) return "double";
+    return "other";
+}
+
+// sum + a * b в типе накопителя; целые - по модулю 2^N, как в векторных ядрах
+template <class Acc, class In>
+inline Acc gemmMulAdd(Acc sum, In a, In b) {
+    if constexpr (std::is_integral<Acc>::value) {
+        using Unsigned = typename std::make_unsigned<Acc>::type;
+        return static_cast<Acc>(static_cast<Unsigned>(sum)
+            + static_cast<Unsigned>(static_cast<Acc>(a)) * static_cast<Unsigned>(static_cast<Acc>(b)));
+    }
+    else {
+        return sum + static_cast<Acc>(a) * static_cast<Acc>(b);
+    }
+}
+
+template <class Acc>
+inline Acc gemmAdd(Acc sum, Acc value) {
+    return gemmMulAdd(sum, value, Acc(1));
+}
+
+// Пары типов, для которых есть векторные варианты
+template <class In, class Acc>
+constexpr bool gemmHasSimdKernel() {
+    return (std::is_same<Acc, int32_t>::value &&
+        (std::is_same<In, int8_t>::value || std::is_same<In, int16_t>::value || std::is_same<In, int32_t>::value))
+        || (std::is_same<In, float>::value && std::is_same<Acc, float>::value)
+        || (std::is_same<In, double>::value && std::is_same<Acc, double>::value);
+}
+
+// N скалярных произведений длины k: out[c] = a . b[c]
+template <class In, class Acc, int N>
+inline void gemmDotScalar(const In* a, const In* const* b, int k, Acc* out) {
+    for (int c = 0; c < N; ++c) {
+        Acc sum = 0;
+        for (int p = 0; p < k; ++p) {
+            sum = gemmMulAdd(sum, a[p], b[c][p]);
+        }
+        out[c] = sum;
+    }
+}
+
+// Хвост короче вектора досчитывается скалярно
+template <class In, class Acc, int N>
+inline void gemmDotTail(const In* a, const In* const* b, int p, int k, Acc* out) {
+    for (; p < k; ++p) {
+        for (int c = 0; c < N; ++c) out[c] = gemmMulAdd(out[c], a[p], b[c][p]);
+    }
+}
+
+SIMD_TARGET_SSE42 inline int32_t gemmHsum(__m128i v) {
+    v = _mm_add_epi32(v, _mm_shuffle_epi32(v, 0x4E));
+    v = _mm_add_epi32(v, _mm_shuffle_epi32(v, 0xB1));
+    return _mm_cvtsi128_si32(v);
+}
+
+SIMD_TARGET_SSE42 inline float gemmHsum(__m128 v) {
+    v = _mm_add_ps(v, _mm_movehl_ps(v, v));
+    v = _mm_add_ss(v, _mm_shuffle_ps(v, v, 0x55));
+    return _mm_cvtss_f32(v);
+}
+
+SIMD_TARGET_SSE42 inline double gemmHsum(__m128d v) {
+    return _mm_cvtsd_f64(_mm_add_sd(v, _mm_unpackhi_pd(v, v)));
+}
+
+// Одна загрузка a на N столбцов B
+template <class In, class Acc, int N>
+SIMD_TARGET_SSE42 void gemmDotSse42(const In* a, const In* const* b, int k, Acc* out) {
+    int p = 0;
+    if constexpr (std::is_same<In, int16_t>::value || std::is_same<In, int8_t>::value) {
+        __m128i acc[N];
+        for (int c = 0; c < N; ++c) acc[c] = _mm_setzero_si128();
+        for (; p + 8 <= k; p += 8) {
+            __m128i va;
+            if constexpr (std::is_same<In, int16_t>::value) {
+                va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + p));
+            }
+            else {
+                va = _mm_cvtepi8_epi16(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(a + p)));
+            }
+            for (int c = 0; c < N; ++c) {
+                __m128i vb;
+                if constexpr (std::is_same<In, int16_t>::value) {
+                    vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b[c] + p));
+                }
+                else {
+                    vb = _mm_cvtepi8_epi16(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(b[c] + p)));
+                }
+                acc[c] = _mm_add_epi32(acc[c], _mm_madd_epi16(va, vb));
+            }
+        }
+        for (int c = 0; c < N; ++c) out[c] = gemmHsum(acc[c]);
+    }
+    else if constexpr (std::is_same<In, int32_t>::value) {
+        __m128i acc[N];
+        for (int c = 0; c < N; ++c) acc[c] = _mm_setzero_si128();
+        for (; p + 4 <= k; p += 4) {
+            __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + p));
+            for (int c = 0; c < N; ++c) {
+                __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b[c] + p));
+                acc[c] = _mm_add_epi32(acc[c], _mm_mullo_epi32(va, vb));
+            }
+        }
+        for (int c = 0; c < N; ++c) out[c] = gemmHsum(acc[c]);
+    }
+    else if constexpr (std::is_same<In, float>::value) {
+        __m128 acc[N];
+        for (int c = 0; c < N; ++c) acc[c] = _mm_setzero_ps();
+        for (; p + 4 <= k; p += 4) {
+            __m128 va = _mm_loadu_ps(a + p);
+            for (int c = 0; c < N; ++c) acc[c] = _mm_add_ps(acc[c], _mm_mul_ps(va, _mm_loadu_ps(b[c] + p)));
+        }
+        for (int c = 0; c < N; ++c) out[c] = gemmHsum(acc[c]);
+    }
+    else {
+        __m128d acc[N];
+        for (int c = 0; c < N; ++c) acc[c] = _mm_setzero_pd();
+        for (; p + 2 <= k; p += 2) {
+            __m128d va = _mm_loadu_pd(a + p);
+            for (int c = 0; c < N; ++c) acc[c] = _mm_add_pd(acc[c], _mm_mul_pd(va, _mm_loadu_pd(b[c] + p)));
+        }
+        for (int c = 0; c < N; ++c) out[c] = gemmHsum(acc[c]);
+    }
+    gemmDotTail<In, Acc, N>(a, b, p, k, out);
+}
+
+SIMD_TARGET_AVX2 inline int32_t gemmHsum(__m256i v) {
+    return gemmHsum(_mm_add_epi32(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1)));
+}
+
+SIMD_TARGET_AVX2 inline float gemmHsum(__m256 v) {
+    return gemmHsum(_mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1)));
+}
+
+SIMD_TARGET_AVX2 inline double gemmHsum(__m256d v) {
+    return gemmHsum(_mm_add_pd(_mm256_castpd256_pd128(v), _mm256_extractf128_pd(v, 1)));
+}
+
+template <class In, class Acc, int N>
+SIMD_TARGET_AVX2 void gemmDotAvx2(const In* a, const In* const* b, int k, Acc* out) {
+    int p = 0;
+    if constexpr (std::is_same<In, int16_t>::value || std::is_same<In, int8_t>::value) {
+        __m256i acc[N];
+        for (int c = 0; c < N; ++c) acc[c] = _mm256_setzero_si256();
+        for (; p + 16 <= k; p += 16) {
+            __m256i va;
+            if constexpr (std::is_same<In, int16_t>::value) {
+                va = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + p));
+            }
+            else {
+                va = _mm256_cvtepi8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(a + p)));
+            }
+            for (int c = 0; c < N; ++c) {
+                __m256i vb;
+                if constexpr (std::is_same<In, int16_t>::value) {
+                    vb = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b[c] + p));
+                }
+                else {
+                    vb = _mm256_cvtepi8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(b[c] + p)));
+                }
+                acc[c] = _mm256_add_epi32(acc[c], _mm256_madd_epi16(va, vb));
+            }
+        }
+        for (int c = 0; c < N; ++c) out[c] = gemmHsum(acc[c]);
+    }
+    else if constexpr (std::is_same<In, int32_t>::value) {
+        __m256i acc[N];
+        for (int c = 0; c < N; ++c) acc[c] = _mm256_setzero_si256();
+        for (; p + 8 <= k; p += 8) {
+            __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + p));
+            for (int c = 0; c < N; ++c) {
+                __m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b[c] + p));
+                acc[c] = _mm256_add_epi32(acc[c], _mm256_mullo_epi32(va, vb));
+            }
+        }
+        for (int c = 0; c < N; ++c) out[c] = gemmHsum(acc[c]);
+    }
+    else if constexpr (std::is_same<In, float>::value) {
+        __m256 acc[N];
+        for (int c = 0; c < N; ++c) acc[c] = _mm256_setzero_ps();
+        for (; p + 8 <= k; p += 8) {
+            __m256 va = _mm256_loadu_ps(a + p);
+            for (int c = 0; c < N; ++c) acc[c] = _mm256_fmadd_ps(va, _mm256_loadu_ps(b[c] + p), acc[c]);
+        }
+        for (int c = 0; c < N; ++c) out[c] = gemmHsum(acc[c]);
+    }
+    else {
+        __m256d acc[N];
+        for (int c = 0; c < N; ++c) acc[c] = _mm256_setzero_pd();
+        for (; p + 4 <= k; p += 4) {
+            __m256d va = _mm256_loadu_pd(a + p);
+            for (int c = 0; c < N; ++c) acc[c] = _mm256_fmadd_pd(va, _mm256_loadu_pd(b[c] + p), acc[c]);
+        }
+        for (int c = 0; c < N; ++c) out[c] = gemmHsum(acc[c]);
+    }
+    gemmDotTail<In, Acc, N>(a, b, p, k, out);
+}
+
+// Горизонтальная сумма через половины регистра. Половины и расширение берутся
+// формами с маской всех дорожек: _mm512_cast*, _mm512_reduce_add_* и формы без
+// маски в заголовках GCC 12 дают ложные предупреждения -Wuninitialized
+SIMD_TARGET_AVX512 inline int32_t gemmHsum(__m512i v) {
+    return gemmHsum(_mm256_add_epi32(_mm512_maskz_extracti64x4_epi64(0xF, v, 0), _mm512_maskz_extracti64x4_epi64(0xF, v, 1)));
+}
+
+SIMD_TARGET_AVX512 inline float gemmHsum(__m512 v) {
+    return gemmHsum(_mm256_add_ps(_mm512_maskz_extractf32x8_ps(0xFF, v, 0), _mm512_maskz_extractf32x8_ps(0xFF, v, 1)));
+}
+
+SIMD_TARGET_AVX512 inline double gemmHsum(__m512d v) {
+    return gemmHsum(_mm256_add_pd(_mm512_maskz_extractf64x4_pd(0xF, v, 0), _mm512_maskz_extractf64x4_pd(0xF, v, 1)));
+}
+
+template <class In, class Acc, int N>
+SIMD_TARGET_AVX512 void gemmDotAvx512(const In* a, const In* const* b, int k, Acc* out) {
+    int p = 0;
+    if constexpr (std::is_same<In, int16_t>::value || std::is_same<In, int8_t>::value) {
+        const __mmask32 all = 0xFFFFFFFF;
+        __m512i acc[N];
+        for (int c = 0; c < N; ++c) acc[c] = _mm512_setzero_si512();
+        for (; p + 32 <= k; p += 32) {
+            __m512i va;
+            if constexpr (std::is_same<In, int16_t>::value) {
+                va = _mm512_loadu_si512(a + p);
+            }
+            else {
+                va = _mm512_maskz_cvtepi8_epi16(all, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + p)));
+            }
+            for (int c = 0; c < N; ++c) {
+                __m512i vb;
+                if constexpr (std::is_same<In, int16_t>::value) {
+                    vb = _mm512_loadu_si512(b[c] + p);
+                }
+                else {
+                    vb = _mm512_maskz_cvtepi8_epi16(all, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b[c] + p)));
+                }
+                acc[c] = _mm512_add_epi32(acc[c], _mm512_madd_epi16(va, vb));
+            }
+        }
+        for (int c = 0; c < N; ++c) out[c] = gemmHsum(acc[c]);
+    }
+    else if constexpr (std::is_same<In, int32_t>::value) {
+        __m512i acc[N];
+        for (int c = 0; c < N; ++c) acc[c] = _mm512_setzero_si512();
+        for (; p + 16 <= k; p += 16) {
+            __m512i va = _mm512_loadu_si512(a + p);
+            for (int c = 0; c < N; ++c) {
+                acc[c] = _mm512_add_epi32(acc[c], _mm512_mullo_epi32(va, _mm512_loadu_si512(b[c] + p)));
+            }
+        }
+        for (int c = 0; c < N; ++c) out[c] = gemmHsum(acc[c]);
+    }
+    else if constexpr (std::is_same<In, float>::value) {
+        __m512 acc[N];
+        for (int c = 0; c < N; ++c) acc[c] = _mm512_setzero_ps();
+        for (; p + 16 <= k; p += 16) {
+            __m512 va = _mm512_loadu_ps(a + p);
+            for (int c = 0; c < N; ++c) acc[c] = _mm512_fmadd_ps(va, _mm512_loadu_ps(b[c] + p), acc[c]);
+        }
+        for (int c = 0; c < N; ++c) out[c] = gemmHsum(acc[c]);
+    }
+    else {
+        __m512d acc[N];
+        for (int c = 0; c < N; ++c) acc[c] = _mm512_setzero_pd();
+        for (; p + 8 <= k; p += 8) {
+            __m512d va = _mm512_loadu_pd(a + p);
+            for (int c = 0; c < N; ++c) acc[c] = _mm512_fmadd_pd(va, _mm512_loadu_pd(b[c] + p), acc[c]);
+        }
+        for (int c = 0; c < N; ++c) out[c] = gemmHsum(acc[c]);
+    }
+    gemmDotTail<In, Acc, N>(a, b, p, k, out);
+}
+
+template <class In, class Acc, SimdLevel Level, int N>
+inline void gemmDot(const In* a, const In* const* b, int k, Acc* out) {
+    if constexpr (!gemmHasSimdKernel<In, Acc>() || Level == SimdLevel::Scalar) {
+        gemmDotScalar<In, Acc, N>(a, b, k, out);
+    }
+    else if constexpr (Level == SimdLevel::Sse42) {
+        gemmDotSse42<In, Acc, N>(a, b, k, out);
+    }
+    else if constexpr (Level == SimdLevel::Avx2) {
+        gemmDotAvx2<In, Acc, N>(a, b, k, out);
+    }
+    else {
+        gemmDotAvx512<In, Acc, N>(a, b, k, out);
+    }
+}
+
+// C += A * B; A (m x k), B (k x n), C (m x n); вариант уровня Level
+template <class In, class Acc, SimdLevel Level>
+void gemmAccumulateAt(MatrixView<const In> A, MatrixView<const In> B, MatrixView<Acc> C) {
+    int m = A.rows(), k = A.cols(), n = B.cols();
+    if (!A.rowMajor() || !B.colMajor()) {
+        for (int i = 0; i < m; ++i) {
+            for (int j = 0; j < n; ++j) {
+                Acc sum = 0;
+                for (int p = 0; p < k; ++p) sum = gemmMulAdd(sum, A(i, p), B(p, j));
+                C(i, j) = gemmAdd(C(i, j), sum);
+            }
+        }
+        return;
+    }
+
+    // Строка A загружается один раз на четыре столбца B
+    for (int i = 0; i < m; ++i) {
+        const In* a = A.row(i);
+        int j = 0;
+        for (; j + 4 <= n; j += 4) {
+            const In* b[4] = { B.col(j), B.col(j + 1), B.col(j + 2), B.col(j + 3) };
+            Acc out[4];
+            gemmDot<In, Acc, Level, 4>(a, b, k, out);
+            for (int c = 0; c < 4; ++c) C(i, j + c) = gemmAdd(C(i, j + c), out[c]);
+        }
+        for (; j < n; ++j) {
+            const In* b[1] = { B.col(j) };
+            Acc out[1];
+            gemmDot<In, Acc, Level, 1>(a, b, k, out);
+            C(i, j) = gemmAdd(C(i, j), out[0]);
+        }
+    }
+}
+
+// y = A * x; A (m x k); вариант уровня Level
+template <class In, class Acc, SimdLevel Level>
+void gemvAt(MatrixView<const In> A, const In* x, Acc* y) {
+    int m = A.rows(), k = A.cols();
+    if (!A.rowMajor()) {
+        for (int i = 0; i < m; ++i) {
+            Acc sum = 0;
+            for (int p = 0; p < k; ++p) sum = gemmMulAdd(sum, A(i, p), x[p]);
+            y[i] = sum;
+        }
+        return;
+    }
+
+    // x загружается один раз на четыре строки A
+    int i = 0;
+    for (; i + 4 <= m; i += 4) {
+        const In* rows[4] = { A.row(i), A.row(i + 1), A.row(i + 2), A.row(i + 3) };
+        gemmDot<In, Acc, Level, 4>(x, rows, k, y + i);
+    }
+    for (; i < m; ++i) {
+        const In* rows[1] = { A.row(i) };
+        gemmDot<In, Acc, Level, 1>(x, rows, k, y + i);
+    }
+}
+
+template <class In, class Acc>
+using GemmFn = void (*)(MatrixView<const In> A, MatrixView<const In> B, MatrixView<Acc> C);
+template <class In, class Acc>
+using GemvFn = void (*)(MatrixView<const In> A, const In* x, Acc* y);
+
+// Варианты для пары типов; без векторного ядра остаётся только скалярный
+template <class In, class Acc>
+const SimdKernel<GemmFn<In, Acc>>& gemmKernel() {
+    const bool simd = gemmHasSimdKernel<In, Acc>();
+    static const SimdKernel<GemmFn<In, Acc>> kernel(gemmAccumulateAt<In, Acc, SimdLevel::Scalar>,
+        simd ? gemmAccumulateAt<In, Acc, SimdLevel::Sse42> : nullptr,
+        simd ? gemmAccumulateAt<In, Acc, SimdLevel::Avx2> : nullptr,
+        simd ? gemmAccumulateAt<In, Acc, SimdLevel::Avx512> : nullptr);
+    return kernel;
+}
+
+template <class In, class Acc>
+const SimdKernel<GemvFn<In, Acc>>& gemvKernel() {
+    const bool simd = gemmHasSimdKernel<In, Acc>();
+    static const SimdKernel<GemvFn<In, Acc>> kernel(gemvAt<In, Acc, SimdLevel::Scalar>,
+        simd ? gemvAt<In, Acc, SimdLevel::Sse42> : nullptr,
+        simd ? gemvAt<In, Acc, SimdLevel::Avx2> : nullptr,
+        simd ? gemvAt<In, Acc, SimdLevel::Avx512> : nullptr);
+    return kernel;
+}
+
+// C += A * B вариантом, выбранным при запуске
+template <class In, class Acc>
+void gemmAccumulate(MatrixView<const In> A, MatrixView<const In> B, MatrixView<Acc> C) {
+    gemmKernel<In, Acc>().get()(A, B, C);
+}
+
+// y = A * x вариантом, выбранным при запуске
+template <class In, class Acc>
+void gemv(MatrixView<const In> A, const In* x, Acc* y) {
+    gemvKernel<In, Acc>().get()(A, x, y);
+}
+
+// Название выбранного микроядра для пары типов
+template <class In, class Acc>
+std::string gemmKernelName() {
+    SimdLevel level = gemmKernel<In, Acc>().level();
+    if (level == SimdLevel::Scalar) return "scalar";
+    std::string op;
+    if (std::is_same<In, int16_t>::value) op = "pmaddwd";
+    else if (std::is_same<In, int8_t>::value) op = "pmovsxbw+pmaddwd";
+    else if (std::is_same<In, int32_t>::value) op = "pmulld";
+    else op = level == SimdLevel::Sse42 ? "mul+add" : "fma";
+    return std::string(simdLevelName(level)) + " " + op;
+}
+
+// Итог сверки ядра с эталоном
+struct GemmCheck {
+    long long checked = 0;     // сколько элементов сверено
+    long long mismatches = 0;  // сколько из них не совпало с эталоном
+    long long overflows = 0;   // сколько точных сумм не помещается в накопитель
+    bool boundFits = true;     // k * max|a| * max|b| помещается в накопитель
+    double maxError = 0;       // наибольшее отклонение (для float - относительно суммы модулей)
+
+    bool ok() const { return mismatches == 0 && overflows == 0; }
+};
+
+// Точная целая сумма эталона. Произведение int32 занимает до 62 бит, поэтому сумма
+// k таких произведений может не поместиться в int64: в GCC и Clang она считается
+// в __int128 (хватает на k < 2^31), иначе в int64 с проверкой каждого сложения
+#if defined(__SIZEOF_INT128__)
+__extension__ typedef __int128 GemmExactInt;
+
+inline bool gemmAddExact(GemmExactInt& sum, long long product) {
+    sum += product;
+    return true;
+}
+#else
+typedef long long GemmExactInt;
+
+// false, если сумма вышла за int64 (тогда она тем более не помещается в накопитель)
+inline bool gemmAddExact(GemmExactInt& sum, long long product) {
+    if ((product > 0 && sum > (std::numeric_limits<long long>::max)() - product)
+        || (product < 0 && sum < (std::numeric_limits<long long>::min)() - product)) {
+        return false;
+    }
+    sum += product;
+    return true;
+}
+#endif
+
+// Эталон для одного элемента: точная целая сумма (GemmExactInt), для вещественных -
+// сумма в double и сумма модулей для допуска округления
+template <class In, class Acc, class ElementA, class ElementB>
+void gemmCheckElement(ElementA a, ElementB b, int k, Acc actual, GemmCheck& check) {
+    check.checked++;
+    if constexpr (std::is_integral<Acc>::value) {
+        GemmExactInt exact = 0;
+        bool fits = true;
+        for (int p = 0; p < k && fits; ++p) {
+            fits = gemmAddExact(exact, static_cast<long long>(a(p)) * static_cast<long long>(b(p)));
+        }
+        if (!fits || exact < static_cast<long long>(std::numeric_limits<Acc>::min())
+            || exact > static_cast<long long>(std::numeric_limits<Acc>::max())) {
+            check.overflows++;
+            return;
+        }
+        double error = std::fabs(static_cast<double>(static_cast<long long>(exact) - static_cast<long long>(actual)));
+        check.maxError = (std::max)(check.maxError, error);
+        if (error != 0) check.mismatches++;
+    }
+    else {
+        double exact = 0, magnitude = 0;
+        for (int p = 0; p < k; ++p) {
+            double product = static_cast<double>(a(p)) * static_cast<double>(b(p));
+            exact += product;
+            magnitude += std::fabs(product);
+        }
+        if (std::fabs(exact) > static_cast<double>(std::numeric_limits<Acc>::max())) {
+            check.overflows++;
+            return;
+        }
+        // Порядок сложения в векторном ядре другой, допуск - k округлений накопителя
+        double error = magnitude > 0 ? std::fabs(exact - static_cast<double>(actual)) / magnitude : 0.0;
+        check.maxError = (std::max)(check.maxError, error);
+        if (error > k * static_cast<double>(std::numeric_limits<Acc>::epsilon())) check.mismatches++;
+    }
+}
+
+// Худшая сумма k * max|a| * max|b| против диапазона накопителя
+template <class In, class Acc>
+bool gemmBoundFits(int k, double maxA, double maxB) {
+    return static_cast<double>(k) * maxA * maxB <= static_cast<double>(std::numeric_limits<Acc>::max());
+}
+
+template <class T>
+double gemmMaxAbs(MatrixView<const T> M) {
+    double result = 0;
+    for (int i = 0; i < M.rows(); ++i) {
+        for (int j = 0; j < M.cols(); ++j) result = (std::max)(result, std::fabs(static_cast<double>(M(i, j))));
+    }
+    return result;
+}
+
+// Сверка C = A * B со скалярным эталоном на samples элементах, равномерно по C
+template <class In, class Acc>
+GemmCheck gemmValidate(MatrixView<const In> A, MatrixView<const In> B, MatrixView<const Acc> C, long long samples = 4096) {
+    GemmCheck check;
+    int m = C.rows(), n = C.cols(), k = A.cols();
+    check.boundFits = gemmBoundFits<In, Acc>(k, gemmMaxAbs(A), gemmMaxAbs(B));
+    long long total = static_cast<long long>(m) * n;
+    long long step = (std::max)(1LL, total / (std::max)(1LL, samples));
+    for (long long e = 0; e < total; e += step) {
+        int i = static_cast<int>(e / n), j = static_cast<int>(e % n);
+        gemmCheckElement<In, Acc>([&](int p) { return A(i, p); }, [&](int p) { return B(p, j); }, k, C(i, j), check);
+    }
+    return check;
+}
+
+// Сверка y = A * x со скалярным эталоном по всем строкам
+template <class In, class Acc>
+GemmCheck gemvValidate(MatrixView<const In> A, const In* x, const Acc* y) {
+    GemmCheck check;
+    int k = A.cols();
+    double maxX = 0;
+    for (int p = 0; p < k; ++p) maxX = (std::max)(maxX, std::fabs(static_cast<double>(x[p])));
+    check.boundFits = gemmBoundFits<In, Acc>(k, gemmMaxAbs(A), maxX);
+    for (int i = 0; i < A.rows(); ++i) {
+        gemmCheckElement<In, Acc>([&](int p) { return A(i, p); }, [&](int p) { return x[p]; }, k, y[i], check);
+    }
+    return check;
+}
+
+// Сверка всех доступных вариантов gemmAccumulate со скалярным на C = A * B:
+// целые - побитово, вещественные - каждый против эталона, как в gemmValidate
+template <class In, class Acc>
+bool gemmCrossCheck(std::ostream& out, const char* name, MatrixView<const In> A, MatrixView<const In> B) {
+    auto run = [&](GemmFn<In, Acc> fn) {
+        Matrix<Acc> C(A.rows(), B.cols());
+        fn(A, B, C.view());
+        return C;
+    };
+    auto same = [&](const Matrix<Acc>& reference, const Matrix<Acc>& C) {
+        if constexpr (std::is_integral<Acc>::value) {
+            for (int i = 0; i < C.rows(); ++i) {
+                for (int j = 0; j < C.cols(); ++j) {
+                    if (C(i, j) != reference(i, j)) return false;
+                }
+            }
+            return true;
+        }
+        else {
+            return gemmValidate<In, Acc>(A, B, C.view()).mismatches == 0;
+        }
+    };
+    return simdCrossCheck(out, name, gemmKernel<In, Acc>(), run, same);
+}
+
+// То же для всех вариантов gemv
+template <class In, class Acc>
+bool gemvCrossCheck(std::ostream& out, const char* name, MatrixView<const In> A, const In* x) {
+    auto run = [&](GemvFn<In, Acc> fn) {
+        std::vector<Acc> y(A.rows());
+        fn(A, x, y.data());
+        return y;
+    };
+    auto same = [&](const std::vector<Acc>& reference, const std::vector<Acc>& y) {
+        if constexpr (std::is_integral<Acc>::value) {
+            return y == reference;
+        }
+        else {
+            return gemvValidate<In, Acc>(A, x, y.data()).mismatches == 0;
+        }
+    };
+    return simdCrossCheck(out, name, gemvKernel<In, Acc>(), run, same);
+}
+
+// Данные для сверки краевых случаев: знаковые значения у границ типа (max, min,
+// -max), малые знаковые и случайные во всём диапазоне типа; у вещественных -
+// знаковые в [-100, 100]. Генератор детерминирован, одинаков на всех машинах
+template <class T>
+T gemmEdgeValue(uint32_t& state) {
+    state = state * 1664525u + 1013904223u;
+    uint32_t r = state >> 8;
+    if constexpr (std::is_integral<T>::value) {
+        switch (r % 8) {
+        case 0: return (std::numeric_limits<T>::max)();
+        case 1: return (std::numeric_limits<T>::min)();
+        case 2: return static_cast<T>(-(std::numeric_limits<T>::max)());
+        case 3: return static_cast<T>(static_cast<int>(r >> 3 & 7) - 3);
+        default: return static_cast<T>(static_cast<typename std::make_unsigned<T>::type>(state));
+        }
+    }
+    else {
+        return static_cast<T>((static_cast<double>(r % 2001) - 1000.0) / 10.0);
+    }
+}
+
+template <class T>
+Matrix<T> gemmEdgeMatrix(int rows, int cols, Layout layout, uint32_t seed) {
+    Matrix<T> M(rows, cols, layout);
+    for (int i = 0; i < rows; ++i) {
+        for (int j = 0; j < cols; ++j) M(i, j) = gemmEdgeValue<T>(seed);
+    }
+    return M;
+}
+
+// Размеры краевой сверки: нечётные, чтобы работали хвосты циклов всех вариантов
+const int GEMM_EDGE_M = 19, GEMM_EDGE_N = 13, GEMM_EDGE_K = 131;
+
+// Сверка вариантов gemm на краевых данных (строка "<name>/edge: ..."): расширение
+// знака int8, pmaddwd на -32768 * -32768, перенос по модулю 2^32 при переполнении
+// целого накопителя. Возвращает сверку выбранного варианта с точным эталоном -
+// у int16 и int32 в ней должны найтись переполнения
+template <class In, class Acc>
+GemmCheck gemmEdgeCheck(std::ostream& out, const std::string& name) {
+    Matrix<In> A = gemmEdgeMatrix<In>(GEMM_EDGE_M, GEMM_EDGE_K, Layout::RowMajor, 1);
+    Matrix<In> B = gemmEdgeMatrix<In>(GEMM_EDGE_K, GEMM_EDGE_N, Layout::ColMajor, 2);
+    gemmCrossCheck<In, Acc>(out, (name + "/edge").c_str(), A.view(), B.view());
+    Matrix<Acc> C(GEMM_EDGE_M, GEMM_EDGE_N);
+    gemmAccumulate<In, Acc>(A.view(), B.view(), C.view());
+    return gemmValidate<In, Acc>(A.view(), B.view(), C.view(), static_cast<long long>(GEMM_EDGE_M) * GEMM_EDGE_N);
+}
+
+// То же для gemv
+template <class In, class Acc>
+GemmCheck gemvEdgeCheck(std::ostream& out, const std::string& name) {
+    Matrix<In> A = gemmEdgeMatrix<In>(GEMM_EDGE_M, GEMM_EDGE_K, Layout::RowMajor, 3);
+    Matrix<In> x = gemmEdgeMatrix<In>(1, GEMM_EDGE_K, Layout::RowMajor, 4);
+    gemvCrossCheck<In, Acc>(out, (name + "/edge").c_str(), A.view(), x.row(0));
+    std::vector<Acc> y(GEMM_EDGE_M);
+    gemv<In, Acc>(A.view(), x.row(0), y.data());
+    return gemvValidate<In, Acc>(A.view(), x.row(0), y.data());
+}
@@ -0,0 +1,274 @@
+﻿#pragma once
+// Мьютекс со статистикой: число захватов, захватов с ожиданием, гистограммы
+// времени ожидания и удержания по местам вызова. Отчёт печатается в stderr
+// при уничтожении мьютекса (для глобальных - при выходе из программы).
+// С -DLOCK_STATS_OFF остаётся обычный мьютекс без учёта.
+#include <mutex>
+#include <chrono>
+#include <vector>
+#include <memory>
+#include <string>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include <utility>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+// Дешёвые отметки времени: счётчик тактов TSC на x86, иначе steady_clock в нс.
+// Перевод тактов в наносекунды калибруется по steady_clock за время работы программы
+class LockClock {
+public:
+    static uint64_t now() {
+#if defined(_MSC_VER) || defined(__x86_64__) || defined(__i386__)
+        return __rdtsc();
+#else
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+    }
+
+    // Наносекунд в одном такте
+    static double nsPerTick() {
+        const Origin& o = origin();
+        double ticks = static_cast<double>(now() - o.ticks);
+        double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - o.time).count();
+        return ticks > 0 ? ns / ticks : 1.0;
+    }
+
+    static void start() {
+        origin();
+    }
+
+private:
+    struct Origin {
+        uint64_t ticks = LockClock::now();
+        std::chrono::steady_clock::time_point time = std::chrono::steady_clock::now();
+    };
+
+    static const Origin& origin() {
+        static const Origin o;
+        return o;
+    }
+};
+
+// Гистограмма в стиле HDR: значения до 31 хранятся точно, дальше каждая степень
+// двойки делится на 16 равных корзин - относительная погрешность не больше 1/16
+class LatencyHistogram {
+public:
+    static const int BUCKETS = 32 + 59 * 16;
+
+    void record(uint64_t value) {
+        counts[bucketOf(value)]++;
+        total++;
+        sum += value;
+        max = (std::max)(max, value);
+    }
+
+    uint64_t count() const { return total; }
+    uint64_t maximum() const { return max; }
+    double mean() const { return total ? static_cast<double>(sum) / total : 0.0; }
+
+    // Нижняя граница корзины, в которую попадает доля p значений
+    uint64_t percentile(double p) const {
+        if (total == 0) return 0;
+        uint64_t rank = static_cast<uint64_t>(p * (total - 1)) + 1;
+        uint64_t seen = 0;
+        for (int b = 0; b < BUCKETS; ++b) {
+            seen += counts[b];
+            if (seen >= rank) return (std::min)(lowerBound(b), max);
+        }
+        return max;
+    }
+
+private:
+    static int bucketOf(uint64_t value) {
+        if (value < 32) return static_cast<int>(value);
+#if defined(_MSC_VER)
+        unsigned long index;
+        _BitScanReverse64(&index, value);
+        int msb = static_cast<int>(index);
+#else
+        int msb = 63 - __builtin_clzll(value);
+#endif
+        int shift = msb - 4;
+        return 32 + (msb - 5) * 16 + static_cast<int>((value >> shift) - 16);
+    }
+
+    static uint64_t lowerBound(int bucket) {
+        if (bucket < 32) return bucket;
+        int group = (bucket - 32) / 16;
+        int sub = (bucket - 32) % 16;
+        return static_cast<uint64_t>(16 + sub) << (group + 1);
+    }
+
+    uint64_t counts[BUCKETS] = {};
+    uint64_t total = 0;
+    uint64_t sum = 0;
+    uint64_t max = 0;
+};
+
+#ifndef LOCK_STATS_OFF
+
+// Обёртка над std::mutex с тем же интерфейсом (lock, try_lock, unlock).
+// Место вызова lock() определяется через __builtin_FILE/__builtin_LINE;
+// вся статистика меняется только под самим мьютексом, поэтому атомарные
+// операции не нужны, а захват без ожидания стоит два чтения TSC
+class InstrumentedMutex {
+public:
+    explicit InstrumentedMutex(const char* name = "mutex") : name(name) {
+        LockClock::start();
+    }
+
+    InstrumentedMutex(const InstrumentedMutex&) = delete;
+    InstrumentedMutex& operator=(const InstrumentedMutex&) = delete;
+
+    ~InstrumentedMutex() {
+        report();
+    }
+
+    void lock(const char* file = __builtin_FILE(), int line = __builtin_LINE()) {
+        if (mutex.try_lock()) {
+            acquired(file, line, LockClock::now(), false, 0);
+            return;
+        }
+        uint64_t start = LockClock::now();
+        mutex.lock();
+        uint64_t now = LockClock::now();
+        acquired(file, line, now, true, now - start);
+    }
+
+    bool try_lock(const char* file = __builtin_FILE(), int line = __builtin_LINE()) {
+        if (!mutex.try_lock()) return false;
+        acquired(file, line, LockClock::now(), false, 0);
+        return true;
+    }
+
+    void unlock() {
+        current->hold.record(LockClock::now() - acquiredAt);
+        mutex.unlock();
+    }
+
+    // Отчёт по местам вызова, отсортированным по суммарному ожиданию
+    void report() const {
+        uint64_t acquisitions = 0, contended = 0;
+        for (const auto& s : sites) {
+            acquisitions += s->acquisitions;
+            contended += s->contended;
+        }
+        if (acquisitions == 0) return;
+
+        double scale = LockClock::nsPerTick() / 1000.0;
+        std::vector<const Site*> order;
+        for (const auto& s : sites) order.push_back(s.get());
+        std::sort(order.begin(), order.end(), [](const Site* a, const Site* b) {
+            return a->wait.mean() * a->wait.count() > b->wait.mean() * b->wait.count();
+        });
+
+        std::fprintf(stderr, "\n[lock stats] %s: %llu acquisitions, %llu contended (%.1f%%)\n", name,
+            static_cast<unsigned long long>(acquisitions), static_cast<unsigned long long>(contended),
+            100.0 * contended / acquisitions);
+        std::fprintf(stderr, "  %-28s %10s %10s %26s %26s\n", "call site", "acquired", "contended",
+            "wait us p50/p99/max", "hold us p50/p99/max");
+        for (const Site* s : order) {
+            char site[64];
+            std::snprintf(site, sizeof(site), "%s:%d", baseName(s->file), s->line);
+            char wait[48], hold[48];
+            std::snprintf(wait, sizeof(wait), "%.2f/%.2f/%.2f", s->wait.percentile(0.5) * scale,
+                s->wait.percentile(0.99) * scale, s->wait.maximum() * scale);
+            std::snprintf(hold, sizeof(hold), "%.2f/%.2f/%.2f", s->hold.percentile(0.5) * scale,
+                s->hold.percentile(0.99) * scale, s->hold.maximum() * scale);
+            std::fprintf(stderr, "  %-28s %10llu %10llu %26s %26s\n", site,
+                static_cast<unsigned long long>(s->acquisitions), static_cast<unsigned long long>(s->contended),
+                wait, hold);
+        }
+    }
+
+private:
+    struct Site {
+        const char* file = nullptr;
+        int line = 0;
+        uint64_t acquisitions = 0;
+        uint64_t contended = 0;
+        LatencyHistogram wait;   // только захваты с ожиданием
+        LatencyHistogram hold;
+    };
+
+    static const char* baseName(const char* path) {
+        const char* base = path;
+        for (const char* p = path; *p; ++p) {
+            if (*p == '/' || *p == '\\') base = p + 1;
+        }
+        return base;
+    }
+
+    // Вызывается, когда мьютекс уже захвачен
+    void acquired(const char* file, int line, uint64_t now, bool waited, uint64_t waitTicks) {
+        Site* site = nullptr;
+        for (const auto& s : sites) {
+            if (s->line == line && (s->file == file || std::strcmp(s->file, file) == 0)) {
+                site = s.get();
+                break;
+            }
+        }
+        if (!site) {
+            std::unique_ptr<Site> added(new Site());
+            added->file = file;
+            added->line = line;
+            sites.push_back(std::move(added));
+            site = sites.back().get();
+        }
+        site->acquisitions++;
+        if (waited) {
+            site->contended++;
+            site->wait.record(waitTicks);
+        }
+        current = site;
+        acquiredAt = now;
+    }
+
+    std::mutex mutex;
+    const char* name;
+    std::vector<std::unique_ptr<Site>> sites;
+    Site* current = nullptr;
+    uint64_t acquiredAt = 0;
+};
+
+#else
+
+class InstrumentedMutex {
+public:
+    explicit InstrumentedMutex(const char* = "mutex") {}
+    void lock(const char* = nullptr, int = 0) { mutex.lock(); }
+    bool try_lock(const char* = nullptr, int = 0) { return mutex.try_lock(); }
+    void unlock() { mutex.unlock(); }
+    void report() const {}
+
+private:
+    std::mutex mutex;
+};
+
+#endif
+
+// Замена std::lock_guard: место вызова берётся из строки, где создан guard
+class InstrumentedLock {
+public:
+    explicit InstrumentedLock(InstrumentedMutex& mutex, const char* file = __builtin_FILE(), int line = __builtin_LINE())
+        : mutex(mutex) {
+        mutex.lock(file, line);
+    }
+
+    ~InstrumentedLock() {
+        mutex.unlock();
+    }
+
+    InstrumentedLock(const InstrumentedLock&) = delete;
+    InstrumentedLock& operator=(const InstrumentedLock&) = delete;
+
+private:
+    InstrumentedMutex& mutex;
+};
@@ -0,0 +1,197 @@
+﻿#pragma once
+// Плотная матрица в одном блоке памяти, выровненном по 64 байтам, и
+// представления (view) её частей без копирования.
+// Каждая строка (Layout::RowMajor) или столбец (Layout::ColMajor) начинается с
+// границы кэш-линии: ведущая размерность ld округляется вверх до 64 байт, а если
+// строка получается кратной 4 КБ, добавляется ещё одна кэш-линия, чтобы при обходе
+// по столбцу соседние строки не попадали в одни и те же наборы кэша.
+// MatrixView задаёт элемент (i, j) как data[i * rowStride + j * colStride], поэтому
+// подматрица, диапазон строк и транспонирование - те же данные с другими началом
+// и шагами. Представление с colStride == 1 - это rows строк по cols элементов с
+// шагом ld: в MPI это MPI_Type_vector(rows, cols, ld), в SIMD-ядро - строки row(i).
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include "numa.h"
+
+enum class Layout { RowMajor, ColMajor };
+
+template <class T>
+class MatrixView {
+public:
+    MatrixView() = default;
+
+    MatrixView(T* data, int rows, int cols, std::ptrdiff_t rowStride, std::ptrdiff_t colStride)
+        : ptr(data), r(rows), c(cols), rs(rowStride), cs(colStride) {}
+
+    // Представление только для чтения из изменяемого
+    template <class U, class = typename std::enable_if<std::is_same<const U, T>::value>::type>
+    MatrixView(const MatrixView<U>& other)
+        : ptr(other.data()), r(other.rows()), c(other.cols()), rs(other.rowStride()), cs(other.colStride()) {}
+
+    int rows() const { return r; }
+    int cols() const { return c; }
+    T* data() const { return ptr; }
+    std::ptrdiff_t rowStride() const { return rs; }
+    std::ptrdiff_t colStride() const { return cs; }
+
+    // Элементы строки лежат подряд
+    bool rowMajor() const { return cs == 1; }
+    // Элементы столбца лежат подряд
+    bool colMajor() const { return rs == 1; }
+    // Шаг между строками (построчное хранение) или столбцами (по столбцам)
+    std::ptrdiff_t ld() const { return cs == 1 ? rs : cs; }
+
+    T& operator()(int i, int j) const { return ptr[i * rs + j * cs]; }
+    // Начало строки i; при rowMajor() её элементы идут подряд
+    T* row(int i) const { return ptr + i * rs; }
+    // Начало столбца j; при colMajor() его элементы идут подряд
+    T* col(int j) const { return ptr + j * cs; }
+
+    MatrixView block(int r0, int c0, int rows, int cols) const {
+        return MatrixView(ptr + r0 * rs + c0 * cs, rows, cols, rs, cs);
+    }
+    MatrixView rowRange(int r0, int r1) const { return block(r0, 0, r1 - r0, c); }
+    MatrixView colRange(int c0, int c1) const { return block(0, c0, r, c1 - c0); }
+    MatrixView transposed() const { return MatrixView(ptr, c, r, cs, rs); }
+
+    void fill(const T& value) const {
+        for (int i = 0; i < r; ++i) {
+            for (int j = 0; j < c; ++j) (*this)(i, j) = value;
+        }
+    }
+
+    // Копирование элементов из представления того же размера (в любой раскладке
+    // и с приведением типа элементов)
+    template <class U>
+    void assign(const MatrixView<U>& from) const {
+        for (int i = 0; i < r; ++i) {
+            for (int j = 0; j < c; ++j) (*this)(i, j) = static_cast<T>(from(i, j));
+        }
+    }
+
+private:
+    T* ptr = nullptr;
+    int r = 0, c = 0;
+    std::ptrdiff_t rs = 0, cs = 0;
+};
+
+template <class T>
+class Matrix {
+    static_assert(std::is_trivially_copyable<T>::value, "Matrix needs a trivially copyable element type");
+
+public:
+    static const size_t ALIGNMENT = 64;
+
+    Matrix() = default;
+
+    Matrix(int rows, int cols, Layout layout = Layout::RowMajor, const T& value = T())
+        : r(rows), c(cols), lay(layout), stride(paddedLd(layout == Layout::RowMajor ? cols : rows)) {
+        ptr = static_cast<T*>(::operator new(bytes(), std::align_val_t(ALIGNMENT)));
+        std::fill_n(ptr, elements(), value);
+    }
+
+    // Страницы размещаются по узлам NUMA, как у NumaArray: строки (столбцы при
+    // ColMajor) делятся между потоками OpenMP по schedule(static). Элементы нулевые
+    Matrix(int rows, int cols, const NumaOptions& numa, Layout layout = Layout::RowMajor)
+        : r(rows), c(cols), lay(layout), stride(paddedLd(layout == Layout::RowMajor ? cols : rows)),
+        numaPlaced(true) {
+        ptr = static_cast<T*>(numaAllocate(bytes(), numa));
+        numaTouch(ptr, elements(), numa, static_cast<size_t>(stride));
+    }
+
+    Matrix(const Matrix& other) : r(other.r), c(other.c), lay(other.lay), stride(other.stride) {
+        ptr = static_cast<T*>(::operator new(bytes(), std::align_val_t(ALIGNMENT)));
+        if (elements() > 0) std::memcpy(ptr, other.ptr, bytes());
+    }
+
+    Matrix(Matrix&& other) noexcept {
+        swap(other);
+    }
+
+    Matrix& operator=(Matrix other) noexcept {
+        swap(other);
+        return *this;
+    }
+
+    ~Matrix() {
+        if (!ptr) return;
+        if (numaPlaced) numaRelease(ptr, bytes());
+        else ::operator delete(ptr, std::align_val_t(ALIGNMENT));
+    }
+
+    void swap(Matrix& other) noexcept {
+        std::swap(ptr, other.ptr);
+        std::swap(r, other.r);
+        std::swap(c, other.c);
+        std::swap(lay, other.lay);
+        std::swap(stride, other.stride);
+        std::swap(numaPlaced, other.numaPlaced);
+    }
+
+    // Ведущая размерность для n элементов: кратна 64 байтам и не кратна 4 КБ
+    static std::ptrdiff_t paddedLd(int n) {
+        const std::ptrdiff_t line = (std::max)(std::ptrdiff_t(1), static_cast<std::ptrdiff_t>(ALIGNMENT / sizeof(T)));
+        std::ptrdiff_t ld = (n + line - 1) / line * line;
+        if (ld > 0 && ld * sizeof(T) % 4096 == 0) ld += line;
+        return (std::max)(ld, line);
+    }
+
+    int rows() const { return r; }
+    int cols() const { return c; }
+    Layout layout() const { return lay; }
+    std::ptrdiff_t ld() const { return stride; }
+    T* data() { return ptr; }
+    const T* data() const { return ptr; }
+
+    T& operator()(int i, int j) { return ptr[offset(i, j)]; }
+    const T& operator()(int i, int j) const { return ptr[offset(i, j)]; }
+
+    // Строка i подряд в памяти (только для RowMajor)
+    T* row(int i) { return ptr + i * stride; }
+    const T* row(int i) const { return ptr + i * stride; }
+    // Столбец j подряд в памяти (только для ColMajor)
+    T* col(int j) { return ptr + j * stride; }
+    const T* col(int j) const { return ptr + j * stride; }
+
+    MatrixView<T> view() {
+        return lay == Layout::RowMajor ? MatrixView<T>(ptr, r, c, stride, 1) : MatrixView<T>(ptr, r, c, 1, stride);
+    }
+    MatrixView<const T> view() const {
+        return lay == Layout::RowMajor ? MatrixView<const T>(ptr, r, c, stride, 1)
+            : MatrixView<const T>(ptr, r, c, 1, stride);
+    }
+
+    MatrixView<T> block(int r0, int c0, int rows, int cols) { return view().block(r0, c0, rows, cols); }
+    MatrixView<const T> block(int r0, int c0, int rows, int cols) const { return view().block(r0, c0, rows, cols); }
+    MatrixView<T> rowRange(int r0, int r1) { return view().rowRange(r0, r1); }
+    MatrixView<const T> rowRange(int r0, int r1) const { return view().rowRange(r0, r1); }
+    MatrixView<T> colRange(int c0, int c1) { return view().colRange(c0, c1); }
+    MatrixView<const T> colRange(int c0, int c1) const { return view().colRange(c0, c1); }
+    MatrixView<T> transposed() { return view().transposed(); }
+    MatrixView<const T> transposed() const { return view().transposed(); }
+
+    void fill(const T& value) {
+        std::fill_n(ptr, elements(), value);
+    }
+
+    // Размер блока памяти вместе с выравнивающими элементами
+    size_t bytes() const { return elements() * sizeof(T); }
+
+private:
+    T* ptr = nullptr;
+    int r = 0, c = 0;
+    Layout lay = Layout::RowMajor;
+    std::ptrdiff_t stride = 0;
+    bool numaPlaced = false;
+
+    std::ptrdiff_t offset(int i, int j) const {
+        return lay == Layout::RowMajor ? i * stride + j : j * stride + i;
+    }
+    size_t elements() const {
+        return static_cast<size_t>(lay == Layout::RowMajor ? r : c) * static_cast<size_t>(stride);
+    }
+};
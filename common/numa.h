@@ -0,0 +1,581 @@
+﻿#pragma once
+// Размещение больших массивов по узлам NUMA и закрепление потоков OpenMP.
+// Страница попадает на узел того потока, который первым в неё записал (first
+// touch), поэтому NumaArray обнуляет массив параллельным циклом с тем же
+// schedule(static) и тем же числом итераций, что и вычислительный цикл: каждый
+// поток потом читает свои строки из локальной памяти. Закрепление нужно, чтобы
+// поток не переехал на другой сокет между инициализацией и вычислением.
+//
+// Флаги (разбирает NumaOptions::parse):
+//   --numa <first-touch|serial|interleave|bind:N>
+//                           размещение страниц: параллельно по потокам (по умолчанию),
+//                           главным потоком (как раньше), по кругу по всем узлам, на узле N.
+//                           Несуществующий узел или неизвестное значение - first-touch
+//                           с предупреждением; если ядро отвергло mbind, отчёт это покажет
+//   --numa-bind <auto|none|close|spread>
+//                           закрепление потоков OpenMP; auto - spread, если узлов больше
+//                           одного. Если задан OMP_PROC_BIND или OMP_PLACES, потоки
+//                           закрепляет сама среда OpenMP
+//   --numa-places <cores|sockets>
+//                           поток закрепляется за одним процессором или за всем узлом
+//   --numa-report           напечатать топологию, размещение страниц и пропускную
+//                           способность памяти каждого сокета
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <new>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#if defined(_WIN32)
+#include <windows.h>
+#elif defined(__linux__)
+#include <linux/mempolicy.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+enum class NumaPolicy { FirstTouch, Serial, Interleave, Bind };
+
+struct NumaNode {
+    int id = 0;
+    std::vector<int> cpus;
+};
+
+inline const std::vector<NumaNode>& numaNodes();
+
+struct NumaOptions {
+    NumaPolicy policy = NumaPolicy::FirstTouch;
+    int node = 0;                 // узел для NumaPolicy::Bind
+    std::string bind = "auto";    // auto, none, close, spread
+    std::string places = "cores"; // cores, sockets
+    bool report = false;
+
+    // Разбор одного флага; true, если argv[i] (и его значение) обработан
+    bool parse(int& i, int argc, char** argv) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if (arg == "--numa" && hasValue) {
+            std::string v = argv[++i];
+            if (v == "serial") policy = NumaPolicy::Serial;
+            else if (v == "interleave") policy = NumaPolicy::Interleave;
+            else if (v.compare(0, 5, "bind:") == 0) {
+                policy = NumaPolicy::FirstTouch;
+                char* end = nullptr;
+                long n = std::strtol(v.c_str() + 5, &end, 10);
+                bool known = false;
+                for (const NumaNode& candidate : numaNodes()) known = known || candidate.id == n;
+                if (end != v.c_str() + 5 && *end == 0 && known) {
+                    policy = NumaPolicy::Bind;
+                    node = static_cast<int>(n);
+                }
+                else {
+                    std::cerr << "--numa " << v << ": no such NUMA node (nodes:";
+                    for (const NumaNode& candidate : numaNodes()) std::cerr << " " << candidate.id;
+                    std::cerr << "); using first-touch" << std::endl;
+                }
+            }
+            else {
+                if (v != "first-touch") {
+                    std::cerr << "--numa " << v << " is not one of first-touch, serial, interleave, bind:N;"
+                        << " using first-touch" << std::endl;
+                }
+                policy = NumaPolicy::FirstTouch;
+            }
+        }
+        else if (arg == "--numa-bind" && hasValue) {
+            bind = argv[++i];
+        }
+        else if (arg == "--numa-places" && hasValue) {
+            places = argv[++i];
+        }
+        else if (arg == "--numa-report") {
+            report = true;
+        }
+        else {
+            return false;
+        }
+        return true;
+    }
+
+    std::string policyName() const {
+        switch (policy) {
+        case NumaPolicy::Serial: return "serial";
+        case NumaPolicy::Interleave: return "interleave";
+        case NumaPolicy::Bind: return "bind:" + std::to_string(node);
+        default: return "first-touch";
+        }
+    }
+};
+
+// "0-3,8-11" -> 0 1 2 3 8 9 10 11
+inline std::vector<int> numaParseList(const std::string& text) {
+    std::vector<int> values;
+    std::stringstream in(text);
+    std::string range;
+    while (std::getline(in, range, ',')) {
+        if (range.empty() || range[0] < '0' || range[0] > '9') continue;
+        size_t dash = range.find('-');
+        int first = std::atoi(range.c_str());
+        int last = dash == std::string::npos ? first : std::atoi(range.c_str() + dash + 1);
+        for (int v = first; v <= last; ++v) values.push_back(v);
+    }
+    return values;
+}
+
+// Узлы с процессорами; без поддержки NUMA - один узел со всеми процессорами
+inline const std::vector<NumaNode>& numaNodes() {
+    static const std::vector<NumaNode> nodes = [] {
+        std::vector<NumaNode> found;
+#if defined(_WIN32)
+        ULONG highest = 0;
+        if (GetNumaHighestNodeNumber(&highest)) {
+            for (ULONG n = 0; n <= highest; ++n) {
+                ULONGLONG mask = 0;
+                if (!GetNumaNodeProcessorMask(static_cast<UCHAR>(n), &mask) || mask == 0) continue;
+                NumaNode node;
+                node.id = static_cast<int>(n);
+                for (int cpu = 0; cpu < 64; ++cpu) {
+                    if (mask & (ULONGLONG(1) << cpu)) node.cpus.push_back(cpu);
+                }
+                found.push_back(node);
+            }
+        }
+#elif defined(__linux__)
+        std::ifstream online("/sys/devices/system/node/online");
+        std::string list;
+        if (online && std::getline(online, list)) {
+            for (int n : numaParseList(list)) {
+                std::ifstream cpulist("/sys/devices/system/node/node" + std::to_string(n) + "/cpulist");
+                std::string cpus;
+                NumaNode node;
+                node.id = n;
+                if (cpulist && std::getline(cpulist, cpus)) node.cpus = numaParseList(cpus);
+                if (!node.cpus.empty()) found.push_back(node);
+            }
+        }
+#endif
+        if (found.empty()) {
+            NumaNode node;
+            int cpus = (std::max)(1u, std::thread::hardware_concurrency());
+            for (int cpu = 0; cpu < cpus; ++cpu) node.cpus.push_back(cpu);
+            found.push_back(node);
+        }
+        return found;
+    }();
+    return nodes;
+}
+
+inline int numaNodeOfCpu(int cpu) {
+    for (const NumaNode& node : numaNodes()) {
+        if (std::find(node.cpus.begin(), node.cpus.end(), cpu) != node.cpus.end()) return node.id;
+    }
+    return -1;
+}
+
+// Закрепление текущего потока за набором логических процессоров
+inline bool numaPinCurrentThread(const std::vector<int>& cpus) {
+#if defined(_WIN32)
+    DWORD_PTR mask = 0;
+    for (int cpu : cpus) mask |= DWORD_PTR(1) << cpu;
+    return mask != 0 && SetThreadAffinityMask(GetCurrentThread(), mask) != 0;
+#elif defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu : cpus) CPU_SET(cpu, &set);
+    return !cpus.empty() && pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+    (void)cpus;
+    return false;
+#endif
+}
+
+inline int numaCurrentCpu() {
+#if defined(_WIN32)
+    return static_cast<int>(GetCurrentProcessorNumber());
+#elif defined(__linux__)
+    return sched_getcpu();
+#else
+    return -1;
+#endif
+}
+
+// Процессор, на котором был каждый поток OpenMP после numaBindThreads
+inline std::vector<int>& numaThreadCpus() {
+    static std::vector<int> cpus;
+    return cpus;
+}
+
+// Закрепляет потоки OpenMP по --numa-bind и --numa-places. Вызывается после
+// omp_set_num_threads и до выделения массивов: те же потоки затем и
+// инициализируют страницы, и считают. Возвращает описание режима для отчёта
+inline std::string numaBindThreads(const NumaOptions& options) {
+    const std::vector<NumaNode>& nodes = numaNodes();
+    std::string bind = options.bind;
+    if (bind == "auto") bind = nodes.size() > 1 ? "spread" : "none";
+    std::string mode = bind;
+
+#ifdef _OPENMP
+    if (omp_get_proc_bind() != omp_proc_bind_false) {
+        bind = "none";
+        mode = "OpenMP runtime (OMP_PROC_BIND/OMP_PLACES)";
+    }
+
+    // Места в порядке узлов: по процессору или по целому узлу
+    std::vector<std::vector<int>> places;
+    for (const NumaNode& node : nodes) {
+        if (options.places == "sockets") places.push_back(node.cpus);
+        else for (int cpu : node.cpus) places.push_back({ cpu });
+    }
+    if (bind != "none") mode += ", places " + options.places;
+
+    int threads = omp_get_max_threads();
+    numaThreadCpus().assign(threads, -1);
+#pragma omp parallel
+    {
+        int t = omp_get_thread_num();
+        int count = omp_get_num_threads();
+        int p = static_cast<int>(places.size());
+        // close - соседние потоки на соседних местах, spread - равномерно по всем местам,
+        // как в OMP_PROC_BIND; при нехватке мест подряд идущие потоки делят место
+        if (bind == "close" || bind == "spread") {
+            int place = bind == "close" && count <= p ? t : static_cast<int>(static_cast<long long>(t) * p / count);
+            numaPinCurrentThread(places[place % p]);
+        }
+        if (t < static_cast<int>(numaThreadCpus().size())) numaThreadCpus()[t] = numaCurrentCpu();
+    }
+#else
+    mode = "none (built without OpenMP)";
+#endif
+    return mode;
+}
+
+// Почему политика interleave/bind не применилась (пусто - применилась): тогда
+// страницы размещаются первой записью, как при first-touch
+inline std::string& numaPlacementError() {
+    static std::string error;
+    return error;
+}
+
+// Выделение памяти под политику размещения. Страницы ещё не тронуты, узел
+// для first-touch и serial определяется первой записью
+inline void* numaAllocate(size_t bytes, const NumaOptions& options) {
+    if (bytes == 0) bytes = 1;
+#if defined(_WIN32)
+    HANDLE process = GetCurrentProcess();
+    if (options.policy == NumaPolicy::Bind) {
+        void* p = VirtualAllocExNuma(process, nullptr, bytes, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE,
+            static_cast<DWORD>(options.node));
+        if (!p) throw std::bad_alloc();
+        return p;
+    }
+    if (options.policy != NumaPolicy::Interleave) {
+        void* p = VirtualAlloc(nullptr, bytes, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+        if (!p) throw std::bad_alloc();
+        return p;
+    }
+    // Чередование: страницы по кругу получают предпочтительный узел
+    char* base = static_cast<char*>(VirtualAlloc(nullptr, bytes, MEM_RESERVE, PAGE_READWRITE));
+    if (!base) throw std::bad_alloc();
+    const std::vector<NumaNode>& nodes = numaNodes();
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    size_t page = info.dwPageSize;
+    for (size_t offset = 0, k = 0; offset < bytes; offset += page, ++k) {
+        DWORD node = static_cast<DWORD>(nodes[k % nodes.size()].id);
+        if (!VirtualAllocExNuma(process, base + offset, (std::min)(page, bytes - offset), MEM_COMMIT,
+            PAGE_READWRITE, node)) {
+            VirtualFree(base, 0, MEM_RELEASE);
+            throw std::bad_alloc();
+        }
+    }
+    return base;
+#elif defined(__linux__)
+    void* p = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED) throw std::bad_alloc();
+    if (options.policy == NumaPolicy::Interleave || options.policy == NumaPolicy::Bind) {
+        // Маска узлов любой длины; ядро читает maxnode - 1 бит, поэтому
+        // старший узел должен быть строго ниже последнего бита маски
+        const int bits = static_cast<int>(sizeof(unsigned long) * 8);
+        std::vector<int> ids;
+        if (options.policy == NumaPolicy::Bind) ids.push_back(options.node);
+        else for (const NumaNode& node : numaNodes()) ids.push_back(node.id);
+        int highest = *std::max_element(ids.begin(), ids.end());
+        std::vector<unsigned long> mask(static_cast<size_t>(highest + 1) / bits + 1, 0);
+        for (int id : ids) mask[id / bits] |= 1UL << (id % bits);
+        unsigned long maxnode = static_cast<unsigned long>(mask.size()) * bits;
+
+        int mode = options.policy == NumaPolicy::Bind ? MPOL_BIND : MPOL_INTERLEAVE;
+        if (syscall(__NR_mbind, p, bytes, mode, mask.data(), maxnode, 0) != 0) {
+            // Например, ядро без поддержки NUMA: память остаётся first-touch
+            std::string& error = numaPlacementError();
+            if (error.empty()) {
+                error = std::string("mbind: ") + std::strerror(errno);
+                std::cerr << "NUMA policy " << options.policyName() << " was not applied (" << error
+                    << "); pages are placed by first touch" << std::endl;
+            }
+        }
+    }
+    return p;
+#else
+    (void)options;
+    void* p = std::malloc(bytes);
+    if (!p) throw std::bad_alloc();
+    return p;
+#endif
+}
+
+inline void numaRelease(void* p, size_t bytes) {
+    if (!p) return;
+#if defined(_WIN32)
+    (void)bytes;
+    VirtualFree(p, 0, MEM_RELEASE);
+#elif defined(__linux__)
+    munmap(p, bytes == 0 ? 1 : bytes);
+#else
+    (void)bytes;
+    std::free(p);
+#endif
+}
+
+// Число страниц области памяти на каждом узле (индекс - номер узла); пусто,
+// если узнать нельзя (не Linux или ядро без move_pages)
+inline std::vector<size_t> numaPagesPerNode(const void* data, size_t bytes) {
+    std::vector<size_t> pages;
+#if defined(__linux__)
+    size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    uintptr_t first = reinterpret_cast<uintptr_t>(data) / pageSize * pageSize;
+    uintptr_t last = reinterpret_cast<uintptr_t>(data) + bytes;
+    size_t total = bytes == 0 ? 0 : (last - first + pageSize - 1) / pageSize;
+    const size_t batch = 4096;
+    std::vector<void*> addresses(batch);
+    std::vector<int> status(batch);
+    for (size_t done = 0; done < total; done += batch) {
+        size_t n = (std::min)(batch, total - done);
+        for (size_t k = 0; k < n; ++k) {
+            addresses[k] = reinterpret_cast<void*>(first + (done + k) * pageSize);
+        }
+        if (syscall(__NR_move_pages, 0, n, addresses.data(), nullptr, status.data(), 0) != 0) return {};
+        for (size_t k = 0; k < n; ++k) {
+            if (status[k] < 0) continue;
+            if (static_cast<size_t>(status[k]) >= pages.size()) pages.resize(status[k] + 1);
+            pages[status[k]]++;
+        }
+    }
+#else
+    (void)data;
+    (void)bytes;
+#endif
+    return pages;
+}
+
+// Первая запись в память по политике размещения: count элементов обнуляются
+// так же, как их будет обходить вычислительный цикл, - count / grain итераций
+// по grain элементов (grain - длина строки для циклов по строкам матрицы)
+// с schedule(static)
+template <class T>
+void numaTouch(T* p, size_t count, const NumaOptions& options, size_t grain = 1) {
+    grain = (std::max)(grain, size_t(1));
+    long long units = static_cast<long long>((count + grain - 1) / grain);
+    auto touch = [p, count, grain](long long u) {
+        size_t first = static_cast<size_t>(u) * grain;
+        size_t last = (std::min)(count, first + grain);
+        for (size_t i = first; i < last; ++i) p[i] = T();
+    };
+    if (options.policy == NumaPolicy::Serial) {
+        for (long long u = 0; u < units; ++u) touch(u);
+    }
+    else {
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+        for (long long u = 0; u < units; ++u) touch(u);
+    }
+}
+
+// Массив в памяти с заданным размещением, элементы обнуляются через numaTouch
+template <class T>
+class NumaArray {
+    static_assert(std::is_trivially_copyable<T>::value, "NumaArray needs a trivially copyable element type");
+
+public:
+    NumaArray() = default;
+
+    NumaArray(size_t count, const NumaOptions& options, size_t grain = 1)
+        : ptr(static_cast<T*>(numaAllocate(count * sizeof(T), options))), count(count) {
+        numaTouch(ptr, count, options, grain);
+    }
+
+    ~NumaArray() {
+        numaRelease(ptr, count * sizeof(T));
+    }
+
+    NumaArray(NumaArray&& other) noexcept : ptr(other.ptr), count(other.count) {
+        other.ptr = nullptr;
+        other.count = 0;
+    }
+
+    NumaArray& operator=(NumaArray&& other) noexcept {
+        std::swap(ptr, other.ptr);
+        std::swap(count, other.count);
+        return *this;
+    }
+
+    NumaArray(const NumaArray&) = delete;
+    NumaArray& operator=(const NumaArray&) = delete;
+
+    T* data() { return ptr; }
+    const T* data() const { return ptr; }
+    size_t size() const { return count; }
+    T& operator[](size_t i) { return ptr[i]; }
+    const T& operator[](size_t i) const { return ptr[i]; }
+    T* begin() { return ptr; }
+    T* end() { return ptr + count; }
+    const T* begin() const { return ptr; }
+    const T* end() const { return ptr + count; }
+
+    size_t bytes() const { return count * sizeof(T); }
+
+private:
+    T* ptr = nullptr;
+    size_t count = 0;
+};
+
+// Пропускная способность триады a = b + s * c, когда все процессоры узла
+// cpuNode работают с памятью узла memNode, Б/с (лучший из нескольких замеров)
+inline double numaTriadBandwidth(const NumaNode& cpuNode, int memNode) {
+    const size_t n = size_t(1) << 23;
+    NumaOptions placement;
+    placement.policy = NumaPolicy::Bind;
+    placement.node = memNode;
+    NumaArray<double> a(n, placement), b(n, placement), c(n, placement);
+    for (size_t i = 0; i < n; ++i) {
+        b[i] = 1.0;
+        c[i] = 2.0;
+    }
+
+    int threads = static_cast<int>(cpuNode.cpus.size());
+    double best = 0;
+    for (int repeat = 0; repeat < 4; ++repeat) {
+        std::mutex mutex;
+        std::condition_variable started;
+        int ready = 0;
+        bool go = false;
+        std::vector<double> seconds(threads, 0.0);
+        std::vector<std::thread> workers;
+        for (int t = 0; t < threads; ++t) {
+            workers.emplace_back([&, t] {
+                numaPinCurrentThread({ cpuNode.cpus[t] });
+                size_t first = n * t / threads, last = n * (t + 1) / threads;
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    if (++ready == threads) {
+                        go = true;
+                        started.notify_all();
+                    }
+                    started.wait(lock, [&] { return go; });
+                }
+                auto begin = std::chrono::steady_clock::now();
+                for (size_t i = first; i < last; ++i) a[i] = b[i] + 3.0 * c[i];
+                seconds[t] = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+            });
+        }
+        for (std::thread& w : workers) w.join();
+        double slowest = *std::max_element(seconds.begin(), seconds.end());
+        if (slowest > 0) best = (std::max)(best, 24.0 * n / slowest);
+    }
+    volatile double sink = a[n / 2];
+    (void)sink;
+    return best;
+}
+
+// Отчёт --numa-report: топология, закрепление потоков, размещение страниц
+// массивов программы и пропускная способность памяти по сокетам
+class NumaReport {
+public:
+    NumaReport(std::string program, const NumaOptions& options, std::string binding)
+        : program(std::move(program)), options(options), binding(std::move(binding)) {}
+
+    // Массив с data() и bytes(): NumaArray или Matrix
+    template <class Array>
+    void add(const std::string& name, const Array& array) {
+        arrays.push_back({ name, numaPagesPerNode(array.data(), array.bytes()) });
+    }
+
+    void print(std::ostream& out) const {
+        const std::vector<NumaNode>& nodes = numaNodes();
+        out << "NUMA: " << program << ", " << nodes.size() << " node(s), policy " << options.policyName();
+        if (!numaPlacementError().empty()) out << " (not applied: " << numaPlacementError() << "; first touch)";
+        out << ", thread binding " << binding << std::endl;
+        for (const NumaNode& node : nodes) {
+            out << "  node " << node.id << ": " << node.cpus.size() << " cpu(s)" << std::endl;
+        }
+
+        const std::vector<int>& cpus = numaThreadCpus();
+        if (!cpus.empty()) {
+            out << "  threads (cpu/node):";
+            for (size_t t = 0; t < cpus.size(); ++t) {
+                out << " " << t << "->" << cpus[t] << "/" << numaNodeOfCpu(cpus[t]);
+            }
+            out << std::endl;
+        }
+
+        size_t width = 5;
+        for (const auto& a : arrays) width = (std::max)(width, a.first.size());
+        out << "Pages per node:" << std::endl;
+        for (const auto& a : arrays) {
+            out << "  " << std::left << std::setw(width) << a.first << std::right;
+            size_t total = 0;
+            for (size_t p : a.second) total += p;
+            if (total == 0) {
+                out << "  unknown" << std::endl;
+                continue;
+            }
+            for (size_t n = 0; n < a.second.size(); ++n) {
+                if (a.second[n] == 0) continue;
+                out << "  node " << n << ": " << std::fixed << std::setprecision(1)
+                    << 100.0 * a.second[n] / total << "%";
+            }
+            out << std::endl;
+        }
+
+        // Строки - узел, на котором работают потоки, столбцы - узел с памятью;
+        // диагональ - локальная пропускная способность сокета
+        out << "Triad bandwidth, GB/s (row: cpu node, column: memory node):" << std::endl;
+        out << "        ";
+        for (const NumaNode& mem : nodes) out << std::setw(9) << ("mem " + std::to_string(mem.id));
+        out << std::endl;
+        for (const NumaNode& cpu : nodes) {
+            out << std::left << std::setw(8) << ("cpu " + std::to_string(cpu.id)) << std::right;
+            for (const NumaNode& mem : nodes) {
+                out << std::setw(9) << std::fixed << std::setprecision(2) << numaTriadBandwidth(cpu, mem.id) / 1e9;
+            }
+            out << std::endl;
+        }
+        out << std::defaultfloat << std::setprecision(6) << std::endl;
+    }
+
+private:
+    std::string program;
+    NumaOptions options;
+    std::string binding;
+    std::vector<std::pair<std::string, std::vector<size_t>>> arrays;
+};
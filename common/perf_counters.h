@@ -0,0 +1,362 @@
+﻿#pragma once
+// Аппаратные счётчики вокруг именованных участков кода (perf_event_open, Linux).
+// PerfRegion region("имя"); - от конструктора до деструктора считаются такты,
+// инструкции, промахи L1D и LLC, ошибки предсказания переходов и такты простоя,
+// отдельно для каждого потока. Счётчики, которые не удалось открыть (не Linux,
+// perf_event_paranoid, виртуальная машина без PMU) или ни разу не попавшие на PMU
+// за время участка, печатаются как "-", время участка считается всегда.
+// Участки включаются переменной окружения PERF_REGIONS=1, отчёт печатается в
+// stderr при выходе из программы; без неё участки ничего не считают и не печатают.
+// С -DPERF_REGIONS_OFF участки не компилируются вовсе.
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+#if defined(__linux__)
+#include <cerrno>
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#ifndef PERF_REGIONS_OFF
+
+// Участки включены переменной окружения PERF_REGIONS (любое значение, кроме 0)
+inline bool perfRegionsEnabled() {
+    static const bool enabled = [] {
+        const char* value = std::getenv("PERF_REGIONS");
+        return value && *value && std::strcmp(value, "0") != 0;
+    }();
+    return enabled;
+}
+
+// Показания счётчиков участка: значения и признак, что счётчик работал
+struct PerfCounts {
+    static const int EVENTS = 8;
+    double value[EVENTS] = {};
+    bool valid[EVENTS] = {};
+};
+
+// Порядок событий совпадает со столбцами отчёта
+inline const char* perfEventName(int e) {
+    static const char* names[PerfCounts::EVENTS] = {
+        "cycles", "instr", "br miss", "stall FE", "stall BE", "L1D miss", "LLC miss", "task ms"
+    };
+    return names[e];
+}
+
+// Счётчики одного потока. События разбиты на группы, которые помещаются в
+// счётчики PMU одновременно; при нехватке счётчиков ядро мультиплексирует
+// группы, и значения масштабируются по доле времени, когда группа считала.
+// Группа читается одним read() у лидера (PERF_FORMAT_GROUP)
+class PerfThreadCounters {
+public:
+    struct Reading {
+        uint64_t value = 0, enabled = 0, running = 0;
+    };
+
+    PerfThreadCounters() {
+        for (int e = 0; e < PerfCounts::EVENTS; ++e) {
+            fds[e] = -1;
+            group[e] = -1;
+            slot[e] = -1;
+        }
+        for (int g = 0; g < GROUPS; ++g) {
+            leaders[g] = -1;
+            members[g] = 0;
+        }
+#if defined(__linux__)
+        struct EventInfo { uint32_t type; uint64_t config; int group; };
+        const uint64_t l1dReadMiss = PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+            (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+        const EventInfo events[PerfCounts::EVENTS] = {
+            { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES, 0 },
+            { PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS, 0 },
+            { PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES, 0 },
+            { PERF_TYPE_HARDWARE, PERF_COUNT_HW_STALLED_CYCLES_FRONTEND, 0 },
+            { PERF_TYPE_HARDWARE, PERF_COUNT_HW_STALLED_CYCLES_BACKEND, 0 },
+            { PERF_TYPE_HW_CACHE, l1dReadMiss, 1 },
+            { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES, 1 },
+            { PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK, 2 },
+        };
+
+        // Первое открывшееся событие группы становится её лидером
+        for (int e = 0; e < PerfCounts::EVENTS; ++e) {
+            perf_event_attr attr;
+            std::memset(&attr, 0, sizeof(attr));
+            attr.size = sizeof(attr);
+            attr.type = events[e].type;
+            attr.config = events[e].config;
+            attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+
+            int g = events[e].group;
+            fds[e] = static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, leaders[g], 0));
+            if (fds[e] < 0) {
+                if (error.empty()) error = std::string(perfEventName(e)) + ": " + std::strerror(errno);
+                continue;
+            }
+            if (leaders[g] < 0) leaders[g] = fds[e];
+            // Значения в ответе группы идут в порядке добавления событий
+            group[e] = g;
+            slot[e] = members[g]++;
+        }
+#else
+        error = "perf_event_open is not available on this platform";
+#endif
+    }
+
+    ~PerfThreadCounters() {
+#if defined(__linux__)
+        for (int fd : fds) {
+            if (fd >= 0) close(fd);
+        }
+#endif
+    }
+
+    PerfThreadCounters(const PerfThreadCounters&) = delete;
+    PerfThreadCounters& operator=(const PerfThreadCounters&) = delete;
+
+    void read(Reading (&out)[PerfCounts::EVENTS]) const {
+        for (int e = 0; e < PerfCounts::EVENTS; ++e) out[e] = Reading();
+#if defined(__linux__)
+        // Ответ группы: число событий, время включения и работы, значения
+        uint64_t raw[3 + PerfCounts::EVENTS];
+        for (int g = 0; g < GROUPS; ++g) {
+            if (leaders[g] < 0) continue;
+            ssize_t size = static_cast<ssize_t>((3 + members[g]) * sizeof(uint64_t));
+            if (::read(leaders[g], raw, sizeof(raw)) != size || raw[0] != static_cast<uint64_t>(members[g])) continue;
+            for (int e = 0; e < PerfCounts::EVENTS; ++e) {
+                if (group[e] != g) continue;
+                out[e].value = raw[3 + slot[e]];
+                out[e].enabled = raw[1];
+                out[e].running = raw[2];
+            }
+        }
+#endif
+    }
+
+    bool available(int e) const { return fds[e] >= 0; }
+    // Причина, по которой не открылся первый из недоступных счётчиков
+    const std::string& failure() const { return error; }
+
+    // Разность показаний с поправкой на мультиплексирование. false - группа ни разу
+    // не считала за участок (не попала на PMU или не прочиталась), значение неизвестно
+    static bool delta(const Reading& from, const Reading& to, double& value) {
+        value = static_cast<double>(to.value - from.value);
+        double enabled = static_cast<double>(to.enabled - from.enabled);
+        double running = static_cast<double>(to.running - from.running);
+        if (running <= 0) return false;
+        if (running < enabled) value = value * enabled / running;
+        return true;
+    }
+
+private:
+    static const int GROUPS = 3;
+
+    int fds[PerfCounts::EVENTS];
+    int group[PerfCounts::EVENTS];
+    int slot[PerfCounts::EVENTS];
+    int leaders[GROUPS];
+    int members[GROUPS];
+    std::string error;
+};
+
+// Итоги по участкам и потокам; печатаются при выходе из программы, если участки
+// включены
+class PerfRegistry {
+public:
+    static PerfRegistry& instance() {
+        static PerfRegistry registry;
+        return registry;
+    }
+
+    ~PerfRegistry() {
+        report();
+    }
+
+    // Подпись отчёта, например номер процесса MPI
+    void setLabel(const std::string& text) {
+        std::lock_guard<std::mutex> lock(mutex);
+        label = text;
+    }
+
+    void add(const char* region, int thread, double wallSeconds, const PerfCounts& counts) {
+        std::lock_guard<std::mutex> lock(mutex);
+        Totals& t = totals[{ region, thread }];
+        if (t.calls == 0) {
+            for (int e = 0; e < PerfCounts::EVENTS; ++e) t.counts.valid[e] = counts.valid[e];
+        }
+        t.calls++;
+        t.wall += wallSeconds;
+        for (int e = 0; e < PerfCounts::EVENTS; ++e) {
+            t.counts.value[e] += counts.value[e];
+            t.counts.valid[e] = t.counts.valid[e] && counts.valid[e];
+        }
+    }
+
+    void noteFailure(const std::string& reason) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (failure.empty()) failure = reason;
+    }
+
+    int nextThread() {
+        return threads++;
+    }
+
+    void report() {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (totals.empty()) return;
+
+        std::string prefix = label.empty() ? "[perf]" : "[perf] " + label + ":";
+        if (!failure.empty()) {
+            std::fprintf(stderr, "\n%s some counters are unavailable (%s)\n", prefix.c_str(), failure.c_str());
+        }
+        int width = 6;
+        for (const auto& kv : totals) width = (std::max)(width, static_cast<int>(kv.first.first.size()));
+
+        std::fprintf(stderr, "\n%s counters per region and thread\n", prefix.c_str());
+        std::fprintf(stderr, "  %-*s %6s %7s %10s", width, "region", "thread", "calls", "wall ms");
+        for (int e = 0; e < PerfCounts::EVENTS; ++e) {
+            std::fprintf(stderr, " %9s", perfEventName(e));
+            if (e == 1) std::fprintf(stderr, " %5s", "IPC");
+        }
+        std::fprintf(stderr, "\n");
+
+        // Строки потоков и итог по участку, если потоков больше одного
+        auto it = totals.begin();
+        while (it != totals.end()) {
+            const std::string& region = it->first.first;
+            Totals sum;
+            for (int e = 0; e < PerfCounts::EVENTS; ++e) sum.counts.valid[e] = true;
+            int rows = 0;
+            for (; it != totals.end() && it->first.first == region; ++it, ++rows) {
+                printRow(width, region, std::to_string(it->first.second), it->second);
+                sum.calls += it->second.calls;
+                sum.wall += it->second.wall;
+                for (int e = 0; e < PerfCounts::EVENTS; ++e) {
+                    sum.counts.value[e] += it->second.counts.value[e];
+                    sum.counts.valid[e] = sum.counts.valid[e] && it->second.counts.valid[e];
+                }
+            }
+            if (rows > 1) printRow(width, region, "all", sum);
+        }
+        totals.clear();
+    }
+
+private:
+    struct Totals {
+        long long calls = 0;
+        double wall = 0;
+        PerfCounts counts;
+    };
+
+    std::mutex mutex;
+    std::map<std::pair<std::string, int>, Totals> totals;
+    std::string label;
+    std::string failure;
+    std::atomic<int> threads{ 0 };
+
+    // 1234567 -> "1.23M"
+    static std::string compact(double v) {
+        const char* suffix[] = { "", "K", "M", "G", "T" };
+        int s = 0;
+        while (v >= 1000 && s < 4) {
+            v /= 1000;
+            s++;
+        }
+        char text[32];
+        std::snprintf(text, sizeof(text), s ? "%.2f%s" : "%.0f%s", v, suffix[s]);
+        return text;
+    }
+
+    static void printRow(int width, const std::string& region, const std::string& thread, const Totals& t) {
+        std::fprintf(stderr, "  %-*s %6s %7lld %10.2f", width, region.c_str(), thread.c_str(), t.calls, t.wall * 1e3);
+        for (int e = 0; e < PerfCounts::EVENTS; ++e) {
+            double v = t.counts.value[e];
+            if (!t.counts.valid[e]) std::fprintf(stderr, " %9s", "-");
+            else if (e == PerfCounts::EVENTS - 1) std::fprintf(stderr, " %9.2f", v / 1e6);  // task-clock в нс
+            else std::fprintf(stderr, " %9s", compact(v).c_str());
+
+            if (e == 1) {
+                bool ipc = t.counts.valid[0] && t.counts.valid[1] && t.counts.value[0] > 0;
+                if (ipc) std::fprintf(stderr, " %5.2f", t.counts.value[1] / t.counts.value[0]);
+                else std::fprintf(stderr, " %5s", "-");
+            }
+        }
+        std::fprintf(stderr, "\n");
+    }
+};
+
+// Счётчики текущего потока открываются при первом участке в этом потоке
+struct PerfThreadState {
+    PerfThreadCounters counters;
+    int index = PerfRegistry::instance().nextThread();
+
+    PerfThreadState() {
+        if (!counters.failure().empty()) PerfRegistry::instance().noteFailure(counters.failure());
+    }
+};
+
+inline PerfThreadState& perfThreadState() {
+    thread_local PerfThreadState state;
+    return state;
+}
+
+inline void perfRegionsLabel(const std::string& label) {
+    PerfRegistry::instance().setLabel(label);
+}
+
+// Участок кода от конструктора до деструктора; имя должно жить до конца программы
+class PerfRegion {
+public:
+    explicit PerfRegion(const char* name) : name(name) {
+        if (!perfRegionsEnabled()) return;
+        state = &perfThreadState();
+        state->counters.read(start);
+        startTime = std::chrono::steady_clock::now();
+    }
+
+    ~PerfRegion() {
+        if (!state) return;
+        auto endTime = std::chrono::steady_clock::now();
+        PerfThreadCounters::Reading end[PerfCounts::EVENTS];
+        state->counters.read(end);
+
+        PerfCounts counts;
+        for (int e = 0; e < PerfCounts::EVENTS; ++e) {
+            bool measured = PerfThreadCounters::delta(start[e], end[e], counts.value[e]);
+            counts.valid[e] = state->counters.available(e) && measured;
+        }
+        PerfRegistry::instance().add(name, state->index,
+            std::chrono::duration<double>(endTime - startTime).count(), counts);
+    }
+
+    PerfRegion(const PerfRegion&) = delete;
+    PerfRegion& operator=(const PerfRegion&) = delete;
+
+private:
+    const char* name;
+    PerfThreadState* state = nullptr;
+    PerfThreadCounters::Reading start[PerfCounts::EVENTS];
+    std::chrono::steady_clock::time_point startTime;
+};
+
+#else
+
+inline void perfRegionsLabel(const std::string&) {}
+
+class PerfRegion {
+public:
+    explicit PerfRegion(const char*) {}
+};
+
+#endif
@@ -0,0 +1,341 @@
+﻿#pragma once
+// Воспроизводимое суммирование double: точный суперсумматор с фиксированной точкой.
+// Любое конечное double - это целое m < 2^53, умноженное на 2^(e - 1074), поэтому
+// сумма хранится точно как целое число в единицах 2^-1074: 70 "цифр" по 32 бита
+// покрывают весь диапазон double и запас на переносы. Цифры лежат в int64, и
+// прибавление числа - это три целых сложения без переносов; переносы собираются
+// раз в 2^30 сложений и перед объединением.
+// Целое сложение ассоциативно, поэтому результат не зависит от порядка слагаемых,
+// числа потоков OpenMP, расписания и числа процессов MPI: частичные суммы
+// объединяются merge в любом порядке. value() округляет точную сумму к ближайшему
+// double (половину - к чётному), т.е. результат ещё и точнее обычного сложения.
+// Бесконечности и NaN складываются отдельно обычным сложением, которое для них
+// тоже не зависит от порядка.
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include "dispatch.h"
+
+class ReproducibleSum {
+public:
+    static const int DIGITS = 70;
+    static const int DIGIT_BITS = 32;
+
+    void add(double x) {
+        uint64_t bits;
+        std::memcpy(&bits, &x, sizeof(bits));
+        int e = static_cast<int>(bits >> 52 & 0x7FF);
+        if (e == 0x7FF) {
+            special += x;
+            return;
+        }
+        uint64_t m = bits & ((uint64_t(1) << 52) - 1);
+        if (e == 0) {
+            e = 1;  // субнормальное число
+        }
+        else {
+            m |= uint64_t(1) << 52;
+        }
+
+        // Младший бит мантиссы стоит в позиции e - 1 от 2^-1074
+        int pos = e - 1;
+        int k = pos / DIGIT_BITS;
+        int s = pos % DIGIT_BITS;
+        uint64_t hi = m >> (DIGIT_BITS - s);
+        // Знак без ветвления: у слагаемых разных знаков ветка предсказывалась бы плохо,
+        // (c ^ -1) + 1 = -c
+        int64_t negative = -static_cast<int64_t>(bits >> 63);
+        digits[k] += (static_cast<int64_t>((m << s) & DIGIT_MASK) ^ negative) - negative;
+        digits[k + 1] += (static_cast<int64_t>(hi & DIGIT_MASK) ^ negative) - negative;
+        digits[k + 2] += (static_cast<int64_t>(hi >> DIGIT_BITS) ^ negative) - negative;
+        if (++pending == NORMALIZE_EVERY) normalize();
+    }
+
+    void merge(const ReproducibleSum& other) {
+        ReproducibleSum rhs = other;
+        rhs.normalize();
+        normalize();
+        for (int k = 0; k < DIGITS; ++k) digits[k] += rhs.digits[k];
+        special += rhs.special;
+        pending = 2;
+    }
+
+    // Переносы: все цифры, кроме старшей, в [0, 2^32), старшая несёт знак
+    void normalize() {
+        for (int k = 0; k + 1 < DIGITS; ++k) {
+            int64_t carry = digits[k] >> DIGIT_BITS;  // арифметический сдвиг
+            digits[k] -= carry * (int64_t(1) << DIGIT_BITS);
+            digits[k + 1] += carry;
+        }
+        pending = 0;
+    }
+
+    // Точная сумма, округлённая к ближайшему double
+    double value() const {
+        if (special != 0.0) return special;  // есть бесконечность или NaN
+
+        ReproducibleSum a = *this;
+        a.normalize();
+        bool negative = a.digits[DIGITS - 1] < 0;
+        if (negative) {
+            for (int k = 0; k < DIGITS; ++k) a.digits[k] = -a.digits[k];
+            a.normalize();
+        }
+
+        int t = DIGITS - 1;
+        while (t >= 0 && a.digits[t] == 0) --t;
+        if (t < 0) return 0.0;
+
+        // Старшие 64 бита модуля, выровненные по старшей единице, и признак
+        // ненулевых битов ниже них
+        auto digit = [&](int k) { return k >= 0 ? static_cast<uint64_t>(a.digits[k]) : uint64_t(0); };
+        int lz = 0;
+        while (!(digit(t) << lz & (uint64_t(1) << (DIGIT_BITS - 1)))) ++lz;
+        uint64_t top = (digit(t) << DIGIT_BITS | digit(t - 1)) << lz;
+        bool sticky = false;
+        if (lz > 0) {
+            top |= digit(t - 2) >> (DIGIT_BITS - lz);
+            sticky = (digit(t - 2) & ((uint64_t(1) << (DIGIT_BITS - lz)) - 1)) != 0;
+        }
+        else {
+            sticky = digit(t - 2) != 0;
+        }
+        for (int k = t - 3; k >= 0 && !sticky; --k) sticky = a.digits[k] != 0;
+
+        // Округление 64 бит до 53 к ближайшему, половина - к чётному
+        uint64_t mantissa = top >> 11;
+        uint64_t rest = top & 0x7FF;
+        if (rest > 0x400 || (rest == 0x400 && (sticky || (mantissa & 1)))) ++mantissa;
+        int exponent = DIGIT_BITS * (t - 1) - 1074 - lz + 11;
+        double result = std::ldexp(static_cast<double>(mantissa), exponent);
+        return negative ? -result : result;
+    }
+
+private:
+    static const uint64_t DIGIT_MASK = (uint64_t(1) << DIGIT_BITS) - 1;
+    // Каждая цифра меняется за сложение меньше чем на 2^32, int64 хватает на 2^31
+    static const int NORMALIZE_EVERY = 1 << 30;
+
+    int64_t digits[DIGITS] = {};
+    double special = 0.0;
+    int pending = 0;
+};
+
+// Быстрое воспроизводимое накопление для горячих циклов: K-кратные корзины, как в
+// ReproBLAS. Порядки делятся на корзины по BIN_BITS бит на фиксированной сетке, окно
+// из FOLDS корзин начинается со старшей корзины, нужной наибольшему модулю. Каждая
+// корзина - double, равный 1.5 * 2^a плюс накопленное: сложение с ним округляет
+// слагаемое к сетке корзины, вычитание точно выделяет эту часть, а остаток уходит в
+// следующую корзину. Младший бит слагаемого перед округлением равен 1, так что
+// половинок не бывает, и часть, попавшая в корзину, зависит только от числа и сетки.
+// Остаток ниже последней корзины отбрасывается: ошибка не больше n * 2^-118 * max|x|
+// (но не меньше n * 2^-1073: сетка корзин не мельче 2^-1072).
+// Когда приходит число больше окна, окно сдвигается вверх на целые корзины, и нижние
+// корзины выбрасываются - ровно то, что выбросилось бы при старте с этим окном.
+// Поэтому сумма зависит только от набора чисел и окна: частичные суммы выравниваются
+// alignTo на общее (наибольшее) окно и точно переносятся в ReproducibleSum, где
+// объединяются и округляются. Бесконечности, NaN и числа от 2^887 складываются
+// сразу в ReproducibleSum.
+// Каждая корзина хранится в LANES копиях: add(data, count) раскладывает соседние
+// числа по копиям векторным ядром (см. common/dispatch.h), цепочки сложений не ждут
+// друг друга. На сумму это не влияет - копии лежат на одной сетке
+class BinnedSum {
+public:
+    static const int FOLDS = 3;
+    static const int LANES = 8;
+    static const int BIN_BITS = 40;
+    // Окно index: старшая корзина - порядки ниже 2^(-940 + BIN_BITS * index). Нижняя
+    // граница держит сетку последней корзины не мельче 2^-1072 (младший бит
+    // субнормального числа меньше четверти шага), верхняя - переносы в пределах double
+    static const int MAX_INDEX = 46;
+
+    BinnedSum() {
+        for (int j = 0; j < FOLDS; ++j) {
+            for (int l = 0; l < LANES; ++l) fold[j * LANES + l] = base(j);
+        }
+    }
+
+    void add(double x) {
+        if (!(std::fabs(x) < limit) && !widen(x)) {
+            outliers.add(x);
+            return;
+        }
+        for (int j = 0; j + 1 < FOLDS; ++j) {
+            double& f = fold[j * LANES];
+            double q = f + withLowBit(x);
+            x -= q - f;
+            f = q;
+        }
+        fold[(FOLDS - 1) * LANES] += withLowBit(x);
+        if (++pending == RENORMALIZE_EVERY) renormalize();
+    }
+
+    // Массив целиком: группы по LANES чисел векторным ядром, группа с числом вне
+    // окна и хвост - по одному
+    void add(const double* data, long long count) {
+        DepositFn deposit = depositKernel().get();
+        long long i = 0;
+        while (i < count) {
+            long long room = static_cast<long long>(RENORMALIZE_EVERY - pending) * LANES;
+            long long chunk = (std::min)(count - i, room) / LANES * LANES;
+            long long done = chunk > 0 ? deposit(fold, data + i, chunk, limit) : 0;
+            i += done;
+            pending += static_cast<int>(done / LANES);
+            if (pending == RENORMALIZE_EVERY) renormalize();
+            if (done == chunk && chunk > 0) continue;
+            for (long long end = (std::min)(count, i + LANES); i < end; ++i) add(data[i]);
+        }
+    }
+
+    int index() const { return window; }
+
+    // Сдвиг окна вверх до target (окна ниже текущего не бывает)
+    void alignTo(int target) {
+        int shift = target - window;
+        if (shift <= 0) return;
+        window = target;
+        limit = std::ldexp(1.0, exponent(0) - 13);
+        for (int j = FOLDS - 1; j >= 0; --j) {
+            for (int l = 0; l < LANES; ++l) {
+                fold[j * LANES + l] = j >= shift ? fold[(j - shift) * LANES + l] : base(j);
+            }
+            carry[j] = j >= shift ? carry[j - shift] : 0;
+        }
+    }
+
+    // Точный перенос накопленного в суперсумматор
+    void addTo(ReproducibleSum& sum) const {
+        for (int j = 0; j < FOLDS; ++j) {
+            for (int l = 0; l < LANES; ++l) sum.add(fold[j * LANES + l] - base(j));
+            sum.add(static_cast<double>(carry[j]) * std::ldexp(1.0, exponent(j) - 2));
+        }
+        sum.merge(outliers);
+    }
+
+private:
+    // Слагаемые корзины меньше 2^(a - 13), за 2048 сложений она уходит от 1.5 * 2^a
+    // меньше чем на 2^(a - 2) и остаётся в своей двоичной декаде
+    static const int RENORMALIZE_EVERY = 2048;
+
+    // Раскладывает count чисел (кратно LANES) по корзинам fold; возвращает, сколько
+    // разложено до первой группы с числом вне окна (|x| >= limit или NaN)
+    using DepositFn = long long (*)(double* fold, const double* data, long long count, double limit);
+
+    SIMD_TARGET_SCALAR static long long depositScalar(double* fold, const double* data, long long count, double limit) {
+        for (long long i = 0; i < count; i += LANES) {
+            bool inside = true;
+            for (int l = 0; l < LANES; ++l) inside = inside && std::fabs(data[i + l]) < limit;
+            if (!inside) return i;
+            for (int l = 0; l < LANES; ++l) {
+                double x = data[i + l];
+                for (int j = 0; j + 1 < FOLDS; ++j) {
+                    double& f = fold[j * LANES + l];
+                    double q = f + withLowBit(x);
+                    x -= q - f;
+                    f = q;
+                }
+                fold[(FOLDS - 1) * LANES + l] += withLowBit(x);
+            }
+        }
+        return count;
+    }
+
+    SIMD_TARGET_AVX2 static long long depositAvx2(double* fold, const double* data, long long count, double limit) {
+        const __m256d lowBit = _mm256_castsi256_pd(_mm256_set1_epi64x(1));
+        const __m256d absMask = _mm256_castsi256_pd(_mm256_set1_epi64x(0x7FFFFFFFFFFFFFFFLL));
+        const __m256d bound = _mm256_set1_pd(limit);
+        __m256d f[FOLDS][2];
+        for (int j = 0; j < FOLDS; ++j) {
+            for (int h = 0; h < 2; ++h) f[j][h] = _mm256_loadu_pd(fold + j * LANES + 4 * h);
+        }
+        long long i = 0;
+        for (; i < count; i += LANES) {
+            __m256d x[2] = { _mm256_loadu_pd(data + i), _mm256_loadu_pd(data + i + 4) };
+            __m256d inside = _mm256_and_pd(_mm256_cmp_pd(_mm256_and_pd(x[0], absMask), bound, _CMP_LT_OQ),
+                _mm256_cmp_pd(_mm256_and_pd(x[1], absMask), bound, _CMP_LT_OQ));
+            if (_mm256_movemask_pd(inside) != 0xF) break;
+            for (int h = 0; h < 2; ++h) {
+                for (int j = 0; j + 1 < FOLDS; ++j) {
+                    __m256d q = _mm256_add_pd(f[j][h], _mm256_or_pd(x[h], lowBit));
+                    x[h] = _mm256_sub_pd(x[h], _mm256_sub_pd(q, f[j][h]));
+                    f[j][h] = q;
+                }
+                f[FOLDS - 1][h] = _mm256_add_pd(f[FOLDS - 1][h], _mm256_or_pd(x[h], lowBit));
+            }
+        }
+        for (int j = 0; j < FOLDS; ++j) {
+            for (int h = 0; h < 2; ++h) _mm256_storeu_pd(fold + j * LANES + 4 * h, f[j][h]);
+        }
+        return i;
+    }
+
+    SIMD_TARGET_AVX512 static long long depositAvx512(double* fold, const double* data, long long count, double limit) {
+        const __m512i lowBit = _mm512_set1_epi64(1);
+        const __m512d bound = _mm512_set1_pd(limit);
+        __m512d f[FOLDS];
+        for (int j = 0; j < FOLDS; ++j) f[j] = _mm512_loadu_pd(fold + j * LANES);
+        long long i = 0;
+        for (; i < count; i += LANES) {
+            __m512d x = _mm512_loadu_pd(data + i);
+            if (_mm512_cmp_pd_mask(_mm512_abs_pd(x), bound, _CMP_LT_OQ) != 0xFF) break;
+            for (int j = 0; j + 1 < FOLDS; ++j) {
+                __m512d q = _mm512_add_pd(f[j], _mm512_castsi512_pd(_mm512_or_si512(_mm512_castpd_si512(x), lowBit)));
+                x = _mm512_sub_pd(x, _mm512_sub_pd(q, f[j]));
+                f[j] = q;
+            }
+            f[FOLDS - 1] = _mm512_add_pd(f[FOLDS - 1],
+                _mm512_castsi512_pd(_mm512_or_si512(_mm512_castpd_si512(x), lowBit)));
+        }
+        for (int j = 0; j < FOLDS; ++j) _mm512_storeu_pd(fold + j * LANES, f[j]);
+        return i;
+    }
+
+    static const SimdKernel<DepositFn>& depositKernel() {
+        static const SimdKernel<DepositFn> kernel(depositScalar, nullptr, depositAvx2, depositAvx512);
+        return kernel;
+    }
+
+    int exponent(int j) const { return -940 + BIN_BITS * (window - j); }
+    double base(int j) const { return std::ldexp(1.5, exponent(j)); }
+
+    SIMD_TARGET_SCALAR static double withLowBit(double x) {
+        uint64_t bits;
+        std::memcpy(&bits, &x, sizeof(bits));
+        bits |= 1;
+        std::memcpy(&x, &bits, sizeof(bits));
+        return x;
+    }
+
+    // Окно, вмещающее x; false - x не помещается ни в одно окно
+    bool widen(double x) {
+        if (!std::isfinite(x)) return false;
+        // Нужно |x| < 2^(a - 13), то есть a >= ilogb(x) + 14
+        int need = std::ilogb(x) + 14 + 940;
+        int target = (need + BIN_BITS - 1) / BIN_BITS;
+        if (target > MAX_INDEX) return false;
+        alignTo(target);
+        return true;
+    }
+
+    // Целые четверти 2^a переходят из корзин в счётчик переносов
+    void renormalize() {
+        for (int j = 0; j < FOLDS; ++j) {
+            double quarter = std::ldexp(1.0, exponent(j) - 2);
+            for (int l = 0; l < LANES; ++l) {
+                double& f = fold[j * LANES + l];
+                double k = std::nearbyint((f - base(j)) / quarter);
+                f -= k * quarter;
+                carry[j] += static_cast<int64_t>(k);
+            }
+        }
+        pending = 0;
+    }
+
+    double fold[FOLDS * LANES];
+    int64_t carry[FOLDS] = {};
+    int window = 0;
+    double limit = std::ldexp(1.0, -940 - 13);
+    int pending = 0;
+    ReproducibleSum outliers;
+};
@@ -0,0 +1,327 @@
+﻿#pragma once
+// Модель roofline: пиковая производительность и устойчивая пропускная способность
+// памяти измеряются встроенными микротестами, для каждого ядра по числу операций,
+// минимальному (обязательному) трафику памяти и времени считаются арифметическая
+// интенсивность, достигнутая производительность и потолок min(пик, AI x ПС).
+// Ядро с AI меньше точки перегиба (пик / ПС) ограничено памятью, иначе вычислениями.
+// Пик измеряется на том же уровне SIMD, который выбирают ядра (simdLevel(), с учётом
+// SIMD_LEVEL), а не на наборе команд, под который собрана программа.
+//
+// Флаги (разбирает RooflineOptions::parse):
+//   --roofline              напечатать таблицу roofline для ядер программы
+//   --roofline-csv <файл>   дописать точки ядер в CSV для графика
+//
+// График по CSV (gnuplot, логарифмические оси):
+//   roof(x) = x * bw < peak ? x * bw : peak
+//   plot roof(x), "roofline.csv" using "ai":"gflops":"kernel" with labels point
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "dispatch.h"
+
+struct RooflineOptions {
+    bool enabled = false;
+    std::string csv;
+
+    // Разбор одного флага; true, если argv[i] (и его значение) обработан
+    bool parse(int& i, int argc, char** argv) {
+        std::string arg = argv[i];
+        if (arg == "--roofline") {
+            enabled = true;
+        }
+        else if (arg == "--roofline-csv" && i + 1 < argc) {
+            csv = argv[++i];
+            enabled = true;
+        }
+        else {
+            return false;
+        }
+        return true;
+    }
+};
+
+// Потолки машины для заданного числа потоков
+struct RooflineMachine {
+    int threads = 1;
+    SimdLevel level = simdLevel();  // набор команд, на котором измерен пик
+    double flops = 0;      // пиковая производительность, FLOP/с
+    double bandwidth = 0;  // устойчивая пропускная способность памяти, Б/с
+
+    // Интенсивность, начиная с которой ядро упирается в вычисления, FLOP/Б
+    double ridge() const { return bandwidth > 0 ? flops / bandwidth : 0.0; }
+};
+
+// Барьер для потоков микротестов: все стартуют одновременно
+class RooflineBarrier {
+public:
+    explicit RooflineBarrier(int count) : count(count) {}
+
+    void wait() {
+        int gen = generation.load();
+        if (arrived.fetch_add(1) + 1 == count) {
+            arrived.store(0);
+            generation.fetch_add(1);
+        }
+        else {
+            while (generation.load() == gen) std::this_thread::yield();
+        }
+    }
+
+private:
+    const int count;
+    std::atomic<int> arrived{ 0 };
+    std::atomic<int> generation{ 0 };
+};
+
+// Поток микротеста: восемь независимых цепочек a = a * m + c по всей ширине вектора
+// закрывают задержку операции на двух конвейерах. Варианты по уровням SIMD, как у
+// ядер: на AVX2 и AVX-512 это FMA, на SSE4.2 и в скалярном - умножение и сложение.
+// Константы читаются из volatile, иначе компилятор найдёт неподвижную точку цепочки.
+// Возвращает число выполненных операций с плавающей точкой
+using RooflineFmaFn = double (*)(long long iterations, volatile double& sink);
+
+SIMD_TARGET_SCALAR inline double rooflineFmaScalar(long long iterations, volatile double& sink) {
+    volatile double init = 1.0, mul = 0.999999, add = 1e-6;
+    double a0 = init, a1 = a0, a2 = a0, a3 = a0, a4 = a0, a5 = a0, a6 = a0, a7 = a0;
+    const double m = mul, c = add;
+    for (long long it = 0; it < iterations; ++it) {
+        a0 = a0 * m + c; a1 = a1 * m + c; a2 = a2 * m + c; a3 = a3 * m + c;
+        a4 = a4 * m + c; a5 = a5 * m + c; a6 = a6 * m + c; a7 = a7 * m + c;
+    }
+    sink += a0 + a1 + a2 + a3 + a4 + a5 + a6 + a7;
+    return 2.0 * 8 * iterations;
+}
+
+SIMD_TARGET_SSE42 inline double rooflineFmaSse42(long long iterations, volatile double& sink) {
+    volatile double init = 1.0, mul = 0.999999, add = 1e-6;
+    __m128d a0 = _mm_set1_pd(init), a1 = a0, a2 = a0, a3 = a0, a4 = a0, a5 = a0, a6 = a0, a7 = a0;
+    const __m128d m = _mm_set1_pd(mul), c = _mm_set1_pd(add);
+    for (long long it = 0; it < iterations; ++it) {
+        a0 = _mm_add_pd(_mm_mul_pd(a0, m), c); a1 = _mm_add_pd(_mm_mul_pd(a1, m), c);
+        a2 = _mm_add_pd(_mm_mul_pd(a2, m), c); a3 = _mm_add_pd(_mm_mul_pd(a3, m), c);
+        a4 = _mm_add_pd(_mm_mul_pd(a4, m), c); a5 = _mm_add_pd(_mm_mul_pd(a5, m), c);
+        a6 = _mm_add_pd(_mm_mul_pd(a6, m), c); a7 = _mm_add_pd(_mm_mul_pd(a7, m), c);
+    }
+    __m128d sum = _mm_add_pd(_mm_add_pd(_mm_add_pd(a0, a1), _mm_add_pd(a2, a3)),
+        _mm_add_pd(_mm_add_pd(a4, a5), _mm_add_pd(a6, a7)));
+    alignas(16) double lanes[2];
+    _mm_store_pd(lanes, sum);
+    sink += lanes[0] + lanes[1];
+    return 2.0 * 2 * 8 * iterations;
+}
+
+SIMD_TARGET_AVX2 inline double rooflineFmaAvx2(long long iterations, volatile double& sink) {
+    volatile double init = 1.0, mul = 0.999999, add = 1e-6;
+    __m256d a0 = _mm256_set1_pd(init), a1 = a0, a2 = a0, a3 = a0, a4 = a0, a5 = a0, a6 = a0, a7 = a0;
+    const __m256d m = _mm256_set1_pd(mul), c = _mm256_set1_pd(add);
+    for (long long it = 0; it < iterations; ++it) {
+        a0 = _mm256_fmadd_pd(a0, m, c); a1 = _mm256_fmadd_pd(a1, m, c);
+        a2 = _mm256_fmadd_pd(a2, m, c); a3 = _mm256_fmadd_pd(a3, m, c);
+        a4 = _mm256_fmadd_pd(a4, m, c); a5 = _mm256_fmadd_pd(a5, m, c);
+        a6 = _mm256_fmadd_pd(a6, m, c); a7 = _mm256_fmadd_pd(a7, m, c);
+    }
+    __m256d sum = _mm256_add_pd(_mm256_add_pd(_mm256_add_pd(a0, a1), _mm256_add_pd(a2, a3)),
+        _mm256_add_pd(_mm256_add_pd(a4, a5), _mm256_add_pd(a6, a7)));
+    alignas(32) double lanes[4];
+    _mm256_store_pd(lanes, sum);
+    sink += lanes[0] + lanes[1] + lanes[2] + lanes[3];
+    return 2.0 * 4 * 8 * iterations;
+}
+
+SIMD_TARGET_AVX512 inline double rooflineFmaAvx512(long long iterations, volatile double& sink) {
+    volatile double init = 1.0, mul = 0.999999, add = 1e-6;
+    __m512d a0 = _mm512_set1_pd(init), a1 = a0, a2 = a0, a3 = a0, a4 = a0, a5 = a0, a6 = a0, a7 = a0;
+    const __m512d m = _mm512_set1_pd(mul), c = _mm512_set1_pd(add);
+    for (long long it = 0; it < iterations; ++it) {
+        a0 = _mm512_fmadd_pd(a0, m, c); a1 = _mm512_fmadd_pd(a1, m, c);
+        a2 = _mm512_fmadd_pd(a2, m, c); a3 = _mm512_fmadd_pd(a3, m, c);
+        a4 = _mm512_fmadd_pd(a4, m, c); a5 = _mm512_fmadd_pd(a5, m, c);
+        a6 = _mm512_fmadd_pd(a6, m, c); a7 = _mm512_fmadd_pd(a7, m, c);
+    }
+    __m512d sum = _mm512_add_pd(_mm512_add_pd(_mm512_add_pd(a0, a1), _mm512_add_pd(a2, a3)),
+        _mm512_add_pd(_mm512_add_pd(a4, a5), _mm512_add_pd(a6, a7)));
+    alignas(64) double lanes[8];
+    _mm512_store_pd(lanes, sum);
+    sink += lanes[0] + lanes[1] + lanes[2] + lanes[3] + lanes[4] + lanes[5] + lanes[6] + lanes[7];
+    return 2.0 * 8 * 8 * iterations;
+}
+
+inline const SimdKernel<RooflineFmaFn>& rooflineFmaKernel() {
+    static const SimdKernel<RooflineFmaFn> kernel(rooflineFmaScalar, rooflineFmaSse42, rooflineFmaAvx2,
+        rooflineFmaAvx512);
+    return kernel;
+}
+
+// Пик и пропускная способность на threads потоках; лучший из нескольких повторов.
+// Пропускная способность - триада STREAM a = b + s * c (24 байта на элемент),
+// массивы каждого потока заполняет он сам, чтобы страницы были локальными
+inline RooflineMachine rooflineMeasure(int threads) {
+    const int repeats = 4;
+    const long long fmaIterations = 1 << 23;
+    const size_t totalElements = size_t(1) << 23;  // 3 массива x 64 МБ на все потоки
+    threads = (std::max)(1, threads);
+    size_t elements = totalElements / threads;
+
+    RooflineBarrier barrier(threads);
+    RooflineFmaFn fmaChains = rooflineFmaKernel().get();
+    double bestFlops = 0, bestBandwidth = 0;
+    // Результаты микротестов пишутся в volatile, иначе компилятор вправе выбросить вычисления
+    std::vector<double> sinks(threads * 8, 0.0);
+    std::chrono::steady_clock::time_point start;
+
+    auto body = [&](int t) {
+        std::unique_ptr<double[]> a(new double[elements]), b(new double[elements]), c(new double[elements]);
+        for (size_t i = 0; i < elements; ++i) {
+            a[i] = 0.0;
+            b[i] = 1.0;
+            c[i] = 2.0;
+        }
+
+        for (int r = 0; r < repeats; ++r) {
+            barrier.wait();
+            if (t == 0) start = std::chrono::steady_clock::now();
+            barrier.wait();
+            double done = fmaChains(fmaIterations, sinks[t * 8]);
+            barrier.wait();
+            if (t == 0) {
+                double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                bestFlops = (std::max)(bestFlops, done * threads / seconds);
+            }
+
+            barrier.wait();
+            if (t == 0) start = std::chrono::steady_clock::now();
+            barrier.wait();
+            const double s = 3.0;
+            for (size_t i = 0; i < elements; ++i) {
+                a[i] = b[i] + s * c[i];
+            }
+            barrier.wait();
+            if (t == 0) {
+                double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                bestBandwidth = (std::max)(bestBandwidth, 24.0 * elements * threads / seconds);
+            }
+            static_cast<volatile double&>(sinks[t * 8]) += a[elements / 2];
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (int t = 1; t < threads; ++t) {
+        workers.emplace_back(body, t);
+    }
+    body(0);
+    for (auto& w : workers) {
+        w.join();
+    }
+
+    RooflineMachine machine;
+    machine.threads = threads;
+    machine.level = rooflineFmaKernel().level();
+    machine.flops = bestFlops;
+    machine.bandwidth = bestBandwidth;
+    return machine;
+}
+
+// Точки ядер одной программы относительно потолков машины
+class Roofline {
+public:
+    explicit Roofline(std::string program) : program(std::move(program)) {}
+
+    // Потолки для threads потоков; измеряются при первом обращении
+    const RooflineMachine& machine(int threads) {
+        auto it = machines.find(threads);
+        if (it == machines.end()) {
+            it = machines.emplace(threads, rooflineMeasure(threads)).first;
+        }
+        return it->second;
+    }
+
+    // Готовые потолки, например суммарные по процессам MPI
+    void setMachine(const RooflineMachine& m) {
+        machines[m.threads] = m;
+    }
+
+    // flops - операций за запуск, bytes - обязательный трафик памяти за запуск,
+    // type - тип элементов (для целочисленных ядер операции сравниваются с пиком FP64)
+    void add(const std::string& name, const std::string& type, int threads, double flops, double bytes, double seconds) {
+        machine(threads);
+        points.push_back(Point{ name, type, threads, flops, bytes, seconds });
+    }
+
+    void report(std::ostream& out) const {
+        out << "Roofline: " << program << std::endl;
+        for (const auto& kv : machines) {
+            const RooflineMachine& m = kv.second;
+            out << "  " << m.threads << " thread(s): peak " << std::fixed << std::setprecision(1)
+                << m.flops / 1e9 << " GFLOP/s (" << simdLevelName(m.level) << "), bandwidth " << m.bandwidth / 1e9 << " GB/s, ridge "
+                << std::setprecision(2) << m.ridge() << " FLOP/B" << std::endl;
+        }
+
+        size_t width = 6;
+        for (const Point& p : points) width = (std::max)(width, p.name.size());
+        out << std::left << std::setw(width + 2) << "kernel" << std::setw(7) << "type" << std::right
+            << std::setw(8) << "threads" << std::setw(11) << "AI, op/B" << std::setw(11) << "Gop/s"
+            << std::setw(11) << "roof" << std::setw(9) << "of roof" << "  bound" << std::endl;
+        for (const Point& p : points) {
+            const RooflineMachine& m = machines.at(p.threads);
+            out << std::left << std::setw(width + 2) << p.name << std::setw(7) << p.type << std::right
+                << std::setw(8) << p.threads << std::fixed << std::setprecision(3) << std::setw(11) << p.intensity()
+                << std::setprecision(2) << std::setw(11) << p.performance() / 1e9
+                << std::setw(11) << roof(p, m) / 1e9
+                << std::setprecision(1) << std::setw(8) << 100 * p.performance() / roof(p, m) << "%"
+                << "  " << (p.intensity() < m.ridge() ? "memory" : "compute") << std::endl;
+        }
+        out << std::defaultfloat;
+    }
+
+    // Точки для графика; заголовок пишется, только если файл пустой
+    void appendCsv(const std::string& path) const {
+        bool empty = true;
+        {
+            std::ifstream existing(path);
+            empty = !existing || existing.peek() == std::ifstream::traits_type::eof();
+        }
+        std::ofstream out(path, std::ios::app);
+        if (!out) {
+            std::cerr << "Cannot write " << path << std::endl;
+            return;
+        }
+        if (empty) {
+            out << "program,kernel,type,threads,flops,bytes,seconds,ai,gflops,peak_gflops,bandwidth_gbs,roof_gflops,bound\n";
+        }
+        out << std::setprecision(6);
+        for (const Point& p : points) {
+            const RooflineMachine& m = machines.at(p.threads);
+            out << program << "," << p.name << "," << p.type << "," << p.threads << "," << p.flops << ","
+                << p.bytes << "," << p.seconds << "," << p.intensity() << "," << p.performance() / 1e9 << ","
+                << m.flops / 1e9 << "," << m.bandwidth / 1e9 << "," << roof(p, m) / 1e9 << ","
+                << (p.intensity() < m.ridge() ? "memory" : "compute") << "\n";
+        }
+    }
+
+private:
+    struct Point {
+        std::string name, type;
+        int threads;
+        double flops, bytes, seconds;
+
+        double intensity() const { return bytes > 0 ? flops / bytes : 0.0; }
+        double performance() const { return seconds > 0 ? flops / seconds : 0.0; }
+    };
+
+    static double roof(const Point& p, const RooflineMachine& m) {
+        return (std::min)(m.flops, p.intensity() * m.bandwidth);
+    }
+
+    std::string program;
+    std::map<int, RooflineMachine> machines;
+    std::vector<Point> points;
+};
@@ -0,0 +1,13 @@
+﻿#pragma once
+// Вспомогательные функции для вывода таблиц в консоль
+#include <cstddef>
+#include <string>
+
+// Дополнение строки пробелами до width символов (кириллица в UTF-8 занимает 2 байта)
+inline std::string padRight(const std::string& text, size_t width) {
+    size_t chars = 0;
+    for (unsigned char c : text) {
+        if ((c & 0xC0) != 0x80) chars++;
+    }
+    return text + std::string(width > chars ? width - chars : 0, ' ');
+}